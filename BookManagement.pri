@@ -0,0 +1,76 @@
+# everything but main.cpp, shared by the application and the benchmarks
+
+INCLUDEPATH += $$PWD
+
+SOURCES += $$PWD/login_dialog.cpp \
+    $$PWD/app_main_window.cpp \
+    $$PWD/view_inventory_dialog.cpp \
+    $$PWD/search_dialog.cpp \
+    $$PWD/add_item_dialog.cpp \
+    $$PWD/buy_book_dialog.cpp \
+    $$PWD/report_dialog.cpp \
+    $$PWD/cover_cache.cpp \
+    $$PWD/connection_settings.cpp \
+    $$PWD/inventory_pager.cpp \
+    $$PWD/inventory_table_model.cpp \
+    $$PWD/inventory_table_dialog.cpp \
+    $$PWD/db_executor.cpp \
+    $$PWD/connection_pool.cpp \
+    $$PWD/statement_cache.cpp \
+    $$PWD/checkout.cpp \
+    $$PWD/report_journal.cpp \
+    $$PWD/report_export.cpp \
+    $$PWD/pdf_report_renderer.cpp \
+    $$PWD/low_stock_tracker.cpp \
+    $$PWD/inventory_cache.cpp \
+    $$PWD/search_index.cpp \
+    $$PWD/live_search.cpp \
+    $$PWD/cover_store.cpp \
+    $$PWD/catalog_import.cpp \
+    $$PWD/inventory_snapshot.cpp \
+    $$PWD/storage_backend.cpp \
+    $$PWD/mysql_backend.cpp \
+    $$PWD/sqlite_backend.cpp \
+    $$PWD/query_tracer.cpp \
+    $$PWD/diagnostics_dialog.cpp
+
+HEADERS  += $$PWD/login_dialog.hpp \
+    $$PWD/app_main_window.hpp \
+    $$PWD/view_inventory_dialog.hpp \
+    $$PWD/search_dialog.hpp \
+    $$PWD/add_item_dialog.hpp \
+    $$PWD/buy_book_dialog.hpp \
+    $$PWD/report_dialog.hpp \
+    $$PWD/resources.hpp \
+    $$PWD/schema.hpp \
+    $$PWD/cover_cache.hpp \
+    $$PWD/connection_settings.hpp \
+    $$PWD/inventory_pager.hpp \
+    $$PWD/inventory_table_model.hpp \
+    $$PWD/inventory_table_dialog.hpp \
+    $$PWD/db_executor.hpp \
+    $$PWD/connection_pool.hpp \
+    $$PWD/statement_cache.hpp \
+    $$PWD/checkout.hpp \
+    $$PWD/report_journal.hpp \
+    $$PWD/report_export.hpp \
+    $$PWD/pdf_report_renderer.hpp \
+    $$PWD/low_stock_tracker.hpp \
+    $$PWD/inventory_cache.hpp \
+    $$PWD/search_index.hpp \
+    $$PWD/live_search.hpp \
+    $$PWD/cover_store.hpp \
+    $$PWD/catalog_import.hpp \
+    $$PWD/inventory_snapshot.hpp \
+    $$PWD/storage_backend.hpp \
+    $$PWD/query_tracer.hpp \
+    $$PWD/diagnostics_dialog.hpp
+
+FORMS += \
+    $$PWD/inventory_action_dialog.ui \
+    $$PWD/view_inventory_dialog.ui \
+    $$PWD/buy_book_dialog.ui \
+    $$PWD/report_dialog.ui
+
+RESOURCES += \
+    $$PWD/res.qrc
@@ -9,6 +9,12 @@
 #include <QBuffer>
 #include <QImageWriter>
 #include <QDebug>
+#include "db_executor.hpp"
+#include "statement_cache.hpp"
+#include "report_journal.hpp"
+#include "low_stock_tracker.hpp"
+#include "inventory_cache.hpp"
+#include "cover_store.hpp"
 #include "resources.hpp"
 
 AddItemDialog::AddItemDialog( QWidget *parent) :
@@ -24,6 +30,7 @@ AddItemDialog::AddItemDialog( QWidget *parent) :
     setMaximumSize( QSize( 400, 350 ) );
     setWindowTitle( tr( "Add New record" ));
     ui->dateTimeEdit->setDateTime( QDateTime::currentDateTime() );
+    ui->thresholdSpinBox->setValue( LowStockTracker::DEFAULT_THRESHOLD );
 }
 
 QString AddItemDialog::TABLE_NAME = "inventory";
@@ -62,35 +69,56 @@ void AddItemDialog::onSaveButtonClicked()
         return;
     }
 
-    QString const columns = tr( "date_time, book_title, author_name, publisher, stock, price, location" ) +
-                    ( cover_page_used == true ? tr( ", book_cover" ) : tr( "" ) );
-    QString const values = tr( "'" ) + GetDateTime( ui->dateTimeEdit->dateTime() ) + "', "
-            + tr( "'" ) + ui->titleLineEdit->text() + "', '"
-            + ui->authorLineEdit->text() + "', '"
-            + ui->publisherLineEdit->text() + "', '"
-            + ui->stockLineEdit->text() + "', '"
-            + ui->priceLineEdit->text() + "', '"
-            + ui->locationLineEdit->text() + tr( "'" );
-
-    QString const insert_string = tr( "INSERT INTO %1 ( %2 ) VALUES( %4 %3 )")
-            .arg( TABLE_NAME ).arg( columns )
-            .arg( cover_page_used == true ? ", :image_data" : "" ).arg( values );
-
-    QSqlQuery query{};
-    query.prepare( insert_string );
-
+    DatabaseRecordFormat record {};
+    record.date_time_added = ui->dateTimeEdit->dateTime();
+    record.book_title = ui->titleLineEdit->text();
+    record.author_name = ui->authorLineEdit->text();
+    record.publisher = ui->publisherLineEdit->text();
+    record.quantity = quantity;
+    record.price = price;
+    record.location = ui->locationLineEdit->text();
+    record.low_stock_threshold = static_cast<unsigned int>( ui->thresholdSpinBox->value() );
+
+    QByteArray cover {};
     if( cover_page_used && !m_cover.isNull() ){
         QBuffer buffer {};
         QImageWriter image_writer{ &buffer, "PNG" };
         image_writer.write( m_cover );
 
-        query.bindValue( ":image_data", buffer.data() );
+        cover = buffer.data();
     }
 
-    if( !query.exec() ){
-        QMessageBox::warning( this, "Save", query.lastError().text(), QMessageBox::Ok );
-    } else {
-        GenerateReport();
+    ReportFormat const report = MakeReport();
+
+    ui->saveButton->setEnabled( false );
+    DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this, [record, cover, report]( QSqlDatabase & database )
+    {
+        QueryResult<bool> result {};
+        DatabaseRecordFormat added = record;
+        // the cover goes to the store first, the row only keeps its hash
+        if( !cover.isEmpty() ){
+            added.cover_hash = CoverStore::Instance().Put( database, cover, result.error );
+            if( added.cover_hash.isEmpty() ) return result;
+        }
+        StatementCache & statements = StatementCache::ForThread();
+        QSqlQuery & query = statements.Prepare( database, StatementId::InsertInventory );
+        BindRecord( query, added, PrimaryKey );
+        if( !statements.Exec( database, StatementId::InsertInventory, query ) ){
+            result.error = query.lastError().text();
+            return result;
+        }
+        ReportJournal::Instance().Append( report );
+        added.serial_number = query.lastInsertId().toUInt();
+        InventoryCache::Instance().Insert( added );
+        LowStockTracker::Instance().Update( MakeLowStockItem( added ) );
+        result.ok = true;
+        return result;
+    }, [this]( QueryResult<bool> result ){
+        ui->saveButton->setEnabled( true );
+        if( !result.ok ){
+            QMessageBox::warning( this, "Save", result.error, QMessageBox::Ok );
+            return;
+        }
         if( QMessageBox::information( this, "Save",
                                       tr("Information saved successfully, would you like to add more?" ),
                                       QMessageBox::Yes | QMessageBox::No ) == QMessageBox::No )
@@ -100,7 +128,7 @@ void AddItemDialog::onSaveButtonClicked()
             return;
         }
         ClearEntries();
-    }
+    });
 }
 
 void AddItemDialog::ClearEntries()
@@ -112,6 +140,7 @@ void AddItemDialog::ClearEntries()
     ui->stockLineEdit->clear();
     ui->priceLineEdit->clear();
     ui->titleLineEdit->clear();
+    ui->thresholdSpinBox->setValue( LowStockTracker::DEFAULT_THRESHOLD );
     ui->titleLineEdit->setFocus();
     ui->coverImageLabel->clear();
     ui->coverImageLabel->setText( tr( "No Image" ));
@@ -152,24 +181,15 @@ void AddItemDialog::onUploadButtonClicked()
     }
 }
 
-void AddItemDialog::GenerateReport()
+ReportFormat AddItemDialog::MakeReport() const
 {
-    QSqlQuery report_query {};
-    report_query.prepare( "INSERT INTO reports( book_title, author_name, stock, date_performed, "
-                          "transaction_type, price, total ) VALUES ( :title, :author, "
-                          ":stck, :date, :type, :price, :total )");
-    report_query.bindValue( ":title", ui->titleLineEdit->text() );
-    report_query.bindValue( ":author", ui->authorLineEdit->text() );
-    report_query.bindValue( ":stck", ui->stockLineEdit->text().toInt() );
-    report_query.bindValue( ":date", QDateTime::currentDateTime() );
-    report_query.bindValue( ":type", static_cast<int> ( ReportActionType::ADDITIONS ) );
-    report_query.bindValue( ":price", ui->priceLineEdit->text() );
-    report_query.bindValue( ":total", ui->priceLineEdit->text().toDouble() *
-                            ui->stockLineEdit->text().toInt() );
-
-    if( !report_query.exec() ){
-        qDebug() << report_query.lastError();
-        QMessageBox::information( this, "Report", "Unable to generate report", QMessageBox::Ok );
-        return;
-    }
+    ReportFormat report {};
+    report.book_title = ui->titleLineEdit->text();
+    report.author_name = ui->authorLineEdit->text();
+    report.quantity = ui->stockLineEdit->text().toInt();
+    report.date_time_added = QDateTime::currentDateTime();
+    report.detail = ReportActionType::ADDITIONS;
+    report.price = ui->priceLineEdit->text().toDouble();
+    report.total = report.price * report.quantity;
+    return report;
 }
@@ -3,6 +3,7 @@
 
 #include <QDialog>
 #include <QImage>
+#include "resources.hpp"
 
 namespace Ui {
 class InventoryActionDialog;
@@ -21,7 +22,7 @@ protected:
     void closeEvent( QCloseEvent * ) override;
     bool IsColumnsEmpty();
     void ClearEntries();
-    void GenerateReport();
+    ReportFormat MakeReport() const;
 private slots:
     void onSaveButtonClicked();
     void onUploadButtonClicked();
@@ -1,4 +1,7 @@
+#include <QAbstractItemView>
+#include <QApplication>
 #include <QCloseEvent>
+#include <QCompleter>
 #include <QDebug>
 #include <QFileDialog>
 #include <QKeyEvent>
@@ -9,15 +12,27 @@
 #include <QPrinter>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QStandardItemModel>
+#include <QShortcut>
 #include <QStatusBar>
 #include <QTextDocument>
-#include <QThread>
 #include <QToolBar>
 #include "add_item_dialog.hpp"
 #include "app_main_window.hpp"
 #include "buy_book_dialog.hpp"
+#include "catalog_import.hpp"
+#include "cover_store.hpp"
+#include "db_executor.hpp"
+#include "diagnostics_dialog.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+#include "inventory_cache.hpp"
+#include "inventory_table_dialog.hpp"
+#include "live_search.hpp"
+#include "report_journal.hpp"
 #include "search_dialog.hpp"
 #include "report_dialog.hpp"
+#include "report_export.hpp"
 
 AppMainWindow::AppMainWindow(QWidget *parent) : QMainWindow(parent),
     workspace( new QMdiArea )
@@ -33,42 +48,107 @@ AppMainWindow::AppMainWindow(QWidget *parent) : QMainWindow(parent),
     CreateMenus();
     CreateToolbars();
 
+    queueDepthLabel = new QLabel;
+    statusBar()->addPermanentWidget( queueDepthLabel );
+    // reports whose dialog was closed while they were generated are announced here
+    QObject::connect( &ReportExporter::Instance(), SIGNAL(backgroundJobFinished(quint64,bool,QString)), this,
+                      SLOT(onBackgroundReportFinished(quint64,bool,QString)) );
+    QObject::connect( &CatalogImporter::Instance(), SIGNAL(progress(qint64,qint64,double)), this,
+                      SLOT(onCatalogImportProgress(qint64,qint64,double)) );
+    QObject::connect( &CatalogImporter::Instance(), SIGNAL(finished(ImportSummary)), this,
+                      SLOT(onCatalogImportFinished(ImportSummary)) );
+    // only the transitions are announced, the whole set is shown once at startup
+    QObject::connect( &LowStockTracker::Instance(), SIGNAL(stockFell(QList<LowStockItem>)), this,
+                      SLOT(onStockFell(QList<LowStockItem>)) );
+    // browse and search are served from the last run's snapshot while the database starts up
+    InventoryCache::Instance().LoadSnapshot();
     SetupDb();
 }
 
+namespace {
+int const LIVE_RESULT_LIMIT = 20;
+
+using RecordListResult = QueryResult<QList<DatabaseRecordFormat>>;
+using LowStockResult = QueryResult<QList<LowStockItem>>;
+
+// seeds the LowStockTracker, afterwards it is kept up to date without asking the database again
+LowStockResult FindLowStock( QSqlDatabase & database )
+{
+    LowStockResult result {};
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & alert_query = statements.Prepare( database, StatementId::SelectLowStock );
+    if( !statements.Exec( database, StatementId::SelectLowStock, alert_query ) ){
+        result.error = alert_query.lastError().text();
+        return result;
+    }
+    QList<DatabaseRecordFormat> records {};
+    FillRecordFromQuery( records, alert_query );
+    for( DatabaseRecordFormat const & record : records ) result.value.append( MakeLowStockItem( record ) );
+    result.ok = true;
+    return result;
+}
+
+// creates the tables we need( if they do not exist yet ) and looks for books that are low in stock
+LowStockResult CreateTables( QSqlDatabase & database )
+{
+    LowStockResult result {};
+    if( !database.isOpen() ){
+        result.error = database.lastError().text();
+        return result;
+    }
+    if( !StorageBackend::Current().CreateSchema( database, result.error ) ) return result;
+    return FindLowStock( database );
+}
+}
+
 void AppMainWindow::SetupDb()
 {
-    QThread *db_thread = new QThread( this );
-    DBThreadObject *thread_object = new DBThreadObject( &db, data_list );
-    thread_object->moveToThread( db_thread );
-    QObject::connect( db_thread, SIGNAL(started()), thread_object, SLOT(onThreadStarted()) );
-    QObject::connect( thread_object, SIGNAL(completed(int)), this, SLOT( onDbOperationCompleted(int)));
-    QObject::connect( thread_object, SIGNAL(completed(int)), db_thread, SLOT(quit()) );
-    QObject::connect( db_thread, SIGNAL(finished()), db_thread, SLOT(deleteLater()) );
-    db_thread->start();
+    DatabaseExecutor & executor = DatabaseExecutor::Instance();
+    QObject::connect( &executor, SIGNAL(queueDepthChanged(int)), this, SLOT(onQueueDepthChanged(int)),
+                      Qt::UniqueConnection );
+
+    executor.Submit( QueryPriority::Interactive, this, CreateTables, [this]( LowStockResult result ){
+        if( !result.ok ){
+            // the pool reconnects on its own, so give the server a chance to come back
+            qDebug() << result.error;
+            if( QMessageBox::critical( this, "Database error", "Something is wrong with the database",
+                                       QMessageBox::Retry | QMessageBox::Close ) == QMessageBox::Retry ){
+                SetupDb();
+                return;
+            }
+            std::exit( -1 );
+        }
+        // the reports table exists now, replay whatever the last run left in the journal
+        ReportJournal::Instance().Start();
+        LowStockTracker::Instance().Seed( result.value );
+        AnnounceLowStock( LowStockTracker::Instance().Items() );
+        InventoryCache::Instance().Load();
+        CoverStore::Instance().StartGarbageCollection();
+        this->statusBar()->showMessage( "Done" );
+    });
+}
+
+void AppMainWindow::onQueueDepthChanged( int depth )
+{
+    queueDepthLabel->setText( depth > 0 ? tr( "Pending queries: %1" ).arg( depth ) : QString() );
+    queueDepthLabel->setToolTip( StatementCache::Summary() );
 }
 
-void AppMainWindow::AnnounceLowStock()
+void AppMainWindow::onStockFell( QList<LowStockItem> const & items )
 {
-    if( !data_list.isEmpty() ){
+    AnnounceLowStock( items );
+}
+
+void AppMainWindow::AnnounceLowStock( QList<LowStockItem> const & items )
+{
+    if( !items.isEmpty() ){
         QString alert_string{ "The following books are getting low in stock\r\n\r\n" };
-        for( auto const & str : data_list ){
+        for( auto const & str : items ){
             alert_string += str.book_title + tr( " by %1 ( %2 left )\r\n" ).arg( str.author_name )
-                    .arg( str.quantity );
+                    .arg( str.stock );
         }
         QMessageBox::information( this, "Low stock", alert_string, QMessageBox::Ok );
     }
-    data_list.clear();
-}
-
-void AppMainWindow::onDbOperationCompleted( int status )
-{
-    if(status != 0 ){
-        QMessageBox::critical( this, "Database error", "Something is wrong with the database", QMessageBox::Ok);
-        std::exit( status );
-    }
-    AnnounceLowStock();
-    this->statusBar()->showMessage( "Done" );
 }
 
 /// create action objects that carry out our operations, set their shortcuts etc
@@ -93,11 +173,21 @@ void AppMainWindow::CreateActions()
     addStockAction->setStatusTip( tr( "Add new book to the inventory." ) );
     QObject::connect( addStockAction, SIGNAL(triggered(bool)), this, SLOT( onAddStockActionTriggered()) );
 
+    importCatalogAction = new QAction( QIcon( ":/new/icons/icons/add.png" ), tr( "Import Catalog..." ) );
+    importCatalogAction->setShortcut( tr( "Ctrl+I" ) );
+    importCatalogAction->setStatusTip( tr( "Add the books of a supplier's catalog( CSV ) to the inventory." ) );
+    QObject::connect( importCatalogAction, SIGNAL(triggered(bool)), this, SLOT(onImportCatalogTriggered()) );
+
     viewInventoryAction = new QAction( QIcon( ":/new/icons/icons/about.png"), tr( "View all Records") );
     viewInventoryAction->setShortcut( tr( "Ctrl+O" ) );
     viewInventoryAction->setStatusTip( tr( "Show all available records" ));
     QObject::connect( viewInventoryAction, SIGNAL(triggered(bool)), this, SLOT(onViewInventoryTriggered()) );
 
+    browseInventoryAction = new QAction( QIcon( ":/new/icons/icons/search.png"), tr( "Browse Inventory") );
+    browseInventoryAction->setShortcut( tr( "Ctrl+B" ) );
+    browseInventoryAction->setStatusTip( tr( "Browse, sort and filter the inventory in a table" ));
+    QObject::connect( browseInventoryAction, SIGNAL(triggered(bool)), this, SLOT(onBrowseInventoryTriggered()) );
+
     removeStockAction = new QAction( QIcon( ":/new/icons/icons/remove.png" ), tr( "Remove" ) );
     removeStockAction->setShortcut( tr( "Ctrl+D") );
     removeStockAction->setStatusTip( tr( "Remove book(s)from the inventory.") );
@@ -145,7 +235,9 @@ void AppMainWindow::CreateMenus()
     actionsMenu = this->menuBar()->addMenu( tr( "Actions" ) );
     actionsMenu->addAction( buyBookAction );
     actionsMenu->addAction( addStockAction );
+    actionsMenu->addAction( importCatalogAction );
     actionsMenu->addAction( viewInventoryAction );
+    actionsMenu->addAction( browseInventoryAction );
     actionsMenu->addAction( searchAction );
     actionsMenu->addAction( removeStockAction );
     actionsMenu->addAction( updateStockAction );
@@ -163,12 +255,33 @@ void AppMainWindow::CreateToolbars()
     searchToolbar->setLayoutDirection( Qt::RightToLeft );
     searchToolbar->addWidget( searchEdit );
 
+    // live results as the user types, see LiveSearch
+    liveSearch = new LiveSearch( this );
+    liveSearch->SetResultLimit( LIVE_RESULT_LIMIT );
+    searchResultsModel = new QStandardItemModel( this );
+    searchCompleter = new QCompleter( searchResultsModel, this );
+    searchCompleter->setCompletionMode( QCompleter::UnfilteredPopupCompletion );
+    searchCompleter->setWidget( searchEdit );
+
+    // hidden debug overlay with the keystroke-to-results latency
+    searchLatencyOverlay = new QLabel( this );
+    searchLatencyOverlay->setAttribute( Qt::WA_TransparentForMouseEvents );
+    searchLatencyOverlay->setStyleSheet( "background-color: rgba( 0, 0, 0, 160 ); color: white; padding: 4px;" );
+    searchLatencyOverlay->hide();
+    QShortcut *overlayShortcut = new QShortcut( QKeySequence( tr( "Ctrl+Shift+L" ) ), this );
+    QObject::connect( overlayShortcut, SIGNAL(activated()), this, SLOT(onToggleSearchLatencyOverlay()) );
+    // hidden too, the slowest statements( see QueryTracer )
+    QShortcut *diagnosticsShortcut = new QShortcut( QKeySequence( tr( "Ctrl+Shift+D" ) ), this );
+    QObject::connect( diagnosticsShortcut, SIGNAL(activated()), this, SLOT(onShowDiagnostics()) );
+
     toolbar->addAction( buyBookAction );
     toolbar->addSeparator();
     toolbar->addAction( addStockAction );
     toolbar->addSeparator();
     toolbar->addAction( viewInventoryAction );
     toolbar->addSeparator();
+    toolbar->addAction( browseInventoryAction );
+    toolbar->addSeparator();
     toolbar->addAction( generateReportAction );
     toolbar->addSeparator();
     toolbar->addAction( updateStockAction );
@@ -177,6 +290,64 @@ void AppMainWindow::CreateToolbars()
 
     QObject::connect( searchAction, SIGNAL( triggered( bool ) ), searchEdit, SLOT( setFocus() ) );
     QObject::connect( searchEdit, SIGNAL( returnPressed() ), this, SLOT( onSearchButtonEntered() ) );
+    QObject::connect( searchEdit, SIGNAL( textChanged(QString) ), liveSearch, SLOT( onTextChanged(QString) ) );
+    QObject::connect( liveSearch, SIGNAL( resultsReady(QString,QList<DatabaseRecordFormat>) ), this,
+                      SLOT( onLiveResultsReady(QString,QList<DatabaseRecordFormat>) ) );
+    QObject::connect( liveSearch, SIGNAL( latencyChanged() ), this, SLOT( onSearchLatencyChanged() ) );
+    QObject::connect( searchCompleter, SIGNAL( activated(QModelIndex) ), this,
+                      SLOT( onLiveResultActivated(QModelIndex) ) );
+}
+
+void AppMainWindow::onLiveResultsReady( QString const &, QList<DatabaseRecordFormat> const & results )
+{
+    searchResultsModel->clear();
+    live_results = results;
+    for( DatabaseRecordFormat const & record : live_results ){
+        searchResultsModel->appendRow( new QStandardItem( tr( "%1 by %2 ( %3 left )" ).arg( record.book_title )
+                                                          .arg( record.author_name ).arg( record.quantity ) ) );
+    }
+    if( live_results.isEmpty() || !searchEdit->hasFocus() ){
+        searchCompleter->popup()->hide();
+    } else {
+        searchCompleter->complete();
+    }
+}
+
+void AppMainWindow::onToggleSearchLatencyOverlay()
+{
+    searchLatencyOverlay->setVisible( !searchLatencyOverlay->isVisible() );
+    onSearchLatencyChanged();
+}
+
+void AppMainWindow::onShowDiagnostics()
+{
+    DiagnosticsDialog *diagnosticsDialog { new DiagnosticsDialog( this ) };
+    diagnosticsDialog->setAttribute( Qt::WA_DeleteOnClose );
+    diagnosticsDialog->show(); // modeless, to watch the statements while using the till
+}
+
+void AppMainWindow::onSearchLatencyChanged()
+{
+    if( !searchLatencyOverlay->isVisible() ) return;
+    auto const as_ms = []( qint64 microseconds ){
+        return microseconds < 0 ? QString( "-" ) : QString::number( microseconds / 1000.0, 'f', 2 );
+    };
+    searchLatencyOverlay->setText( tr( "search latency p50 %1 ms, p99 %2 ms ( %3 samples, %4 ms debounce )" )
+                                   .arg( as_ms( liveSearch->LatencyPercentile( 50 ) ) )
+                                   .arg( as_ms( liveSearch->LatencyPercentile( 99 ) ) )
+                                   .arg( liveSearch->LatencySampleCount() ).arg( liveSearch->DebounceInterval() ) );
+    searchLatencyOverlay->adjustSize();
+    searchLatencyOverlay->move( width() - searchLatencyOverlay->width() - 10,
+                                height() - statusBar()->height() - searchLatencyOverlay->height() - 10 );
+    searchLatencyOverlay->raise();
+}
+
+void AppMainWindow::onLiveResultActivated( QModelIndex const & index )
+{
+    if( index.row() < 0 || index.row() >= live_results.size() ) return;
+    ViewInventoryDialog *inventoryDialog = new ViewInventoryDialog( ActionType::View, this );
+    inventoryDialog->SetDataList( { live_results.at( index.row() ) } );
+    inventoryDialog->exec();
 }
 
 void AppMainWindow::closeEvent( QCloseEvent *event )
@@ -185,6 +356,8 @@ void AppMainWindow::closeEvent( QCloseEvent *event )
                               QMessageBox::Yes | QMessageBox::No ) == QMessageBox::Yes )
     {
         workspace->closeAllSubWindows();
+        // keeps what was written through since the last sync, the next start catches up from there
+        InventoryCache::Instance().SaveSnapshot();
         event->accept();
     } else {
         event->ignore();
@@ -197,167 +370,180 @@ void AppMainWindow::onAddStockActionTriggered()
     dialog->exec();
 }
 
-void AppMainWindow::onSearchButtonEntered()
+void AppMainWindow::onImportCatalogTriggered()
 {
-    searchEdit->clearFocus();
-    auto data_list = PerformTextSearch( searchEdit->text() );
-    if( data_list.isEmpty() ){
-        QMessageBox::information( this, "Search", tr( "No result found" ), QMessageBox::Ok );
+    CatalogImporter & importer = CatalogImporter::Instance();
+    if( importer.IsRunning() ){
+        QMessageBox::information( this, "Import", tr( "An import is already running" ), QMessageBox::Ok );
         return;
     }
-
-    ViewInventoryDialog *inventoryDialog = new ViewInventoryDialog( ActionType::View, this );
-    inventoryDialog->SetDataList( std::move( data_list ));
-    inventoryDialog->exec();
-}
-
-QList<DatabaseRecordFormat> AppMainWindow::PerformTextSearch( QString const & text )
-{
-    SearchDialog *searchDialog = new SearchDialog( text, this );
-    if( searchDialog->exec() != QDialog::Accepted ) return {};
-
-    QSqlQuery searchQuery;
-    searchQuery.prepare( tr( "SELECT * FROM inventory WHERE MATCH ( book_title, author_name ) "
-                         "AGAINST ( ' %1 %2 ' IN NATURAL LANGUAGE MODE )" )
-                         .arg( searchDialog->GetBookTitle() )
-                         .arg( searchDialog->GetAuthorName() ) );
-
-    if( !searchQuery.exec() ){
-        qDebug() << searchQuery.lastError();
-        QMessageBox::warning( this, "Search", "There was a problem executing the instructions "
-                                              "necessary for the search", QMessageBox::Ok );
-        return {};
+    QString const filename = QFileDialog::getOpenFileName( this, tr( "Import catalog" ), QString(),
+                                                           tr( "Catalog files(*.csv *.tsv *.txt)" ) );
+    if( filename.isEmpty() ) return;
+
+    QString cover_directory {};
+    if( QMessageBox::question( this, "Import", tr( "Attach the covers named in the catalog's \"cover\" column?" ),
+                               QMessageBox::Yes | QMessageBox::No ) == QMessageBox::Yes ){
+        cover_directory = QFileDialog::getExistingDirectory( this, tr( "Cover directory" ) );
     }
-    QList<DatabaseRecordFormat> data_list {};
-    FillRecordFromQuery( data_list, searchQuery );
-    return data_list;
+    importer.Start( filename, cover_directory );
+    statusBar()->showMessage( tr( "Importing %1..." ).arg( filename ) );
 }
 
-void AppMainWindow::onViewInventoryTriggered()
+void AppMainWindow::onCatalogImportProgress( qint64 rows_done, qint64 rows_total, double rows_per_second )
 {
-    ViewInventoryDialog *allRecordsDialog { new ViewInventoryDialog( ActionType::View, this ) };
-    allRecordsDialog->CheckDatabaseRecord();
-    allRecordsDialog->exec();
+    statusBar()->showMessage( tr( "Importing: %1 of %2 row(s), %3 rows/s" ).arg( rows_done ).arg( rows_total )
+                              .arg( rows_per_second, 0, 'f', 0 ) );
 }
 
-void AppMainWindow::onRemoveStockTriggered()
+void AppMainWindow::onCatalogImportFinished( ImportSummary const & summary )
 {
-    data_list = PerformTextSearch( "" );
-    if( data_list.isEmpty() ){
-        QMessageBox::information( this, "Remove", "No record found", QMessageBox::Ok );
+    statusBar()->showMessage( tr( "Import finished" ), 10000 );
+    QApplication::alert( this );
+    if( !summary.error.isEmpty() && summary.rows_read == 0 ){
+        QMessageBox::critical( this, "Import", tr( "Unable to import %1\n%2" ).arg( summary.filename )
+                               .arg( summary.error ) );
+        return;
+    }
+    QString message = tr( "%1 of %2 book(s) imported( %3 with covers ) in %4 s, %5 rows/s. Parsing took %6 s." )
+            .arg( summary.rows_imported ).arg( summary.rows_read ).arg( summary.covers_attached )
+            .arg( summary.total_msecs / 1000.0, 0, 'f', 1 ).arg( summary.rows_per_second, 0, 'f', 0 )
+            .arg( summary.parse_msecs / 1000.0, 0, 'f', 1 );
+    if( summary.rows_failed == 0 ){
+        QMessageBox::information( this, "Import", message );
         return;
     }
-    ViewInventoryDialog *deleteDialog = new ViewInventoryDialog( ActionType::Delete, this );
-    deleteDialog->SetDataList( std::move( data_list ));
-    deleteDialog->exec();
+    message += summary.error_filename.isEmpty() ?
+                tr( "\n%1 row(s) failed, the error file could not be written." ).arg( summary.rows_failed ) :
+                tr( "\n%1 row(s) failed, see %2" ).arg( summary.rows_failed ).arg( summary.error_filename );
+    QMessageBox::warning( this, "Import", message );
 }
 
-void AppMainWindow::onUpdateStockTriggered()
+void AppMainWindow::onSearchButtonEntered()
 {
-    data_list = PerformTextSearch( "" );
-    if( data_list.isEmpty() ){
-        QMessageBox::information( this, "Update", "No record found", QMessageBox::Ok );
-        return;
-    }
-    ViewInventoryDialog *updateDialog = new ViewInventoryDialog( ActionType::Update, this );
-    updateDialog->SetDataList( std::move( data_list ));
-    updateDialog->exec();
-    CheckForLowStock();
+    searchEdit->clearFocus();
+    searchCompleter->popup()->hide();
+    if( searchEdit->text().trimmed().isEmpty() ) return;
+    SearchInventory( searchEdit->text(), [this]( QList<DatabaseRecordFormat> data_list ){
+        if( data_list.isEmpty() ){
+            QMessageBox::information( this, "Search", tr( "No result found" ), QMessageBox::Ok );
+            return;
+        }
+
+        ViewInventoryDialog *inventoryDialog = new ViewInventoryDialog( ActionType::View, this );
+        inventoryDialog->SetDataList( std::move( data_list ));
+        inventoryDialog->exec();
+    });
 }
 
-void AppMainWindow::CheckForLowStock()
+void AppMainWindow::PerformTextSearch( QString const & text,
+                                       std::function<void( QList<DatabaseRecordFormat> )> on_found )
 {
-    QSqlQuery alert_query( "SELECT * FROM inventory WHERE stock < 5" );
-    if( !alert_query.exec() ){
-        qDebug() << alert_query.lastError();
+    SearchDialog *searchDialog = new SearchDialog( text, this );
+    if( searchDialog->exec() != QDialog::Accepted ) return;
+
+    SearchInventory( searchDialog->GetBookTitle() + " " + searchDialog->GetAuthorName(), on_found );
+}
+
+void AppMainWindow::SearchInventory( QString const & terms,
+                                     std::function<void( QList<DatabaseRecordFormat> )> on_found )
+{
+    QList<DatabaseRecordFormat> cached_results {};
+    if( InventoryCache::Instance().Search( terms, cached_results ) ){
+        on_found( std::move( cached_results ) );
         return;
     }
 
-    FillRecordFromQuery( data_list, alert_query );
-    AnnounceLowStock();
+    DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this,
+                                         [terms]( QSqlDatabase & database )
+    {
+        RecordListResult result {};
+        StatementCache & statements = StatementCache::ForThread();
+        QSqlQuery & searchQuery = statements.Prepare( database, StatementId::SearchInventory );
+        searchQuery.bindValue( ":terms", StatementCache::SearchTerms( terms ) );
+        if( !statements.Exec( database, StatementId::SearchInventory, searchQuery ) ){
+            result.error = searchQuery.lastError().text();
+            return result;
+        }
+        FillRecordFromQuery( result.value, searchQuery );
+        result.ok = true;
+        return result;
+    }, [this, on_found]( RecordListResult result ){
+        if( !result.ok ){
+            qDebug() << result.error;
+            QMessageBox::warning( this, "Search", "There was a problem executing the instructions "
+                                                  "necessary for the search", QMessageBox::Ok );
+            return;
+        }
+        on_found( std::move( result.value ) );
+    });
 }
 
-void AppMainWindow::onGenerateReportTriggered()
+void AppMainWindow::onViewInventoryTriggered()
 {
-    ReportDialog *report_dialog = new ReportDialog( this );
-    report_dialog->exec();
+    ViewInventoryDialog *allRecordsDialog { new ViewInventoryDialog( ActionType::View, this ) };
+    allRecordsDialog->CheckDatabaseRecord();
+    allRecordsDialog->exec();
 }
 
-DBThreadObject::DBThreadObject(QSqlDatabase *db, QList<DatabaseRecordFormat> &list, QObject *parent )
-    : QObject( parent ), database{ db }, records{ list }{
+void AppMainWindow::onBrowseInventoryTriggered()
+{
+    InventoryTableDialog *tableDialog { new InventoryTableDialog( this ) };
+    tableDialog->exec();
 }
 
-void DBThreadObject::onThreadStarted()
+void AppMainWindow::onRemoveStockTriggered()
 {
-    SetupDb();
+    PerformTextSearch( "", [this]( QList<DatabaseRecordFormat> data_list ){
+        if( data_list.isEmpty() ){
+            QMessageBox::information( this, "Remove", "No record found", QMessageBox::Ok );
+            return;
+        }
+        ViewInventoryDialog *deleteDialog = new ViewInventoryDialog( ActionType::Delete, this );
+        deleteDialog->SetDataList( std::move( data_list ));
+        deleteDialog->exec();
+    });
 }
 
-void DBThreadObject::SetupDb()
+void AppMainWindow::onUpdateStockTriggered()
 {
-    // setting up the database, we use 'localhost' since we're running the code on our local machine
-    *database = QSqlDatabase::addDatabase( "QMYSQL" );
-    database->setHostName( tr( "localhost" ) );
-    database->setDatabaseName( tr( "debug_db" ) );
-    database->setUserName( tr( "iamScope" ) );
-    database->setPassword( tr( "scope" ) );
-
-    // we open the connection to the db, if it fails, then we have nothing to work with --> quit!
-    if( !database->open() ){
-        qDebug() << database->lastError();
-        emit completed( -1 );
-        return;
-    }
-
-    // create the database's table we need
-    QSqlQuery create_table_query {};
-    create_table_query.prepare( tr( "CREATE TABLE IF NOT EXISTS %1 ( "
-                                    "serial_number INTEGER AUTO_INCREMENT PRIMARY KEY, "
-                                    "book_title TEXT,"
-                                    "author_name TEXT,"
-                                    "publisher TEXT, date_time DATETIME, "
-                                    "stock INTEGER NOT NULL, price DOUBLE, "
-                                    "location TEXT, "
-                                    "book_cover BLOB, FULLTEXT( book_title, author_name ) "
-                                    ") ENGINE=InnoDB"
-                                    "" ).arg( AddItemDialog::TABLE_NAME ));
-    // we execute the query to create the table, if it fails, we quit!
-    if( !create_table_query.exec() ){
-        qDebug() << database->lastError();
-        emit completed( -1 );
-        return;
-    }
-
-    QSqlQuery report_query {};
-    report_query.prepare( tr( "CREATE TABLE IF NOT EXISTS reports ( "
-                              "serial_number INTEGER AUTO_INCREMENT PRIMARY KEY,"
-                              "book_title TEXT, author_name TEXT, stock INTEGER NOT NULL, "
-                              "price DOUBLE, total DOUBLE, date_performed DATETIME, "
-                              "transaction_type INTEGER ) "));
+    PerformTextSearch( "", [this]( QList<DatabaseRecordFormat> data_list ){
+        if( data_list.isEmpty() ){
+            QMessageBox::information( this, "Update", "No record found", QMessageBox::Ok );
+            return;
+        }
+        ViewInventoryDialog *updateDialog = new ViewInventoryDialog( ActionType::Update, this );
+        updateDialog->SetDataList( std::move( data_list ));
+        updateDialog->exec();
+    });
+}
 
-    if( !report_query.exec() ){
-        qDebug() << database->lastError();
-        emit completed( -1 );
-        return;
-    }
+void AppMainWindow::onGenerateReportTriggered()
+{
+    ReportDialog *report_dialog = new ReportDialog( this );
+    report_dialog->setAttribute( Qt::WA_DeleteOnClose );
+    report_dialog->exec();
+}
 
-    QSqlQuery alert_query{ "SELECT * FROM inventory WHERE stock < 5" };
-    if( !alert_query.exec() ){
-        qDebug() << alert_query.lastError();
-        emit completed( -1 );
+void AppMainWindow::onBackgroundReportFinished( quint64, bool ok, QString const & message )
+{
+    statusBar()->showMessage( message, 10000 );
+    QApplication::alert( this );
+    if( ok ){
+        QMessageBox::information( this, "Report", message );
+    } else {
+        QMessageBox::critical( this, "Report", message );
     }
-
-    FillRecordFromQuery( records, alert_query );
-    emit completed( 0 );
 }
 
 void AppMainWindow::onBuyBookActionTriggered()
 {
-    auto list = PerformTextSearch( "" );
-    if( list.isEmpty() ){
-        QMessageBox::information( this, "Purchase", "No item found" );
-        return;
-    }
-    BuyBookDialog *buy_book_dialog = new BuyBookDialog( std::move( list ), this );
-    buy_book_dialog->exec();
-    CheckForLowStock();
+    PerformTextSearch( "", [this]( QList<DatabaseRecordFormat> list ){
+        if( list.isEmpty() ){
+            QMessageBox::information( this, "Purchase", "No item found" );
+            return;
+        }
+        BuyBookDialog *buy_book_dialog = new BuyBookDialog( std::move( list ), this );
+        buy_book_dialog->exec();
+    });
 }
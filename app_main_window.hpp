@@ -3,10 +3,18 @@
 
 #include <QMainWindow>
 #include <QLineEdit>
-#include <QSqlDatabase>
+#include <QLabel>
 #include <QMdiArea>
 #include <QAction>
+#include <QModelIndex>
+#include <functional>
 #include "view_inventory_dialog.hpp"
+#include "low_stock_tracker.hpp"
+#include "catalog_import.hpp"
+
+class LiveSearch;
+class QCompleter;
+class QStandardItemModel;
 
 class AppMainWindow : public QMainWindow
 {
@@ -16,14 +24,25 @@ public:
 signals:
 private slots:
     void onAddStockActionTriggered();
+    void onImportCatalogTriggered();
+    void onCatalogImportProgress( qint64 rows_done, qint64 rows_total, double rows_per_second );
+    void onCatalogImportFinished( ImportSummary const & summary );
     void onViewInventoryTriggered();
+    void onBrowseInventoryTriggered();
     void onRemoveStockTriggered();
     void onUpdateStockTriggered();
     void onSearchButtonEntered();
     void onGenerateReportTriggered();
     void onBuyBookActionTriggered();
     void showHelp();
-    void onDbOperationCompleted(int);
+    void onQueueDepthChanged( int );
+    void onBackgroundReportFinished( quint64 export_id, bool ok, QString const & message );
+    void onStockFell( QList<LowStockItem> const & items );
+    void onLiveResultsReady( QString const & text, QList<DatabaseRecordFormat> const & results );
+    void onToggleSearchLatencyOverlay();
+    void onShowDiagnostics();
+    void onSearchLatencyChanged();
+    void onLiveResultActivated( QModelIndex const & index );
 protected:
     void closeEvent( QCloseEvent *event ) override;
 private:
@@ -31,39 +50,29 @@ private:
     void CreateActions();
     void CreateMenus();
     void CreateToolbars();
-    void CheckForLowStock();
-    void AnnounceLowStock();
-    QList<DatabaseRecordFormat> PerformTextSearch( QString const & );
+    void AnnounceLowStock( QList<LowStockItem> const & items );
+    void PerformTextSearch( QString const &, std::function<void( QList<DatabaseRecordFormat> )> on_found );
+    void SearchInventory( QString const & terms, std::function<void( QList<DatabaseRecordFormat> )> on_found );
 private:
-    QSqlDatabase db;
-    QList<DatabaseRecordFormat> data_list;
     QMdiArea   *workspace;
 
     QAction *logoutAction;
     QAction *searchAction;
     QAction *viewInventoryAction;
+    QAction *browseInventoryAction;
     QAction *addStockAction;
+    QAction *importCatalogAction;
     QAction *removeStockAction;
     QAction *updateStockAction;
     QAction *generateReportAction;
     QAction *buyBookAction;
     QLineEdit *searchEdit;
-};
-
-class DBThreadObject : public QObject
-{
-    Q_OBJECT
-
-public slots:
-    void onThreadStarted();
-signals:
-    void completed( int );
-private:
-    QSqlDatabase *database;
-    QList<DatabaseRecordFormat> &records;
-    void SetupDb();
-public:
-    DBThreadObject( QSqlDatabase *db, QList<DatabaseRecordFormat> & data_list, QObject *parent = nullptr );
+    QLabel    *queueDepthLabel;
+    LiveSearch          *liveSearch;
+    QLabel              *searchLatencyOverlay;
+    QCompleter          *searchCompleter;
+    QStandardItemModel  *searchResultsModel;
+    QList<DatabaseRecordFormat> live_results; // rows of searchResultsModel
 };
 
 #endif // APP_MAIN_WINDOW_HPP
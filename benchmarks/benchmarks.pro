@@ -0,0 +1,17 @@
+# QBENCHMARK suite over the application's own sources, see inventory_benchmarks.cpp for the
+# settings. Build it on its own: qmake benchmarks/benchmarks.pro && make && ./benchmarks
+
+QT       += core gui sql printsupport concurrent testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = benchmarks
+TEMPLATE = app
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include( ../BookManagement.pri )
+
+SOURCES += inventory_benchmarks.cpp
@@ -0,0 +1,675 @@
+#include <QDir>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPrinter>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QTemporaryDir>
+#include <QTextDocument>
+#include <QtTest>
+#include <atomic>
+#include <memory>
+#include <random>
+#include "checkout.hpp"
+#include "connection_pool.hpp"
+#include "connection_settings.hpp"
+#include "inventory_cache.hpp"
+#include "inventory_snapshot.hpp"
+#include "low_stock_tracker.hpp"
+#include "report_dialog.hpp"
+#include "report_export.hpp"
+#include "resources.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+
+// times the application's hot paths against a seeded database and writes the results as JSON.
+// Everything is configured through the environment, so a release build can run it unattended:
+//  PHOEBE_BENCH_BACKEND          sqlite( the default ) or mysql
+//  PHOEBE_BENCH_DATABASE         the SQLite file or the MySQL database to seed. Never the shop's own,
+//                                it is emptied whenever it does not hold what the settings below ask for
+//  PHOEBE_BENCH_BOOKS            books to seed, 1000 to 1000000( 1000 by default )
+//  PHOEBE_BENCH_REPORT_YEARS     years of reports to seed( 2 by default )
+//  PHOEBE_BENCH_REPORTS_PER_DAY  100 by default
+//  PHOEBE_BENCH_JSON             where the results go, benchmarks.json by default
+// The MySQL server and its credentials are the application's( mysql/host and so on ).
+
+namespace {
+int const BOOKS_PER_INSERT = 100;
+int const ROWS_PER_TRANSACTION = 10000;
+unsigned int const SEEDED_STOCK = 1000000; // enough that no purchase ever runs out
+
+QStringList const TITLE_WORDS {
+    "river", "shadow", "garden", "winter", "empire", "silent", "golden", "journey", "stone", "harbour",
+    "letters", "forest", "kingdom", "midnight", "island", "memory", "mountain", "secret", "summer", "voyage",
+    "crown", "desert", "echo", "feather", "glass", "history", "iron", "lantern", "mirror", "north",
+    "ocean", "paper", "quiet", "rain", "salt", "thunder", "valley", "wild", "bridge", "city",
+    "dawn", "fire", "harvest", "light", "market", "night", "orchard", "storm"
+};
+QStringList const FIRST_NAMES {
+    "Ada", "Chinua", "Wole", "Jane", "Ngozi", "Leo", "Toni", "Gabriel", "Ama", "Yaa", "Ben", "Flora"
+};
+QStringList const LAST_NAMES {
+    "Achebe", "Soyinka", "Austen", "Adichie", "Tolstoy", "Morrison", "Marquez", "Aidoo", "Gyasi", "Okri",
+    "Nwapa", "Emecheta"
+};
+
+int EnvironmentInt( char const *name, int default_value )
+{
+    bool is_number = false;
+    int const value = qEnvironmentVariableIntValue( name, &is_number );
+    return is_number ? value : default_value;
+}
+
+QString EnvironmentString( char const *name, QString const & default_value )
+{
+    return qEnvironmentVariableIsSet( name ) ? QString::fromLocal8Bit( qgetenv( name ) ) : default_value;
+}
+
+// counts what QBENCHMARK runs( its calibration runs included ) and how long that took
+struct IterationTimer
+{
+    IterationTimer() { elapsed.start(); }
+    void Tick() { ++iterations; }
+
+    QElapsedTimer   elapsed;
+    qint64          iterations = 0;
+};
+
+// the decoders as they were before TableSchema: every value looked up by name on a copied QSqlRecord
+void FillRecordsByName( QList<DatabaseRecordFormat> & list, QSqlQuery & query )
+{
+    QSqlRecord record {};
+    while( query.next() ){
+        record = query.record();
+        DatabaseRecordFormat data {};
+        data.serial_number = record.value( "serial_number" ).toUInt();
+        data.quantity = record.value( "stock" ).toUInt();
+        data.price = record.value( "price" ).toDouble();
+        data.book_title = record.value( "book_title" ).toString();
+        data.author_name = record.value( "author_name" ).toString();
+        data.publisher = record.value( "publisher" ).toString();
+        data.date_time_added = record.value( "date_time" ).toDateTime();
+        data.location = record.value( "location" ).toString();
+        data.low_stock_threshold = record.value( "low_stock_threshold" ).toUInt();
+        data.cover_hash = record.value( "cover_hash" ).toString();
+        list.append( data );
+    }
+}
+
+void FillReportsByName( QList<ReportFormat> & list, QSqlQuery & query )
+{
+    QSqlRecord record {};
+    while( query.next() ){
+        record = query.record();
+        ReportFormat data {};
+        data.serial_number = record.value( "serial_number" ).toUInt();
+        data.quantity = record.value( "stock" ).toInt();
+        data.price = record.value( "price" ).toDouble();
+        data.total = record.value( "total" ).toDouble();
+        data.book_title = record.value( "book_title" ).toString();
+        data.author_name = record.value( "author_name" ).toString();
+        data.date_time_added = record.value( "date_performed" ).toDateTime();
+        data.detail = static_cast<ReportActionType>( record.value( "transaction_type" ).toInt() );
+        list.append( data );
+    }
+}
+
+// the PDF as it was written before PdfReportRenderer: every row into one HTML table, laid out and
+// printed by a QTextDocument
+qint64 PrintReportAsHtml( QSqlQuery & query, QString const & title, QString const & filename )
+{
+    QList<ReportFormat> data_list {};
+    FillReportFromQuery( data_list, query );
+    QString pdf_string( QString( "<div align=\"center\"><big>Bookshop Report( %1 )</big><br><br><br>"
+                                 "<table border = \"1\"><tr>"
+                                 "<th>Title</th>"
+                                 "<th>Author</th>"
+                                 "<th>Quantity</th>"
+                                 "<th>Price</th>"
+                                 "<th>Total</th>"
+                                 "<th>Transaction</th>"
+                                 "<th>Date</th></tr>" ).arg( title ) );
+    for( auto const & data: data_list ){
+        pdf_string += ( "<tr><td>" + data.book_title + "</td><td>" + data.author_name +
+                        "</td><td>" + QString::number( data.quantity ) + "</td>" +
+                        "<td>" + QString::number( data.price ) + "</td>" +
+                        "<td>" + QString::number( data.total ) + "</td><td>" +
+                        Stringify( data.detail ) + "</td><td>" + data.date_time_added.toString() +
+                        "</td></tr>");
+    }
+    pdf_string += "</table></div>";
+
+    QPrinter printer( QPrinter::PrinterResolution );
+    printer.setOutputFormat( QPrinter::PdfFormat );
+    printer.setPaperSize( QPrinter::A4 );
+    printer.setOutputFileName( filename );
+
+    QTextDocument htmlDoc {};
+    htmlDoc.setHtml( pdf_string );
+    htmlDoc.setPageSize( printer.pageRect().size() );
+    htmlDoc.print( &printer );
+    return data_list.size();
+}
+}
+
+class InventoryBenchmarks : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void decodeRecords_data();
+    void decodeRecords();
+    void decodeReports_data();
+    void decodeReports();
+    void search_data();
+    void search();
+    void coldStart();
+    void cacheSearch_data();
+    void cacheSearch();
+    void snapshotRead();
+    void purchase_data();
+    void purchase();
+    void update();
+    void reportQuery_data();
+    void reportQuery();
+    void exportCsv();
+    void exportPdf_data();
+    void exportPdf();
+private:
+    bool Exec( QString const & statement, QString & error );
+    bool IsSeeded();
+    bool Seed( QString & error );
+    DatabaseRecordFormat MakeBook( QDateTime const & now );
+    ReportFormat MakeReport( QDateTime const & date_time );
+    QString Pick( QStringList const & words );
+    unsigned int RandomSerialNumber();
+    void Record( IterationTimer const & timer, qint64 rows );
+    void Record( qint64 iterations, double msecs_per_iteration, qint64 rows );
+private:
+    QSqlDatabase    database;
+    QTemporaryDir   output_directory;
+    std::mt19937    random{ 20170603 };
+    int             book_count = 0;
+    int             report_years = 0;
+    int             reports_per_day = 0;
+    qint64          report_count = 0;
+    unsigned int    first_serial_number = 0;
+    unsigned int    last_serial_number = 0;
+    QJsonArray      results;
+};
+
+void InventoryBenchmarks::initTestCase()
+{
+    // covers, the report journal and the snapshot stay apart from the application's
+    QCoreApplication::setOrganizationName( "Phoebe" );
+    QCoreApplication::setApplicationName( "BookManagerBenchmarks" );
+
+    book_count = qBound( 1000, EnvironmentInt( "PHOEBE_BENCH_BOOKS", 1000 ), 1000000 );
+    book_count -= book_count % BOOKS_PER_INSERT;
+    report_years = qMax( 1, EnvironmentInt( "PHOEBE_BENCH_REPORT_YEARS", 2 ) );
+    reports_per_day = qMax( 1, EnvironmentInt( "PHOEBE_BENCH_REPORTS_PER_DAY", 100 ) );
+
+    std::unique_ptr<StorageBackend> backend {};
+    if( EnvironmentString( "PHOEBE_BENCH_BACKEND", "sqlite" ).compare( "mysql", Qt::CaseInsensitive ) == 0 ){
+        backend = std::make_unique<MySqlBackend>( EnvironmentString( "PHOEBE_BENCH_DATABASE", "phoebe_benchmarks" ) );
+    } else {
+        backend = std::make_unique<SqliteBackend>(
+                    EnvironmentString( "PHOEBE_BENCH_DATABASE", QDir::temp().filePath( "phoebe_benchmarks.sqlite3" ) ) );
+    }
+    QVERIFY( StorageBackend::Install( std::move( backend ) ) );
+    QVERIFY( output_directory.isValid() );
+
+    database = ConnectionPool::Instance().Acquire();
+    QVERIFY2( database.isOpen(), qPrintable( database.lastError().text() ) );
+    QString error {};
+    QVERIFY2( StorageBackend::Current().CreateSchema( database, error ), qPrintable( error ) );
+
+    report_count = qint64( report_years ) * 365 * reports_per_day;
+    if( !IsSeeded() ){
+        QElapsedTimer elapsed {};
+        elapsed.start();
+        QVERIFY2( Seed( error ), qPrintable( error ) );
+        qDebug() << "Seeded" << book_count << "books and" << report_count << "reports in" << elapsed.elapsed() << "ms";
+    }
+
+    QSqlQuery range_query{ database };
+    QVERIFY( range_query.exec( "SELECT MIN( serial_number ), MAX( serial_number ) FROM inventory" ) &&
+             range_query.next() );
+    first_serial_number = range_query.value( 0 ).toUInt();
+    last_serial_number = range_query.value( 1 ).toUInt();
+}
+
+void InventoryBenchmarks::cleanupTestCase()
+{
+    StorageBackend const & backend = StorageBackend::Current();
+    QJsonObject run {};
+    run["backend"] = backend.Name();
+    run["database"] = backend.Identity();
+    run["books"] = book_count;
+    run["reports"] = report_count;
+    run["qt_version"] = QString( qVersion() );
+    run["finished_at"] = QDateTime::currentDateTimeUtc().toString( Qt::ISODate );
+    run["results"] = results;
+
+    QSaveFile file{ EnvironmentString( "PHOEBE_BENCH_JSON", "benchmarks.json" ) };
+    if( !file.open( QIODevice::WriteOnly ) || file.write( QJsonDocument( run ).toJson() ) < 0 || !file.commit() ){
+        qWarning() << "Unable to write the results:" << file.errorString();
+    }
+    database = QSqlDatabase();
+    ConnectionPool::Instance().Release();
+}
+
+bool InventoryBenchmarks::Exec( QString const & statement, QString & error )
+{
+    QSqlQuery query{ database };
+    if( !query.exec( statement ) ){
+        error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// what was seeded is recorded once the seed is complete, the purchases add reports of their own
+bool InventoryBenchmarks::IsSeeded()
+{
+    QSqlQuery seed_query{ database };
+    return seed_query.exec( "SELECT books, reports FROM benchmark_seed" ) && seed_query.next() &&
+            seed_query.value( 0 ).toLongLong() == book_count && seed_query.value( 1 ).toLongLong() == report_count;
+}
+
+QString InventoryBenchmarks::Pick( QStringList const & words )
+{
+    return words[ std::uniform_int_distribution<int>( 0, words.size() - 1 )( random ) ];
+}
+
+DatabaseRecordFormat InventoryBenchmarks::MakeBook( QDateTime const & now )
+{
+    DatabaseRecordFormat book {};
+    book.quantity = SEEDED_STOCK;
+    book.price = std::uniform_int_distribution<int>( 500, 25000 )( random ) / 100.0;
+    book.book_title = Pick( TITLE_WORDS ) + " " + Pick( TITLE_WORDS ) + " " + Pick( TITLE_WORDS );
+    book.author_name = Pick( FIRST_NAMES ) + " " + Pick( LAST_NAMES );
+    book.publisher = Pick( LAST_NAMES ) + " Books";
+    book.date_time_added = now;
+    book.location = QString( "Shelf %1" ).arg( std::uniform_int_distribution<int>( 1, 200 )( random ) );
+    book.low_stock_threshold = LowStockTracker::DEFAULT_THRESHOLD;
+    return book;
+}
+
+ReportFormat InventoryBenchmarks::MakeReport( QDateTime const & date_time )
+{
+    // mostly sales, as in a shop
+    int const kind = std::uniform_int_distribution<int>( 0, 99 )( random );
+    ReportFormat report {};
+    report.book_title = Pick( TITLE_WORDS ) + " " + Pick( TITLE_WORDS ) + " " + Pick( TITLE_WORDS );
+    report.author_name = Pick( FIRST_NAMES ) + " " + Pick( LAST_NAMES );
+    report.quantity = std::uniform_int_distribution<int>( 1, 5 )( random );
+    report.price = std::uniform_int_distribution<int>( 500, 25000 )( random ) / 100.0;
+    report.total = report.quantity * report.price;
+    report.date_time_added = date_time;
+    report.detail = kind < 70 ? ReportActionType::SALES : kind < 85 ? ReportActionType::ADDITIONS :
+                    kind < 95 ? ReportActionType::UPDATES : ReportActionType::DELETIONS;
+    return report;
+}
+
+// books through the same multi-row INSERTs as the catalog import, reports through InsertReports
+// so the rollups are filled as they are in the shop
+bool InventoryBenchmarks::Seed( QString & error )
+{
+    if( !Exec( "CREATE TABLE IF NOT EXISTS benchmark_seed ( books BIGINT NOT NULL, reports BIGINT NOT NULL )",
+               error ) ){
+        return false;
+    }
+    for( QString const & table : { "benchmark_seed", "inventory", "inventory_deletions", "reports",
+                                   "report_daily_rollups" } ){
+        if( !Exec( "DELETE FROM " + table, error ) ) return false;
+    }
+    auto rollback = [&]( QString const & reason ){
+        database.rollback();
+        error = reason;
+        return false;
+    };
+
+    QDateTime const now = QDateTime::currentDateTime();
+    QSqlQuery insert_query{ database };
+    if( !insert_query.prepare( InsertStatement<DatabaseRecordFormat>( BOOKS_PER_INSERT ) ) ){
+        error = insert_query.lastError().text();
+        return false;
+    }
+    if( !database.transaction() ) return rollback( database.lastError().text() );
+    for( int first = 0; first < book_count; first += BOOKS_PER_INSERT ){
+        for( int row = 0; row != BOOKS_PER_INSERT; ++row ) BindRecordRow( insert_query, MakeBook( now ), row );
+        if( !insert_query.exec() ) return rollback( insert_query.lastError().text() );
+        if( ( first + BOOKS_PER_INSERT ) % ROWS_PER_TRANSACTION == 0 &&
+                ( !database.commit() || !database.transaction() ) ){
+            return rollback( database.lastError().text() );
+        }
+    }
+
+    // spread evenly over every day up to yesterday
+    QDateTime const first_day = now.addDays( -qint64( report_years ) * 365 );
+    qint64 const step_secs = 24 * 60 * 60 / reports_per_day;
+    QList<ReportFormat> reports {};
+    for( int day = 0; day != report_years * 365; ++day ){
+        QDateTime const start = first_day.addDays( day );
+        for( int i = 0; i != reports_per_day; ++i ) reports.append( MakeReport( start.addSecs( i * step_secs ) ) );
+        if( reports.size() >= ROWS_PER_TRANSACTION ){
+            if( !InsertReports( database, reports ) ) return rollback( "Unable to insert the reports" );
+            if( !database.commit() || !database.transaction() ) return rollback( database.lastError().text() );
+            reports.clear();
+        }
+    }
+    if( !InsertReports( database, reports ) ) return rollback( "Unable to insert the reports" );
+    if( !database.commit() ) return rollback( database.lastError().text() );
+    return Exec( QString( "INSERT INTO benchmark_seed ( books, reports ) VALUES ( %1, %2 )" )
+                 .arg( book_count ).arg( report_count ), error );
+}
+
+unsigned int InventoryBenchmarks::RandomSerialNumber()
+{
+    return std::uniform_int_distribution<unsigned int>( first_serial_number, last_serial_number )( random );
+}
+
+void InventoryBenchmarks::Record( IterationTimer const & timer, qint64 rows )
+{
+    Record( timer.iterations, timer.elapsed.nsecsElapsed() / 1e6 / qMax<qint64>( 1, timer.iterations ), rows );
+}
+
+void InventoryBenchmarks::Record( qint64 iterations, double msecs_per_iteration, qint64 rows )
+{
+    QJsonObject result {};
+    result["benchmark"] = QString( QTest::currentTestFunction() );
+    result["tag"] = QString( QTest::currentDataTag() );
+    result["iterations"] = iterations;
+    result["msecs_per_iteration"] = msecs_per_iteration;
+    result["rows"] = rows;
+    results.append( result );
+}
+
+void InventoryBenchmarks::decodeRecords_data()
+{
+    QTest::addColumn<bool>( "by_name" );
+    QTest::newRow( "schema" ) << false;
+    QTest::newRow( "by name" ) << true;
+}
+
+// the decoders alone: the rows are fetched once and decoded again on every iteration
+void InventoryBenchmarks::decodeRecords()
+{
+    QFETCH( bool, by_name );
+    QSqlQuery query{ database };
+    QVERIFY2( query.exec( QString( "SELECT %1 FROM inventory LIMIT 10000" )
+                          .arg( SelectColumns<DatabaseRecordFormat>( LargeObject ) ) ),
+              qPrintable( query.lastError().text() ) );
+    QList<DatabaseRecordFormat> records {};
+    IterationTimer timer {};
+    QBENCHMARK {
+        records.clear();
+        query.seek( QSql::BeforeFirstRow );
+        if( by_name ){
+            FillRecordsByName( records, query );
+        } else {
+            FillRecordFromQuery( records, query );
+        }
+        timer.Tick();
+    }
+    Record( timer, records.size() );
+}
+
+void InventoryBenchmarks::decodeReports_data()
+{
+    decodeRecords_data();
+}
+
+void InventoryBenchmarks::decodeReports()
+{
+    QFETCH( bool, by_name );
+    QSqlQuery query{ database };
+    QVERIFY2( query.exec( QString( "SELECT %1 FROM reports LIMIT 10000" ).arg( SelectColumns<ReportFormat>() ) ),
+              qPrintable( query.lastError().text() ) );
+    QList<ReportFormat> reports {};
+    IterationTimer timer {};
+    QBENCHMARK {
+        reports.clear();
+        query.seek( QSql::BeforeFirstRow );
+        if( by_name ){
+            FillReportsByName( reports, query );
+        } else {
+            FillReportFromQuery( reports, query );
+        }
+        timer.Tick();
+    }
+    Record( timer, reports.size() );
+}
+
+void InventoryBenchmarks::search_data()
+{
+    QTest::addColumn<QString>( "terms" );
+    QTest::newRow( "one word" ) << TITLE_WORDS[0];
+    QTest::newRow( "title and author" ) << TITLE_WORDS[1] + " " + LAST_NAMES[0];
+}
+
+void InventoryBenchmarks::search()
+{
+    QFETCH( QString, terms );
+    StatementCache & statements = StatementCache::ForThread();
+    QList<DatabaseRecordFormat> records {};
+    IterationTimer timer {};
+    QBENCHMARK {
+        records.clear();
+        QSqlQuery & search_query = statements.Prepare( database, StatementId::SearchInventory );
+        search_query.bindValue( ":terms", StatementCache::SearchTerms( terms ) );
+        QVERIFY2( statements.Exec( database, StatementId::SearchInventory, search_query ),
+                  qPrintable( search_query.lastError().text() ) );
+        FillRecordFromQuery( records, search_query );
+        timer.Tick();
+    }
+    Record( timer, records.size() );
+}
+
+// the whole inventory into the InventoryCache, from Load() until it is served from memory. Once
+// per run, the cache loads only once. The load's last step is queued to this thread, which the
+// wait below polls every few milliseconds
+void InventoryBenchmarks::coldStart()
+{
+    InventoryCache & cache = InventoryCache::Instance();
+    QElapsedTimer elapsed {};
+    std::atomic<qint64> populated_nsecs{ -1 };
+    QMetaObject::Connection const connection =
+            connect( &cache, &InventoryCache::invalidated, this, [&]( quint64 ){
+                populated_nsecs = elapsed.nsecsElapsed();
+            }, Qt::DirectConnection );
+    elapsed.start();
+    cache.Load();
+    QTRY_VERIFY_WITH_TIMEOUT( populated_nsecs >= 0, 10 * 60 * 1000 );
+    disconnect( connection );
+    Record( 1, populated_nsecs / 1e6, book_count );
+}
+
+void InventoryBenchmarks::cacheSearch_data()
+{
+    search_data();
+}
+
+// the same searches as search(), answered by the cache's SearchIndex
+void InventoryBenchmarks::cacheSearch()
+{
+    QFETCH( QString, terms );
+    InventoryCache const & cache = InventoryCache::Instance();
+    if( !cache.IsComplete() ) QSKIP( "The inventory does not fit the cache" );
+    QList<DatabaseRecordFormat> records {};
+    IterationTimer timer {};
+    QBENCHMARK {
+        records.clear();
+        QVERIFY( cache.Search( terms, records ) );
+        timer.Tick();
+    }
+    Record( timer, records.size() );
+}
+
+// the warm start's read: the snapshot of the seeded inventory, mapped and decoded
+void InventoryBenchmarks::snapshotRead()
+{
+    InventoryCache & cache = InventoryCache::Instance();
+    if( !cache.IsComplete() ) QSKIP( "The inventory does not fit the cache, there's no snapshot" );
+    cache.SaveSnapshot();
+    QString const identity = DatabaseIdentity();
+    QList<DatabaseRecordFormat> records {};
+    SnapshotStamp stamp {};
+    IterationTimer timer {};
+    QBENCHMARK {
+        records.clear();
+        QVERIFY( InventorySnapshot::Read( identity, records, stamp ) );
+        timer.Tick();
+    }
+    Record( timer, records.size() );
+}
+
+void InventoryBenchmarks::purchase_data()
+{
+    QTest::addColumn<int>( "lines" );
+    QTest::newRow( "single item" ) << 1;
+    QTest::newRow( "ten items" ) << 10;
+}
+
+void InventoryBenchmarks::purchase()
+{
+    QFETCH( int, lines );
+    IterationTimer timer {};
+    QBENCHMARK {
+        QList<CartLine> cart {};
+        for( int i = 0; i != lines; ++i ){
+            cart.append( CartLine{ RandomSerialNumber(), 1, 10.0, "Benchmark", "Benchmark",
+                                   LowStockTracker::DEFAULT_THRESHOLD } );
+        }
+        QueryResult<QList<CheckoutConflict>> const result = Checkout( database, cart, QDateTime::currentDateTime() );
+        QVERIFY2( result.ok && result.value.isEmpty(), qPrintable( result.error ) );
+        timer.Tick();
+    }
+    Record( timer, lines );
+}
+
+// a price edit, written the way the update dialog writes it: only the edited column
+void InventoryBenchmarks::update()
+{
+    IterationTimer timer {};
+    QBENCHMARK {
+        DatabaseRecordFormat before {}, after {};
+        before.serial_number = after.serial_number = RandomSerialNumber();
+        after.price = std::uniform_int_distribution<int>( 500, 25000 )( random ) / 100.0;
+        ColumnMask const changed = ChangedColumns( before, after );
+
+        QSqlQuery update_query{ database };
+        QVERIFY( update_query.prepare( UpdateStatement<DatabaseRecordFormat>( changed ) ) );
+        BindColumns( update_query, after, changed );
+        QVERIFY2( update_query.exec(), qPrintable( update_query.lastError().text() ) );
+        timer.Tick();
+    }
+    Record( timer, 1 );
+}
+
+void InventoryBenchmarks::reportQuery_data()
+{
+    QTest::addColumn<int>( "granularity" );
+    QTest::addColumn<int>( "days" );
+    int const transactions = static_cast<int>( ReportGranularity::Transactions );
+    QTest::newRow( "transactions, 30 days" ) << transactions << 30;
+    QTest::newRow( "transactions, 1 year" ) << transactions << 365;
+    QTest::newRow( "daily rollups, 1 year" ) << static_cast<int>( ReportGranularity::Daily ) << 365;
+    QTest::newRow( "monthly rollups, 1 year" ) << static_cast<int>( ReportGranularity::Monthly ) << 365;
+}
+
+// the statement and the values the report dialog would run with
+void InventoryBenchmarks::reportQuery()
+{
+    QFETCH( int, granularity );
+    QFETCH( int, days );
+    StatementId const id = ReportDialog::GetStatement( ReportActionType::ALL,
+                                                       static_cast<ReportGranularity>( granularity ) );
+    QDateTime const to = QDateTime::currentDateTime();
+    QMap<QString, QVariant> const values = ReportDialog::QueryValues( to.addDays( -days ), to, ReportActionType::ALL );
+    StatementCache & statements = StatementCache::ForThread();
+    QList<ReportFormat> reports {};
+    IterationTimer timer {};
+    QBENCHMARK {
+        reports.clear();
+        QSqlQuery & report_query = statements.Prepare( database, id );
+        for( auto iter = values.cbegin(); iter != values.cend(); ++iter ){
+            report_query.bindValue( iter.key(), iter.value() );
+        }
+        QVERIFY2( statements.Exec( database, id, report_query ), qPrintable( report_query.lastError().text() ) );
+        FillReportFromQuery( reports, report_query );
+        timer.Tick();
+    }
+    Record( timer, reports.size() );
+}
+
+// a year of transactions, streamed from a forward-only query as ReportExporter does
+void InventoryBenchmarks::exportCsv()
+{
+    QDateTime const to = QDateTime::currentDateTime();
+    QMap<QString, QVariant> const values = ReportDialog::QueryValues( to.addDays( -365 ), to, ReportActionType::ALL );
+    QString const filename = output_directory.filePath( "report.csv" );
+    qint64 rows = 0;
+    IterationTimer timer {};
+    QBENCHMARK {
+        QSqlQuery export_query{ database };
+        export_query.setForwardOnly( true );
+        QVERIFY2( export_query.exec( StatementCache::InlineSql( database, StatementId::ReportsInRange, values ) ),
+                  qPrintable( export_query.lastError().text() ) );
+        QueryResult<qint64> const result = ReportExporter::Instance().WriteCsv( export_query, filename, 0 );
+        QVERIFY2( result.ok, qPrintable( result.error ) );
+        rows = result.value;
+        timer.Tick();
+    }
+    Record( timer, rows );
+}
+
+void InventoryBenchmarks::exportPdf_data()
+{
+    QTest::addColumn<int>( "rows" );
+    QTest::addColumn<bool>( "by_html" );
+    for( int const rows : { 1000, 10000, 100000 } ){
+        QString const tag = QString( "%1k rows" ).arg( rows / 1000 );
+        QTest::newRow( qPrintable( tag ) ) << rows << false;
+        QTest::newRow( qPrintable( tag + ", by html" ) ) << rows << true;
+    }
+}
+
+void InventoryBenchmarks::exportPdf()
+{
+    QFETCH( int, rows );
+    QFETCH( bool, by_html );
+    if( rows > report_count ) QSKIP( "Not enough reports seeded" );
+
+    QString const sql = QString( "SELECT %1 FROM reports ORDER BY date_performed LIMIT %2" )
+            .arg( SelectColumns<ReportFormat>() ).arg( rows );
+    QString const filename = output_directory.filePath( "report.pdf" );
+    qint64 rows_written = 0;
+    IterationTimer timer {};
+    QBENCHMARK {
+        QSqlQuery report_query{ database };
+        report_query.setForwardOnly( true );
+        QVERIFY2( report_query.exec( sql ), qPrintable( report_query.lastError().text() ) );
+        if( by_html ){
+            rows_written = PrintReportAsHtml( report_query, "Benchmark report", filename );
+        } else {
+            QueryResult<qint64> const result = ReportExporter::Instance().WritePdf( report_query, "Benchmark report",
+                                                                                    filename, 0 );
+            QVERIFY2( result.ok, qPrintable( result.error ) );
+            rows_written = result.value;
+        }
+        timer.Tick();
+    }
+    Record( timer, rows_written );
+}
+
+QTEST_MAIN( InventoryBenchmarks )
+
+#include "inventory_benchmarks.moc"
@@ -2,16 +2,20 @@
 #include <QDebug>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <algorithm>
 
 #include "buy_book_dialog.hpp"
 #include "ui_buy_book_dialog.h"
+#include "cover_cache.hpp"
+#include "inventory_cache.hpp"
+#include "db_executor.hpp"
 
 BuyBookDialog::BuyBookDialog( QList<DatabaseRecordFormat> &&list, QWidget *parent) :
     QDialog(parent), curr_item_index( 0 ), data_list( std::move( list )),
     ui( new Ui::BuyBookDialog )
 {
     ui->setupUi( this );
-    setMaximumSize( 415, 345 );
+    setMaximumSize( 655, 345 );
     if( data_list.size() == 1 ){
         ui->prevButton->setVisible( false );
         ui->nextButton->setVisible( false );
@@ -30,8 +34,13 @@ BuyBookDialog::BuyBookDialog( QList<DatabaseRecordFormat> &&list, QWidget *paren
 
     QObject::connect( ui->quantityLineEdit, SIGNAL(textChanged(QString)), this,
                       SLOT( onQuantityChanged( QString ) ) );
-    QObject::connect( ui->purchaseButton, SIGNAL(clicked(bool)), this, SLOT(onItemPurchased()) );
+    QObject::connect( ui->addToCartButton, SIGNAL(clicked(bool)), this, SLOT(onAddToCart()) );
+    QObject::connect( ui->removeLineButton, SIGNAL(clicked(bool)), this, SLOT(onRemoveCartLine()) );
+    QObject::connect( ui->checkoutButton, SIGNAL(clicked(bool)), this, SLOT(onCheckout()) );
+    QObject::connect( &InventoryCache::Instance(), SIGNAL(recordChanged(uint,quint64)), this,
+                      SLOT(onRecordChanged(uint)) );
     UpdateNextRecord( curr_item_index );
+    RefreshCart();
 }
 
 BuyBookDialog::~BuyBookDialog()
@@ -58,7 +67,7 @@ void BuyBookDialog::onQuantityChanged( QString text )
     }
 }
 
-void BuyBookDialog::onItemPurchased()
+void BuyBookDialog::onAddToCart()
 {
     bool is_valid_quantity = false;
     int quantity = ui->quantityLineEdit->text().toInt( &is_valid_quantity );
@@ -69,52 +78,134 @@ void BuyBookDialog::onItemPurchased()
         return;
     }
 
-    DatabaseRecordFormat &data = data_list[ curr_item_index ];
-    if( static_cast<unsigned int>( quantity ) > data.quantity ){
+    DatabaseRecordFormat const &data = data_list[ curr_item_index ];
+    // only a hint, the stock is checked again when the sale is committed
+    if( static_cast<unsigned int>( quantity ) + QuantityInCart( data.serial_number ) > data.quantity ){
         ui->quantityLineEdit->setFocus();
         QMessageBox::information( this, "Purchase", "Unfortunately, there are lesser item in stock.");
         return;
     }
-    QSqlQuery buy_query {};
-    buy_query.prepare( tr( "UPDATE inventory SET stock = %1 WHERE serial_number = %2" )
-                       .arg( data.quantity - quantity ).arg( data.serial_number ) );
 
-    if( !buy_query.exec() ){
-        qDebug() << buy_query.lastError();
-        QMessageBox::critical( this, "Error", "Unable to do purchase, database trouble." );
-        return;
+    auto iter = std::find_if( cart.begin(), cart.end(), [&]( CartLine const & line ){
+        return line.serial_number == data.serial_number;
+    });
+    if( iter != cart.end() ){
+        iter->quantity += quantity;
     } else {
-        data.quantity -= quantity;
+        cart.append( CartLine{ data.serial_number, static_cast<unsigned int>( quantity ), data.price,
+                               data.book_title, data.author_name, data.low_stock_threshold } );
+    }
+    RefreshCart();
+    ui->quantityLineEdit->clear();
+    ui->quantityLineEdit->setFocus();
+}
+
+void BuyBookDialog::onRemoveCartLine()
+{
+    int const row = ui->cartListWidget->currentRow();
+    if( row < 0 || row >= cart.size() ) return;
+    cart.removeAt( row );
+    RefreshCart();
+}
+
+void BuyBookDialog::onCheckout()
+{
+    if( cart.isEmpty() ){
+        QMessageBox::information( this, "Purchase", "The cart is empty." );
+        return;
+    }
+
+    QList<CartLine> const lines = cart;
+    QDateTime const date_time = QDateTime::currentDateTime();
+
+    ui->checkoutButton->setEnabled( false );
+    ui->addToCartButton->setEnabled( false );
+    ui->removeLineButton->setEnabled( false );
+    DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this,
+                                         [lines, date_time]( QSqlDatabase & database )
+    {
+        return Checkout( database, lines, date_time );
+    }, [this, lines]( QueryResult<QList<CheckoutConflict>> result ){
+        ui->checkoutButton->setEnabled( true );
+        ui->addToCartButton->setEnabled( true );
+        ui->removeLineButton->setEnabled( true );
+        if( !result.ok ){
+            qDebug() << result.error;
+            QMessageBox::critical( this, "Error", "Unable to do purchase, database trouble." );
+            return;
+        }
+
+        if( !result.value.isEmpty() ){
+            // nothing was sold, show what is really in stock and let the user adjust the cart
+            QString conflicts {};
+            for( CheckoutConflict const & conflict : result.value ){
+                for( DatabaseRecordFormat & data : data_list ){
+                    if( data.serial_number != conflict.serial_number ) continue;
+                    data.quantity = conflict.stock_left;
+                    conflicts += tr( "%1: only %2 left\r\n" ).arg( data.book_title ).arg( conflict.stock_left );
+                }
+            }
+            UpdateNextRecord( curr_item_index );
+            QMessageBox::warning( this, "Purchase", tr( "Nothing was sold, some books no longer have "
+                                                       "enough copies in stock:\r\n" ) + conflicts );
+            return;
+        }
+
+        // cached books have been brought up to date by onRecordChanged already
+        for( CartLine const & line : lines ){
+            DatabaseRecordFormat cached {};
+            bool const is_cached = InventoryCache::Instance().Find( line.serial_number, cached );
+            for( DatabaseRecordFormat & data : data_list ){
+                if( data.serial_number != line.serial_number ) continue;
+                data.quantity = is_cached ? cached.quantity : data.quantity - line.quantity;
+            }
+        }
+        cart.clear();
+        RefreshCart();
         UpdateNextRecord( curr_item_index );
         ui->quantityLineEdit->clear();
         ui->quantityLineEdit->setFocus();
+
+        auto res = QMessageBox::information( this, "Purchase", "Items purchased successfully, would you "
+                                                               "like to perform another transaction?",
+                                             QMessageBox::Yes | QMessageBox::No );
+        if( res == QMessageBox::No ){
+            accept();
+        }
+    });
+}
+
+void BuyBookDialog::onRecordChanged( unsigned int serial_number )
+{
+    DatabaseRecordFormat record {};
+    if( !InventoryCache::Instance().Find( serial_number, record ) ) return;
+    for( int i = 0; i != data_list.size(); ++i ){
+        if( data_list.at( i ).serial_number != serial_number ) continue;
+        data_list[ i ] = record;
+        if( i == curr_item_index ) ui->stockLineEdit->setText( QString::number( record.quantity ) );
     }
+}
 
-    double const total = quantity * data.price;
-    QSqlQuery report_query {};
-    report_query.prepare( "INSERT INTO reports( book_title, author_name, stock, price, date_performed, "
-                          "transaction_type, total ) VALUES ( :title, :author, :stck, :price, :date, "
-                          ":type, :total )");
-    report_query.bindValue( ":title", ui->titleLineEdit->text() );
-    report_query.bindValue( ":author", ui->authorLineEdit->text() );
-    report_query.bindValue( ":stck", quantity );
-    report_query.bindValue( ":price", data.price );
-    report_query.bindValue( ":total", total );
-    report_query.bindValue( ":date", GetDateTime( QDateTime::currentDateTime() ) );
-    report_query.bindValue( ":type", static_cast<int>( ReportActionType::SALES ) );
-
-    if( !report_query.exec() ){
-        qDebug() << report_query.lastError();
-        QMessageBox::information( this, "Report", "Unable to generate report", QMessageBox::Ok );
-        return;
+void BuyBookDialog::RefreshCart()
+{
+    ui->cartListWidget->clear();
+    double total = 0.0;
+    for( CartLine const & line : cart ){
+        ui->cartListWidget->addItem( tr( "%1 x %2 = #%3" ).arg( line.book_title ).arg( line.quantity )
+                                     .arg( line.quantity * line.price ) );
+        total += line.quantity * line.price;
     }
-    qDebug() << "Report generated and saved.";
-    auto res = QMessageBox::information( this, "Purchase", "Item purhased successfully, would you "
-                                                           "like to perform another transaction?",
-                                         QMessageBox::Yes | QMessageBox::No );
-    if( res == QMessageBox::No ){
-        accept();
+    ui->cartTotalLabel->setText( cart.isEmpty() ? tr( "Cart is empty" ) : tr( "Total: # %1" ).arg( total ) );
+    ui->checkoutButton->setEnabled( !cart.isEmpty() );
+    ui->removeLineButton->setEnabled( !cart.isEmpty() );
+}
+
+unsigned int BuyBookDialog::QuantityInCart( unsigned int serial_number ) const
+{
+    for( CartLine const & line : cart ){
+        if( line.serial_number == serial_number ) return line.quantity;
     }
+    return 0;
 }
 
 void BuyBookDialog::onNextRecord()
@@ -147,19 +238,33 @@ void BuyBookDialog::UpdateNextRecord( int pos )
     ui->priceLabel->setText( tr( "Price: #" ) + QString::number( data.price ) );
     ui->titleLineEdit->setText( data.book_title );
     ui->coverImageLabel->clear();
+    ui->coverImageLabel->setText( tr( "LOADING COVER..." ) );
     ui->totalPriceLabel->clear();
 
-    if( !( data.book_cover.isNull() ) ){
-        QImage image{ QImage::fromData( data.book_cover ) };
+    unsigned int const serial_number = data.serial_number;
+    CoverCache & covers = CoverCache::Instance();
+    covers.RequestThumbnail( data.cover_hash, this, [this, serial_number]( QPixmap const & thumbnail, bool ok ){
+        ShowCover( serial_number, thumbnail, ok );
+    });
+    // the user is likely to step to either neighbour next
+    if( pos + 1 < data_list.size() ) covers.Prefetch( data_list.at( pos + 1 ).cover_hash, this );
+    if( pos > 0 ) covers.Prefetch( data_list.at( pos - 1 ).cover_hash, this );
+}
 
-        if( image.isNull() ){
-            QMessageBox::warning( this, "View", tr( "Unable to retrieve cover page" ), QMessageBox::Ok );
-            return;
-        }
-        QPixmap cover_image = QPixmap::fromImage( image.scaled( 100, 100, Qt::KeepAspectRatio,
-                                                                Qt::SmoothTransformation ) );
-        ui->coverImageLabel->setPixmap( cover_image );
-        ui->coverImageLabel->setFixedSize( 100, 100 );
+void BuyBookDialog::ShowCover( unsigned int serial_number, QPixmap const & thumbnail, bool ok )
+{
+    // the user may have moved on to another record while this cover was on its way
+    if( curr_item_index < 0 || curr_item_index >= data_list.size() ||
+            data_list.at( curr_item_index ).serial_number != serial_number ) return;
+
+    ui->coverImageLabel->clear();
+    if( !ok ){
+        QMessageBox::warning( this, "View", tr( "Unable to retrieve cover page" ), QMessageBox::Ok );
+        return;
+    }
+    if( !thumbnail.isNull() ){
+        ui->coverImageLabel->setPixmap( thumbnail );
+        ui->coverImageLabel->setFixedSize( CoverCache::THUMBNAIL_SIZE, CoverCache::THUMBNAIL_SIZE );
     } else {
         ui->coverImageLabel->setText( tr( "NO COVER PAGE"));
     }
@@ -3,7 +3,9 @@
 
 #include <QDialog>
 #include <QList>
+#include <QPixmap>
 #include "resources.hpp"
+#include "checkout.hpp"
 
 namespace Ui {
 class BuyBookDialog;
@@ -18,15 +20,22 @@ public:
     ~BuyBookDialog();
 private:
     void UpdateNextRecord( int );
+    void ShowCover( unsigned int serial_number, QPixmap const & thumbnail, bool ok );
+    void RefreshCart();
+    unsigned int QuantityInCart( unsigned int serial_number ) const;
 private slots:
     void onNextRecord();
     void onPreviousRecord();
-    void onItemPurchased();
+    void onAddToCart();
+    void onRemoveCartLine();
+    void onCheckout();
     void onQuantityChanged( QString );
+    void onRecordChanged( unsigned int serial_number );
 private:
     Ui::BuyBookDialog *ui;
     int curr_item_index;
     QList<DatabaseRecordFormat> data_list;
+    QList<CartLine> cart;
     QString old_quantity;
 };
 
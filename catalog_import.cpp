@@ -0,0 +1,503 @@
+#include "catalog_import.hpp"
+#include "cover_store.hpp"
+#include "inventory_cache.hpp"
+#include "low_stock_tracker.hpp"
+#include "query_tracer.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QSet>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QtConcurrent>
+#include <algorithm>
+#include <array>
+
+int const CatalogImporter::CHUNK_ROWS = 1000;
+int const CatalogImporter::INSERT_BATCH_ROWS = 100;
+
+namespace {
+enum class CatalogColumn {
+    Title = 0,
+    Author,
+    Publisher,
+    Stock,
+    Price,
+    Location,
+    Threshold,
+    Cover,
+    DateAdded,
+    Count // not a column
+};
+
+// the position of every known column in a row, -1 if the file doesn't have it
+using ColumnPositions = std::array<int, static_cast<int>( CatalogColumn::Count )>;
+
+QHash<QString, CatalogColumn> const & ColumnNames()
+{
+    static QHash<QString, CatalogColumn> const names {
+        { "title", CatalogColumn::Title }, { "book_title", CatalogColumn::Title },
+        { "author", CatalogColumn::Author }, { "author_name", CatalogColumn::Author },
+        { "publisher", CatalogColumn::Publisher },
+        { "stock", CatalogColumn::Stock }, { "quantity", CatalogColumn::Stock }, { "qty", CatalogColumn::Stock },
+        { "price", CatalogColumn::Price },
+        { "location", CatalogColumn::Location },
+        { "threshold", CatalogColumn::Threshold }, { "low_stock_threshold", CatalogColumn::Threshold },
+        { "cover", CatalogColumn::Cover }, { "cover_file", CatalogColumn::Cover }, { "image", CatalogColumn::Cover },
+        { "date_added", CatalogColumn::DateAdded }, { "date_time", CatalogColumn::DateAdded }
+    };
+    return names;
+}
+
+// the delimiter that occurs most often in the header line, outside of quotes
+char DetectDelimiter( char const *data, int begin, int end )
+{
+    int commas = 0, tabs = 0, semicolons = 0;
+    bool in_quotes = false;
+    for( int i = begin; i != end; ++i ){
+        char const c = data[i];
+        if( c == '"' ) in_quotes = !in_quotes;
+        else if( in_quotes ) continue;
+        else if( c == ',' ) ++commas;
+        else if( c == '\t' ) ++tabs;
+        else if( c == ';' ) ++semicolons;
+    }
+    if( tabs > commas && tabs >= semicolons ) return '\t';
+    if( semicolons > commas ) return ';';
+    return ',';
+}
+
+// the offsets of every non-empty row after `from`. A quoted field may span lines, line numbers
+// count every line break so they match what an editor shows
+QVector<ImportRow> SplitRows( QByteArray const & source, int from, int first_line )
+{
+    QVector<ImportRow> rows {};
+    rows.reserve( source.count( '\n' ) + 1 );
+    char const *data = source.constData();
+    int const size = source.size();
+    int line = first_line, row_line = first_line, row_begin = from;
+    bool in_quotes = false;
+    for( int i = from; i <= size; ++i ){
+        bool const at_end = ( i == size );
+        if( !at_end && data[i] == '"' ) in_quotes = !in_quotes;
+        if( !at_end && data[i] != '\n' ) continue;
+        if( !at_end && in_quotes ){
+            ++line;
+            continue;
+        }
+        int row_end = i;
+        if( row_end > row_begin && data[row_end - 1] == '\r' ) --row_end;
+        if( row_end > row_begin ){
+            ImportRow row {};
+            row.line = row_line;
+            row.begin = row_begin;
+            row.end = row_end;
+            rows.append( row );
+        }
+        row_begin = i + 1;
+        row_line = ++line;
+    }
+    return rows;
+}
+
+// RFC 4180 fields, with `delimiter` in place of the comma
+QStringList ParseFields( char const *data, int begin, int end, char delimiter )
+{
+    QStringList fields {};
+    QByteArray field {};
+    int i = begin;
+    for( ;; ){
+        field.resize( 0 );
+        if( i < end && data[i] == '"' ){
+            for( ++i; i < end; ++i ){
+                if( data[i] != '"' ){
+                    field.append( data[i] );
+                } else if( i + 1 < end && data[i + 1] == '"' ){
+                    field.append( '"' );
+                    ++i;
+                } else {
+                    ++i;
+                    break;
+                }
+            }
+        }
+        while( i < end && data[i] != delimiter ) field.append( data[i++] );
+        fields << QString::fromUtf8( field ).trimmed();
+        if( i >= end ) break;
+        ++i; // past the delimiter
+    }
+    return fields;
+}
+
+QString Field( QStringList const & fields, ColumnPositions const & positions, CatalogColumn column )
+{
+    int const position = positions[ static_cast<int>( column ) ];
+    return ( position < 0 || position >= fields.size() ) ? QString() : fields[position];
+}
+
+// fills in row.record, or sets row.error
+void ParseRow( char const *data, char delimiter, ColumnPositions const & positions, QDateTime const & now,
+               ImportRow & row )
+{
+    QStringList const fields = ParseFields( data, row.begin, row.end, delimiter );
+    DatabaseRecordFormat & record = row.record;
+    record.book_title = Field( fields, positions, CatalogColumn::Title );
+    record.author_name = Field( fields, positions, CatalogColumn::Author );
+    record.publisher = Field( fields, positions, CatalogColumn::Publisher );
+    record.location = Field( fields, positions, CatalogColumn::Location );
+    row.cover_file = Field( fields, positions, CatalogColumn::Cover );
+    if( record.book_title.isEmpty() ){
+        row.error = "missing title";
+        return;
+    }
+    if( record.author_name.isEmpty() ){
+        row.error = "missing author";
+        return;
+    }
+
+    bool is_valid = false;
+    QString const stock = Field( fields, positions, CatalogColumn::Stock );
+    int const quantity = stock.toInt( &is_valid );
+    if( !is_valid || quantity <= 0 ){
+        row.error = QString( "invalid stock \"%1\"" ).arg( stock );
+        return;
+    }
+    record.quantity = static_cast<unsigned int>( quantity );
+
+    QString const price = Field( fields, positions, CatalogColumn::Price );
+    record.price = price.toDouble( &is_valid );
+    if( !is_valid || record.price <= 0.0 ){
+        row.error = QString( "invalid price \"%1\"" ).arg( price );
+        return;
+    }
+
+    QString const threshold = Field( fields, positions, CatalogColumn::Threshold );
+    record.low_stock_threshold = LowStockTracker::DEFAULT_THRESHOLD;
+    if( !threshold.isEmpty() ){
+        record.low_stock_threshold = threshold.toUInt( &is_valid );
+        if( !is_valid ){
+            row.error = QString( "invalid threshold \"%1\"" ).arg( threshold );
+            return;
+        }
+    }
+
+    QString const date_added = Field( fields, positions, CatalogColumn::DateAdded );
+    record.date_time_added = now;
+    if( !date_added.isEmpty() ){
+        record.date_time_added = QDateTime::fromString( date_added, Qt::ISODate );
+        if( !record.date_time_added.isValid() ){
+            record.date_time_added = QDateTime( QDate::fromString( date_added, Qt::ISODate ) );
+        }
+        if( !record.date_time_added.isValid() ){
+            row.error = QString( "invalid date \"%1\"( expected YYYY-MM-DD )" ).arg( date_added );
+        }
+    }
+}
+
+// scaled and encoded the way the dialogs store an uploaded cover
+void AttachCover( QDir const & cover_directory, ImportRow & row )
+{
+    QImage image{ cover_directory.filePath( row.cover_file ) };
+    if( image.isNull() ){
+        row.error = QString( "unable to read cover \"%1\"" ).arg( row.cover_file );
+        return;
+    }
+    image = image.scaled( 100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation );
+    QBuffer buffer {};
+    QImageWriter image_writer{ &buffer, "PNG" };
+    image_writer.write( image );
+
+    // stored along with the row, in its chunk's transaction
+    row.cover = buffer.data();
+    row.record.cover_hash = CoverStore::HashOf( row.cover );
+}
+
+ReportFormat MakeAdditionReport( DatabaseRecordFormat const & record, QDateTime const & now )
+{
+    ReportFormat report {};
+    report.book_title = record.book_title;
+    report.author_name = record.author_name;
+    report.quantity = static_cast<int>( record.quantity );
+    report.date_time_added = now;
+    report.detail = ReportActionType::ADDITIONS;
+    report.price = record.price;
+    report.total = report.price * report.quantity;
+    return report;
+}
+
+// one chunk, one transaction. The ids of a multi-row VALUES list are consecutive: it is a "simple
+// insert" to InnoDB, and SQLite hands out one rowid after the other under the write lock.
+QueryResult<QVector<ImportRow>> WriteChunkOnce( QSqlDatabase & database, QVector<ImportRow> const & rows )
+{
+    QueryResult<QVector<ImportRow>> result {};
+    result.value = rows;
+    StatementCache & statements = StatementCache::ForThread();
+    if( !statements.Begin( database ) ){
+        result.error = database.lastError().text();
+        return result;
+    }
+    auto rollback = [&]( QString const & error ){
+        statements.Rollback( database );
+        result.error = error;
+        return result;
+    };
+
+    QSet<QString> stored_covers {};
+    for( ImportRow const & row : rows ){
+        if( row.cover.isEmpty() || stored_covers.contains( row.record.cover_hash ) ) continue;
+        QString error {};
+        if( CoverStore::Instance().Put( database, row.cover, error ).isEmpty() ) return rollback( error );
+        stored_covers.insert( row.record.cover_hash );
+    }
+
+    int const batch_rows = CatalogImporter::INSERT_BATCH_ROWS;
+    QSqlQuery full_batch_query{ database }; // prepared once, reused for every full batch
+    bool is_full_batch_prepared = false;
+    for( int first = 0; first < rows.size(); first += batch_rows ){
+        int const count = qMin( batch_rows, rows.size() - first );
+        QSqlQuery tail_query{ database };
+        QSqlQuery & insert_query = ( count == batch_rows ) ? full_batch_query : tail_query;
+        if( count != batch_rows || !is_full_batch_prepared ){
+            if( !insert_query.prepare( InsertStatement<DatabaseRecordFormat>( count ) ) ){
+                return rollback( insert_query.lastError().text() );
+            }
+            if( count == batch_rows ) is_full_batch_prepared = true;
+        }
+        for( int row = 0; row != count; ++row ) BindRecordRow( insert_query, rows[first + row].record, row );
+        if( !QueryTracer::Instance().Exec( "import_inventory", insert_query ) ) return rollback( insert_query.lastError().text() );
+
+        // MySQL reports the first id of a multi-row INSERT, SQLite the last
+        unsigned int const reported_id = insert_query.lastInsertId().toUInt();
+        unsigned int const first_id = StorageBackend::Current().Dialect() == SqlDialect::Sqlite ?
+                    reported_id - static_cast<unsigned int>( count - 1 ) : reported_id;
+        for( int row = 0; row != count; ++row ) result.value[first + row].record.serial_number = first_id + row;
+    }
+
+    QDateTime const now = QDateTime::currentDateTime();
+    QList<ReportFormat> reports {};
+    reports.reserve( rows.size() );
+    for( ImportRow const & row : rows ) reports.append( MakeAdditionReport( row.record, now ) );
+    if( !InsertReports( database, reports ) ) return rollback( "Unable to write the ADDITIONS reports" );
+
+    if( !statements.Commit( database ) ) return rollback( database.lastError().text() );
+
+    QList<LowStockItem> stock_levels {};
+    InventoryCache & cache = InventoryCache::Instance();
+    for( ImportRow const & row : result.value ){
+        cache.Insert( row.record );
+        stock_levels.append( MakeLowStockItem( row.record ) );
+    }
+    LowStockTracker::Instance().Update( stock_levels );
+    result.ok = true;
+    return result;
+}
+
+// a chunk lost halfway with its connection is written again as a whole
+QueryResult<QVector<ImportRow>> WriteChunk( QSqlDatabase & database, QVector<ImportRow> const & rows )
+{
+    return StatementCache::ForThread().Transact( database, [&]{ return WriteChunkOnce( database, rows ); } );
+}
+}
+
+CatalogImporter & CatalogImporter::Instance()
+{
+    static CatalogImporter *importer = new CatalogImporter( qApp );
+    return *importer;
+}
+
+CatalogImporter::CatalogImporter( QObject *parent ): QObject( parent ),
+    running{ false }, all_submitted{ false }, chunks_pending{ 0 }, header_end{ 0 }, delimiter{ ',' }
+{
+}
+
+bool CatalogImporter::IsRunning() const
+{
+    return running;
+}
+
+bool CatalogImporter::Start( QString const & filename, QString const & cover_directory )
+{
+    if( running ) return false;
+    running = true;
+    all_submitted = false;
+    chunks_pending = 0;
+    source.clear();
+    failed_rows.clear();
+    summary = ImportSummary{};
+    summary.filename = filename;
+    elapsed.start();
+
+    QtConcurrent::run( [this, filename, cover_directory]{
+        RunPipeline( filename, cover_directory );
+    });
+    return true;
+}
+
+void CatalogImporter::RunPipeline( QString const & filename, QString const & cover_directory )
+{
+    auto fail = [this]( QString const & error ){
+        QMetaObject::invokeMethod( this, [this, error]{ PipelineFinished( error ); }, Qt::QueuedConnection );
+    };
+
+    QFile file{ filename };
+    if( !file.open( QIODevice::ReadOnly ) ) return fail( file.errorString() );
+    QByteArray const data = file.readAll();
+    file.close();
+
+    QElapsedTimer parse_timer {};
+    parse_timer.start();
+    // the header is the first line, after an optional UTF-8 byte order mark
+    int const header_begin = data.startsWith( "\xEF\xBB\xBF" ) ? 3 : 0;
+    int header_stop = data.indexOf( '\n', header_begin );
+    int const body_begin = ( header_stop < 0 ) ? data.size() : header_stop + 1;
+    if( header_stop < 0 ) header_stop = data.size();
+    if( header_stop > header_begin && data[header_stop - 1] == '\r' ) --header_stop;
+
+    char const separator = DetectDelimiter( data.constData(), header_begin, header_stop );
+    QStringList const header = ParseFields( data.constData(), header_begin, header_stop, separator );
+    ColumnPositions positions {};
+    positions.fill( -1 );
+    for( int i = 0; i != header.size(); ++i ){
+        QString const name = header[i].toLower().replace( ' ', '_' );
+        auto const iter = ColumnNames().constFind( name );
+        if( iter != ColumnNames().cend() ) positions[ static_cast<int>( iter.value() ) ] = i;
+    }
+    for( CatalogColumn const required : { CatalogColumn::Title, CatalogColumn::Author, CatalogColumn::Stock,
+         CatalogColumn::Price } ){
+        if( positions[ static_cast<int>( required ) ] < 0 ){
+            return fail( tr( "The header line needs title, author, stock and price columns" ) );
+        }
+    }
+
+    QVector<ImportRow> rows = SplitRows( data, body_begin, 2 );
+    QDateTime const now = QDateTime::currentDateTime();
+    char const *bytes = data.constData();
+    QtConcurrent::blockingMap( rows, [bytes, separator, &positions, &now]( ImportRow & row ){
+        ParseRow( bytes, separator, positions, now, row );
+    });
+
+    QVector<ImportRow> valid {}, failed {};
+    valid.reserve( rows.size() );
+    for( ImportRow const & row : rows ) ( row.error.isEmpty() ? valid : failed ).append( row );
+    qint64 const rows_read = rows.size(), parse_msecs = parse_timer.elapsed();
+    rows.clear();
+    QMetaObject::invokeMethod( this, [=]{
+        Parsed( data, header_stop, separator, failed, rows_read, parse_msecs );
+    }, Qt::QueuedConnection );
+
+    // covers are attached one chunk ahead of the database, which writes the previous chunk meanwhile
+    QDir const covers{ cover_directory };
+    bool const has_covers = !cover_directory.isEmpty() && positions[ static_cast<int>( CatalogColumn::Cover ) ] >= 0;
+    for( int first = 0; first < valid.size(); first += CHUNK_ROWS ){
+        QVector<ImportRow> chunk = valid.mid( first, CHUNK_ROWS );
+        if( has_covers ){
+            QtConcurrent::blockingMap( chunk, [&covers]( ImportRow & row ){
+                if( !row.cover_file.isEmpty() ) AttachCover( covers, row );
+            });
+        }
+        QVector<ImportRow> chunk_valid {}, chunk_failed {};
+        chunk_valid.reserve( chunk.size() );
+        for( ImportRow const & row : chunk ) ( row.error.isEmpty() ? chunk_valid : chunk_failed ).append( row );
+        QMetaObject::invokeMethod( this, [=]{ SubmitChunk( chunk_valid, chunk_failed ); }, Qt::QueuedConnection );
+    }
+    QMetaObject::invokeMethod( this, [this]{ PipelineFinished( QString() ); }, Qt::QueuedConnection );
+}
+
+void CatalogImporter::Parsed( QByteArray const & data, int end_of_header, char separator,
+                              QVector<ImportRow> const & failed, qint64 rows_read, qint64 parse_msecs )
+{
+    source = data;
+    header_end = end_of_header;
+    delimiter = separator;
+    failed_rows += failed;
+    summary.rows_read = rows_read;
+    summary.rows_failed += failed.size();
+    summary.parse_msecs = parse_msecs;
+}
+
+void CatalogImporter::SubmitChunk( QVector<ImportRow> const & rows, QVector<ImportRow> const & failed )
+{
+    failed_rows += failed;
+    summary.rows_failed += failed.size();
+    if( rows.isEmpty() ) return;
+
+    ++chunks_pending;
+    DatabaseExecutor::Instance().Submit( QueryPriority::Reporting, this, [rows]( QSqlDatabase & database ){
+        return WriteChunk( database, rows );
+    }, [this, rows]( QueryResult<QVector<ImportRow>> result ){
+        --chunks_pending;
+        if( result.ok ){
+            summary.rows_imported += result.value.size();
+            for( ImportRow const & row : result.value ){
+                if( !row.record.cover_hash.isEmpty() ) ++summary.covers_attached;
+            }
+        } else {
+            qDebug() << result.error;
+            for( ImportRow row : rows ){
+                row.error = QString( "not saved: %1" ).arg( result.error );
+                failed_rows.append( row );
+            }
+            summary.rows_failed += rows.size();
+        }
+        emit progress( summary.rows_imported + summary.rows_failed, summary.rows_read,
+                       summary.rows_imported * 1000.0 / qMax<qint64>( 1, elapsed.elapsed() ) );
+        if( all_submitted && chunks_pending == 0 ) FinishImport();
+    });
+}
+
+void CatalogImporter::PipelineFinished( QString const & error )
+{
+    all_submitted = true;
+    summary.error = error;
+    if( chunks_pending == 0 ) FinishImport();
+}
+
+void CatalogImporter::FinishImport()
+{
+    summary.total_msecs = elapsed.elapsed();
+    summary.rows_per_second = summary.rows_imported * 1000.0 / qMax<qint64>( 1, summary.total_msecs );
+    if( !failed_rows.isEmpty() && !WriteErrorFile() ) summary.error_filename.clear();
+    source.clear();
+    failed_rows.clear();
+    running = false;
+    emit finished( summary );
+}
+
+bool CatalogImporter::WriteErrorFile()
+{
+    std::sort( failed_rows.begin(), failed_rows.end(), []( ImportRow const & a, ImportRow const & b ){
+        return a.line < b.line;
+    });
+    QFileInfo const info{ summary.filename };
+    summary.error_filename = info.dir().filePath( info.completeBaseName() + ".errors." + info.suffix() );
+
+    QSaveFile file{ summary.error_filename };
+    if( !file.open( QIODevice::WriteOnly ) ){
+        qDebug() << file.errorString();
+        return false;
+    }
+    // the source's own header and rows, with the reason appended as one more column
+    QByteArray output {};
+    output.append( source.constData(), header_end ).append( delimiter ).append( "import_error\r\n" );
+    for( ImportRow const & row : failed_rows ){
+        QString const reason = QString( "line %1: %2" ).arg( row.line ).arg( row.error );
+        output.append( source.constData() + row.begin, row.end - row.begin ).append( delimiter )
+                .append( '"' ).append( reason.toUtf8().replace( "\"", "\"\"" ) ).append( "\"\r\n" );
+    }
+    if( file.write( output ) != output.size() || !file.commit() ){
+        qDebug() << file.errorString();
+        return false;
+    }
+    return true;
+}
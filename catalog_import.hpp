@@ -0,0 +1,90 @@
+#ifndef CATALOG_IMPORT_HPP
+#define CATALOG_IMPORT_HPP
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include "db_executor.hpp"
+#include "resources.hpp"
+
+// one line of a catalog file on its way into the inventory
+struct ImportRow
+{
+    int                     line = 0;  // 1-based, in the source file
+    int                     begin = 0; // where the row's bytes sit in the source
+    int                     end = 0;
+    DatabaseRecordFormat    record {};
+    QString                 cover_file; // relative to the cover directory, empty if none
+    QByteArray              cover;      // read from cover_file, stored with the row
+    QString                 error;      // the row is not imported when set
+};
+
+struct ImportSummary
+{
+    QString filename;
+    QString error_filename; // the rows that failed, empty if there were none
+    QString error;          // the import as a whole failed, e.g. the file could not be read
+    qint64  rows_read = 0;
+    qint64  rows_imported = 0;
+    qint64  rows_failed = 0;
+    qint64  covers_attached = 0;
+    qint64  parse_msecs = 0;    // splitting, parsing and validating every row
+    qint64  total_msecs = 0;
+    double  rows_per_second = 0.0;
+};
+
+Q_DECLARE_METATYPE( ImportSummary )
+
+// bulk import of supplier catalogs: comma separated files or feeds separated by tabs or semicolons,
+// with a header line naming the columns( title, author, publisher, stock, price, location,
+// threshold, cover, date_added; unknown columns are ignored ). The import is a pipeline:
+//  - rows are parsed and validated in parallel on the thread pool
+//  - covers named in the "cover" column are read from the cover directory, scaled and hashed, one
+//    chunk of rows at a time and in parallel
+//  - each chunk is written by the database worker in one transaction: its covers into the
+//    CoverStore, multi-row INSERTs for the books, their ADDITIONS reports batched the same way.
+//    Interactive queries run between chunks.
+// Rows that fail are written, with their reason, to an error file next to the source. It keeps the
+// source's header so it can be fixed and imported again.
+class CatalogImporter : public QObject
+{
+    Q_OBJECT
+public:
+    static CatalogImporter & Instance();
+
+    // false if an import is already running. `cover_directory` may be empty
+    bool Start( QString const & filename, QString const & cover_directory );
+    bool IsRunning() const;
+
+    static int const CHUNK_ROWS;        // rows per transaction
+    static int const INSERT_BATCH_ROWS; // rows per INSERT statement
+signals:
+    void progress( qint64 rows_done, qint64 rows_total, double rows_per_second );
+    void finished( ImportSummary const & summary );
+private:
+    explicit CatalogImporter( QObject *parent = nullptr );
+    // runs on the thread pool and hands its results to the GUI thread through Parsed, SubmitChunk and
+    // PipelineFinished, all the state below is only touched there
+    void RunPipeline( QString const & filename, QString const & cover_directory );
+    void Parsed( QByteArray const & source, int header_end, char delimiter, QVector<ImportRow> const & failed,
+                 qint64 rows_read, qint64 parse_msecs );
+    void SubmitChunk( QVector<ImportRow> const & rows, QVector<ImportRow> const & failed );
+    void PipelineFinished( QString const & error );
+    void FinishImport();
+    bool WriteErrorFile();
+private:
+    bool                running;
+    bool                all_submitted;
+    int                 chunks_pending;
+    QByteArray          source;      // the whole file, failed rows are copied from it
+    int                 header_end;
+    char                delimiter;
+    QVector<ImportRow>  failed_rows;
+    ImportSummary       summary;
+    QElapsedTimer       elapsed;
+};
+
+#endif // CATALOG_IMPORT_HPP
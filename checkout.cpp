@@ -0,0 +1,109 @@
+#include "checkout.hpp"
+#include "inventory_cache.hpp"
+#include "low_stock_tracker.hpp"
+#include "report_journal.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+
+#include <QDateTime>
+#include <QSqlDatabase>
+#include <QSqlError>
+
+namespace {
+QueryResult<QList<CheckoutConflict>> CheckoutOnce( QSqlDatabase & database, QList<CartLine> const & cart,
+                                                   QDateTime const & date_time )
+{
+    QueryResult<QList<CheckoutConflict>> result {};
+    StatementCache & statements = StatementCache::ForThread();
+    if( !statements.Begin( database ) ){
+        result.error = database.lastError().text();
+        return result;
+    }
+
+    auto rollback = [&]( QString const & error ){
+        statements.Rollback( database );
+        result.error = error;
+        return result;
+    };
+
+    QList<ReportFormat> reports {};
+    QList<LowStockItem> stock_left {};
+    reports.reserve( cart.size() );
+
+    for( CartLine const & line : cart ){
+        QSqlQuery & sell_query = statements.Prepare( database, StatementId::SellStock );
+        sell_query.bindValue( ":quantity", line.quantity );
+        sell_query.bindValue( ":serial_number", line.serial_number );
+        if( !statements.Exec( database, StatementId::SellStock, sell_query ) ){
+            return rollback( sell_query.lastError().text() );
+        }
+        if( sell_query.numRowsAffected() < 1 ){
+            // not enough stock left( or no such book anymore ), find out what there is
+            QSqlQuery & stock_query = statements.Prepare( database, StatementId::SelectStock );
+            stock_query.bindValue( ":serial_number", line.serial_number );
+            if( !statements.Exec( database, StatementId::SelectStock, stock_query ) ){
+                return rollback( stock_query.lastError().text() );
+            }
+            bool const exists = stock_query.next();
+            unsigned int const stock_left = exists ? stock_query.value( 0 ).toUInt() : 0;
+            result.value.append( CheckoutConflict{ line.serial_number, stock_left } );
+            // what we just read is committed, the cache might as well have it
+            if( exists ){
+                InventoryCache::Instance().SetStock( line.serial_number, stock_left );
+            } else {
+                InventoryCache::Instance().Remove( line.serial_number );
+            }
+            continue;
+        }
+        unsigned int new_stock = 0;
+        if( StorageBackend::Current().Dialect() == SqlDialect::Sqlite ){
+            // a local read, inside the transaction that holds the write lock
+            QSqlQuery & stock_query = statements.Prepare( database, StatementId::SelectStock );
+            stock_query.bindValue( ":serial_number", line.serial_number );
+            if( !statements.Exec( database, StatementId::SelectStock, stock_query ) || !stock_query.next() ){
+                return rollback( stock_query.lastError().text() );
+            }
+            new_stock = stock_query.value( 0 ).toUInt();
+        } else {
+            // SellStock leaves the new stock in LAST_INSERT_ID(), the driver reports 0 as no value at all
+            new_stock = sell_query.lastInsertId().toUInt();
+        }
+        stock_left.append( LowStockItem{ line.serial_number, new_stock,
+                                         line.low_stock_threshold, line.book_title, line.author_name } );
+
+        ReportFormat report {};
+        report.book_title = line.book_title;
+        report.author_name = line.author_name;
+        report.quantity = static_cast<int>( line.quantity );
+        report.price = line.price;
+        report.total = line.quantity * line.price;
+        report.date_time_added = date_time;
+        report.detail = ReportActionType::SALES;
+        reports.append( report );
+    }
+
+    if( !result.value.isEmpty() ){
+        statements.Rollback( database );
+        result.ok = true;
+        return result;
+    }
+    if( !statements.Commit( database ) ){
+        return rollback( database.lastError().text() );
+    }
+    // the sale is final, its reports are written in the background
+    ReportJournal::Instance().Append( reports );
+    for( LowStockItem const & item : stock_left ){
+        InventoryCache::Instance().SetStock( item.serial_number, item.stock );
+    }
+    LowStockTracker::Instance().Update( stock_left );
+    result.ok = true;
+    return result;
+}
+}
+
+QueryResult<QList<CheckoutConflict>> Checkout( QSqlDatabase & database, QList<CartLine> const & cart,
+                                               QDateTime const & date_time )
+{
+    // the whole cart is sold again if the connection drops halfway, never just what is left of it
+    return StatementCache::ForThread().Transact( database, [&]{ return CheckoutOnce( database, cart, date_time ); } );
+}
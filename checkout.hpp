@@ -0,0 +1,36 @@
+#ifndef CHECKOUT_HPP
+#define CHECKOUT_HPP
+
+#include <QList>
+#include <QString>
+#include "db_executor.hpp"
+
+class QDateTime;
+class QSqlDatabase;
+
+struct CartLine
+{
+    unsigned int    serial_number;
+    unsigned int    quantity;
+    double          price;
+    QString         book_title;
+    QString         author_name;
+    unsigned int    low_stock_threshold;
+};
+
+// a line that could not be sold, `stock_left` is what the inventory actually holds( 0 if the
+// book has been removed )
+struct CheckoutConflict
+{
+    unsigned int    serial_number;
+    unsigned int    stock_left;
+};
+
+// sells every line of `cart` in a single transaction, each one with a guarded decrement, and
+// hands their sales reports to the ReportJournal( and the new stock to the LowStockTracker ) once committed. If any line cannot be sold, nothing is: the
+// transaction is rolled back and the conflicting lines are returned. A connection lost halfway
+// rolls back the whole cart, which is then sold again from the start on a new connection.
+QueryResult<QList<CheckoutConflict>> Checkout( QSqlDatabase & database, QList<CartLine> const & cart,
+                                               QDateTime const & date_time );
+
+#endif // CHECKOUT_HPP
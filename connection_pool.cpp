@@ -0,0 +1,109 @@
+#include "connection_pool.hpp"
+#include "connection_settings.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+
+int const ConnectionPool::MAX_CONNECTIONS = 8;
+int const ConnectionPool::VALIDATE_AFTER_IDLE_MS = 2000;
+int const ConnectionPool::ACQUIRE_TIMEOUT_MS = 10000;
+
+namespace {
+thread_local QElapsedTimer last_used {};
+}
+
+ConnectionPool::ConnectionPool(): last_connection_id{ 0 }
+{
+}
+
+ConnectionPool & ConnectionPool::Instance()
+{
+    static ConnectionPool pool {};
+    return pool;
+}
+
+QSqlDatabase ConnectionPool::Acquire()
+{
+    QThread *const thread = QThread::currentThread();
+    QString connection_name {};
+    bool is_new_connection = false;
+    {
+        QMutexLocker lock{ &mutex };
+        auto iter = connections.constFind( thread );
+        if( iter != connections.constEnd() ){
+            connection_name = iter.value();
+        } else {
+            QElapsedTimer waited {};
+            waited.start();
+            while( connections.size() >= MAX_CONNECTIONS ){
+                qint64 const remaining = ACQUIRE_TIMEOUT_MS - waited.elapsed();
+                if( remaining <= 0 || !connection_released.wait( &mutex, static_cast<unsigned long>( remaining ) ) ){
+                    qDebug() << "Connection pool exhausted," << connections.size() << "connections in use";
+                    return QSqlDatabase();
+                }
+            }
+            connection_name = QString( "pool_connection_%1" ).arg( ++last_connection_id );
+            connections.insert( thread, connection_name );
+            is_new_connection = true;
+        }
+    }
+
+    QSqlDatabase database = is_new_connection ? AddConnection( connection_name ) :
+                                                QSqlDatabase::database( connection_name, false );
+    if( database.isOpen() && last_used.isValid() && last_used.elapsed() > VALIDATE_AFTER_IDLE_MS &&
+            !Ping( database ) )
+    {
+        // most likely the server restarted while we were idle
+        qDebug() << "Reconnecting" << connection_name;
+        database.close();
+        StatementCache::ForThread().Invalidate();
+    }
+    if( !database.isOpen() ){
+        // closed by a failed ping or by whoever lost it, none of its statements survived
+        if( !is_new_connection ) StatementCache::ForThread().Invalidate();
+        if( !database.open() ){
+            qDebug() << database.lastError();
+        } else {
+            StorageBackend::Current().ConfigureConnection( database );
+        }
+    }
+    last_used.start();
+    return database;
+}
+
+void ConnectionPool::Release()
+{
+    QString connection_name {};
+    {
+        QMutexLocker lock{ &mutex };
+        connection_name = connections.take( QThread::currentThread() );
+    }
+    if( connection_name.isEmpty() ) return;
+
+    StatementCache::ForThread().Clear();
+    {
+        QSqlDatabase database = QSqlDatabase::database( connection_name, false );
+        database.close();
+    }
+    QSqlDatabase::removeDatabase( connection_name );
+    last_used.invalidate();
+    connection_released.wakeOne();
+}
+
+int ConnectionPool::ConnectionCount() const
+{
+    QMutexLocker lock{ &mutex };
+    return connections.size();
+}
+
+bool ConnectionPool::Ping( QSqlDatabase & database )
+{
+    QSqlQuery ping_query{ database };
+    return ping_query.exec( "SELECT 1" );
+}
@@ -0,0 +1,43 @@
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include <QHash>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QString>
+#include <QWaitCondition>
+
+class QThread;
+
+// hands every thread a connection of its own( Qt connections must not cross threads ), named after
+// the pool and created on first use. Connections idle for a while are pinged before being handed out
+// again and reopened if the server went away, and the pool never holds more than MAX_CONNECTIONS.
+class ConnectionPool
+{
+public:
+    static ConnectionPool & Instance();
+
+    // the calling thread's connection, opened and validated. If the pool is full this waits up to
+    // ACQUIRE_TIMEOUT_MS for another thread to release its connection, then returns an invalid one.
+    QSqlDatabase Acquire();
+    // closes the calling thread's connection, threads should call this before they finish
+    void Release();
+    int  ConnectionCount() const;
+
+    static int const MAX_CONNECTIONS;
+    static int const VALIDATE_AFTER_IDLE_MS;
+    static int const ACQUIRE_TIMEOUT_MS;
+private:
+    ConnectionPool();
+    ConnectionPool( ConnectionPool const & ) = delete;
+    ConnectionPool & operator=( ConnectionPool const & ) = delete;
+
+    static bool Ping( QSqlDatabase & database );
+private:
+    mutable QMutex              mutex;
+    QWaitCondition              connection_released;
+    QHash<QThread*, QString>    connections;
+    quint64                     last_connection_id;
+};
+
+#endif // CONNECTION_POOL_HPP
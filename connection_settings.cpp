@@ -0,0 +1,12 @@
+#include "connection_settings.hpp"
+#include "storage_backend.hpp"
+
+QSqlDatabase AddConnection( QString const & connection_name )
+{
+    return StorageBackend::Current().AddConnection( connection_name );
+}
+
+QString DatabaseIdentity()
+{
+    return StorageBackend::Current().Identity();
+}
@@ -0,0 +1,15 @@
+#ifndef CONNECTION_SETTINGS_HPP
+#define CONNECTION_SETTINGS_HPP
+
+#include <QSqlDatabase>
+#include <QString>
+
+// registers a connection named `connection_name` with the settings every part of the application
+// uses to reach the inventory database( see StorageBackend ). The connection is not opened.
+QSqlDatabase AddConnection( QString const & connection_name = QLatin1String( QSqlDatabase::defaultConnection ) );
+
+// names the database AddConnection() reaches( driver and server or file ), for data kept on disk
+// that is only valid for that database
+QString DatabaseIdentity();
+
+#endif // CONNECTION_SETTINGS_HPP
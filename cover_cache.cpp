@@ -0,0 +1,77 @@
+#include "cover_cache.hpp"
+#include "cover_store.hpp"
+
+#include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QtConcurrent>
+
+int const CoverCache::MAX_THUMBNAIL_BYTES = 8 * 1024 * 1024;
+int const CoverCache::THUMBNAIL_SIZE = 100;
+
+namespace {
+struct DecodedThumbnail
+{
+    QImage  image;
+    bool    ok;
+};
+
+// runs on the thread pool, QPixmaps can only be made on the GUI thread
+DecodedThumbnail ScaleCover( QString const & cover_hash, int size )
+{
+    std::shared_ptr<MappedCover> const cover = CoverStore::Instance().Map( cover_hash );
+    if( !cover ) return DecodedThumbnail{ QImage(), false };
+    QImage const image{ QImage::fromData( cover->Data(), static_cast<int>( cover->Size() ) ) };
+    if( image.isNull() ) return DecodedThumbnail{ QImage(), false };
+    return DecodedThumbnail{ image.scaled( size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation ), true };
+}
+}
+
+CoverCache::CoverCache(): thumbnails( MAX_THUMBNAIL_BYTES )
+{
+}
+
+CoverCache & CoverCache::Instance()
+{
+    static CoverCache cover_cache {};
+    return cover_cache;
+}
+
+void CoverCache::RequestThumbnail( QString const & cover_hash, QObject *context,
+                                   std::function<void( QPixmap const &, bool )> on_ready )
+{
+    if( cover_hash.isEmpty() ){
+        on_ready( QPixmap(), true );
+        return;
+    }
+    if( QPixmap const *thumbnail = thumbnails.object( cover_hash ) ){
+        on_ready( *thumbnail, true );
+        return;
+    }
+
+    bool const in_flight = pending.contains( cover_hash );
+    pending[cover_hash].append( ThumbnailWaiter{ context, on_ready } );
+    if( in_flight ) return;
+
+    auto *watcher = new QFutureWatcher<DecodedThumbnail>( qApp );
+    QObject::connect( watcher, &QFutureWatcher<DecodedThumbnail>::finished, qApp, [this, watcher, cover_hash]{
+        DecodedThumbnail const decoded = watcher->result();
+        watcher->deleteLater();
+
+        QPixmap const thumbnail = decoded.image.isNull() ? QPixmap() : QPixmap::fromImage( decoded.image );
+        if( decoded.ok ){
+            int const cost = qMax( 1, thumbnail.width() * thumbnail.height() * thumbnail.depth() / 8 );
+            thumbnails.insert( cover_hash, new QPixmap( thumbnail ), cost );
+        }
+        for( ThumbnailWaiter const & waiter : pending.take( cover_hash ) ){
+            if( waiter.context ) waiter.on_ready( thumbnail, decoded.ok );
+        }
+    });
+    watcher->setFuture( QtConcurrent::run( ScaleCover, cover_hash, THUMBNAIL_SIZE ) );
+}
+
+void CoverCache::Prefetch( QString const & cover_hash, QObject *context )
+{
+    if( cover_hash.isEmpty() || thumbnails.contains( cover_hash ) || pending.contains( cover_hash ) ) return;
+    RequestThumbnail( cover_hash, context, []( QPixmap const &, bool ){} );
+}
@@ -0,0 +1,49 @@
+#ifndef COVER_CACHE_HPP
+#define COVER_CACHE_HPP
+
+#include <QCache>
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+#include <QPointer>
+#include <QString>
+#include <functional>
+
+class QObject;
+
+// thumbnails of the book covers, ready to paint. A cover is read from the CoverStore( memory
+// mapped ) and decoded and scaled on the thread pool the first time it is displayed, then kept in a
+// bounded, least-recently-used cache. Covers are keyed by their content hash, so books sharing a
+// cover share its thumbnail and an entry never goes stale.
+class CoverCache
+{
+public:
+    static CoverCache & Instance();
+
+    // hands the thumbnail to `on_ready` on the GUI thread, right away if it is cached. A null pixmap
+    // means "no cover page"( an empty hash ), `ok` is false if the cover is missing or could not be
+    // decoded. Nothing is called if `context` is destroyed first.
+    void RequestThumbnail( QString const & cover_hash, QObject *context,
+                           std::function<void( QPixmap const & thumbnail, bool ok )> on_ready );
+    // warms the cache, e.g. for the records next to the one being displayed
+    void Prefetch( QString const & cover_hash, QObject *context );
+
+    static int const MAX_THUMBNAIL_BYTES;
+    static int const THUMBNAIL_SIZE;
+private:
+    struct ThumbnailWaiter
+    {
+        QPointer<QObject>                           context;
+        std::function<void( QPixmap const &, bool )> on_ready;
+    };
+
+    CoverCache();
+    CoverCache( CoverCache const & ) = delete;
+    CoverCache & operator=( CoverCache const & ) = delete;
+private:
+    QCache<QString, QPixmap>                thumbnails;
+    // decodes in flight, a second request for the same cover waits for the first one
+    QHash<QString, QList<ThumbnailWaiter>>  pending;
+};
+
+#endif // COVER_CACHE_HPP
@@ -0,0 +1,173 @@
+#include "cover_store.hpp"
+#include "connection_pool.hpp"
+#include "db_executor.hpp"
+#include "query_tracer.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+int const CoverStore::GC_GRACE_SECONDS = 60 * 60;
+
+MappedCover::MappedCover( QString const & path ): file( path ), data( nullptr ), size( 0 )
+{
+    if( !file.open( QIODevice::ReadOnly ) ) return;
+    size = file.size();
+    if( size > 0 ) data = file.map( 0, size );
+    if( !data ) size = 0;
+}
+
+MappedCover::~MappedCover()
+{
+    if( data ) file.unmap( data );
+}
+
+CoverStore::CoverStore():
+    directory( QStandardPaths::writableLocation( QStandardPaths::AppDataLocation ) + "/covers" )
+{
+    QDir().mkpath( directory );
+}
+
+CoverStore & CoverStore::Instance()
+{
+    static CoverStore cover_store {};
+    return cover_store;
+}
+
+QString CoverStore::HashOf( QByteArray const & cover )
+{
+    return QString::fromLatin1( QCryptographicHash::hash( cover, QCryptographicHash::Sha256 ).toHex() );
+}
+
+QString CoverStore::PathOf( QString const & hash ) const
+{
+    return directory + "/" + hash.left( 2 ) + "/" + hash;
+}
+
+QString CoverStore::Put( QSqlDatabase & database, QByteArray const & cover, QString & error )
+{
+    QString const hash = HashOf( cover );
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & insert_query = statements.Prepare( database, StatementId::InsertCover );
+    insert_query.bindValue( ":cover_hash", hash );
+    insert_query.bindValue( ":cover", cover );
+    if( !statements.Exec( database, StatementId::InsertCover, insert_query ) ){
+        error = insert_query.lastError().text();
+        return QString();
+    }
+    // this till displays it next, so it is not fetched back. Without a local copy it just will be
+    QString cache_error {};
+    Cache( hash, cover, cache_error );
+    return hash;
+}
+
+bool CoverStore::Cache( QString const & hash, QByteArray const & cover, QString & error ) const
+{
+    QString const path = PathOf( hash );
+    QFileInfo const info{ path };
+    if( info.exists() && info.size() == cover.size() ) return true;
+
+    QDir().mkpath( info.absolutePath() );
+    // written under a temporary name and renamed, a reader never sees half a cover
+    QSaveFile file{ path };
+    if( !file.open( QIODevice::WriteOnly ) || file.write( cover ) != cover.size() || !file.commit() ){
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray CoverStore::Fetch( QString const & hash, QString & error )
+{
+    // on the thread pool, which has no connections of its own to keep
+    ConnectionPool & pool = ConnectionPool::Instance();
+    QByteArray cover {};
+    {
+        QSqlDatabase database = pool.Acquire();
+        StatementCache & statements = StatementCache::ForThread();
+        QSqlQuery & cover_query = statements.Prepare( database, StatementId::SelectCover );
+        cover_query.bindValue( ":cover_hash", hash );
+        if( !statements.Exec( database, StatementId::SelectCover, cover_query ) ){
+            error = cover_query.lastError().text();
+        } else if( cover_query.next() ){
+            cover = cover_query.value( 0 ).toByteArray();
+        }
+        cover_query.finish();
+    }
+    pool.Release();
+    return cover;
+}
+
+std::shared_ptr<MappedCover> CoverStore::Map( QString const & hash ) const
+{
+    QString const path = PathOf( hash );
+    if( !QFileInfo::exists( path ) ){
+        QString error {};
+        QByteArray const cover = Fetch( hash, error );
+        if( cover.isEmpty() || !Cache( hash, cover, error ) ) return nullptr;
+    }
+    auto mapped = std::make_shared<MappedCover>( path );
+    if( !mapped->Data() ) return nullptr;
+    return mapped;
+}
+
+void CoverStore::StartGarbageCollection()
+{
+    DatabaseExecutor::Instance().Submit( QueryPriority::Reporting, qApp, []( QSqlDatabase & database ){
+        QueryResult<QSet<QString>> result {};
+        bool const is_sqlite = StorageBackend::Current().Dialect() == SqlDialect::Sqlite;
+        QSqlQuery delete_query{ database };
+        QString const stored_before = is_sqlite ? QString( "datetime( 'now', '-%1 seconds' )" ).arg( GC_GRACE_SECONDS ) :
+                                                  QString( "NOW() - INTERVAL %1 SECOND" ).arg( GC_GRACE_SECONDS );
+        if( !QueryTracer::Instance().Exec( "delete_unreferenced_covers", delete_query,
+                                           QString( "DELETE FROM covers WHERE stored_at < %1 AND cover_hash NOT IN "
+                                                    "( SELECT cover_hash FROM inventory WHERE cover_hash IS NOT NULL )" )
+                                           .arg( stored_before ) ) ){
+            result.error = delete_query.lastError().text();
+            return result;
+        }
+
+        QSqlQuery hash_query{ database };
+        hash_query.setForwardOnly( true );
+        if( !QueryTracer::Instance().Exec( "select_cover_hashes", hash_query,
+                                           "SELECT DISTINCT cover_hash FROM inventory WHERE cover_hash IS NOT NULL" ) ){
+            result.error = hash_query.lastError().text();
+            return result;
+        }
+        while( hash_query.next() ) result.value.insert( hash_query.value( 0 ).toString() );
+        result.ok = true;
+        return result;
+    }, [this]( QueryResult<QSet<QString>> result ){
+        if( !result.ok ){
+            qDebug() << result.error;
+            return;
+        }
+        QSet<QString> const referenced = result.value;
+        QtConcurrent::run( [this, referenced]{ CollectGarbage( referenced ); } );
+    });
+}
+
+int CoverStore::CollectGarbage( QSet<QString> const & referenced )
+{
+    QDateTime const cutoff = QDateTime::currentDateTimeUtc().addSecs( -GC_GRACE_SECONDS );
+    int removed = 0;
+    QDirIterator iter{ directory, QDir::Files, QDirIterator::Subdirectories };
+    while( iter.hasNext() ){
+        QString const path = iter.next();
+        QFileInfo const info = iter.fileInfo();
+        if( referenced.contains( info.fileName() ) || info.lastModified().toUTC() > cutoff ) continue;
+        if( QFile::remove( path ) ) ++removed;
+    }
+    return removed;
+}
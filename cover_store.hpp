@@ -0,0 +1,67 @@
+#ifndef COVER_STORE_HPP
+#define COVER_STORE_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QSet>
+#include <QString>
+#include <memory>
+
+class QSqlDatabase;
+
+// a cover file mapped into memory for as long as the object lives
+class MappedCover
+{
+public:
+    explicit MappedCover( QString const & path );
+    ~MappedCover();
+    MappedCover( MappedCover const & ) = delete;
+    MappedCover & operator=( MappedCover const & ) = delete;
+
+    uchar const *Data() const { return data; }
+    qint64 Size() const { return size; }
+private:
+    QFile   file;
+    uchar   *data;
+    qint64  size;
+};
+
+// content-addressed store for the book covers. A cover is saved once in the covers table under the
+// SHA-256 of its bytes and the inventory row only keeps that hash, so identical covers share a row
+// and every till sees every cover. Each machine keeps the covers it has displayed in a local cache
+// next to the report journal( <cache>/<first two hex digits>/<hash> ) and reads them memory-mapped
+// from there. Covers no row refers to anymore are removed by StartGarbageCollection. All methods
+// are thread safe.
+class CoverStore
+{
+public:
+    static CoverStore & Instance();
+
+    // saves `cover` on `database`, the calling thread's connection, and returns its hash( empty on
+    // failure, with `error` set ). It may run inside the transaction that writes the row.
+    QString Put( QSqlDatabase & database, QByteArray const & cover, QString & error );
+    // from the local cache, a cover that is not there yet is fetched on a pooled connection of the
+    // calling thread first. nullptr if there's no such cover
+    std::shared_ptr<MappedCover> Map( QString const & hash ) const;
+
+    // deletes the covers no row refers to from the database, then the local cache files of those in
+    // the background. Covers stored in the last GC_GRACE_SECONDS are kept, their rows may not be
+    // committed yet
+    void StartGarbageCollection();
+    int  CollectGarbage( QSet<QString> const & referenced ); // local cache files only
+
+    static QString HashOf( QByteArray const & cover );
+    static int const GC_GRACE_SECONDS;
+private:
+    CoverStore();
+    CoverStore( CoverStore const & ) = delete;
+    CoverStore & operator=( CoverStore const & ) = delete;
+
+    QString PathOf( QString const & hash ) const;
+    bool Cache( QString const & hash, QByteArray const & cover, QString & error ) const;
+    static QByteArray Fetch( QString const & hash, QString & error );
+private:
+    QString directory;
+};
+
+#endif // COVER_STORE_HPP
@@ -0,0 +1,155 @@
+#include "db_executor.hpp"
+#include "connection_pool.hpp"
+#include "query_tracer.hpp"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+thread_local DatabaseExecutor::CancelFlag const *current_cancel_flag = nullptr;
+}
+
+DatabaseExecutor & DatabaseExecutor::Instance()
+{
+    // owned by the application object, so the worker is stopped before the process exits
+    static DatabaseExecutor *executor = new DatabaseExecutor( qApp );
+    return *executor;
+}
+
+DatabaseExecutor::DatabaseExecutor( QObject *parent ): QObject( parent ),
+    last_request_id{ 0 }, running_request_id{ 0 }, stopping{ false }, worker_thread( new QThread( this ) )
+{
+    ExecutorWorker *worker = new ExecutorWorker( this );
+    worker->moveToThread( worker_thread );
+    QObject::connect( worker_thread, SIGNAL(started()), worker, SLOT(onThreadStarted()) );
+    // direct, the GUI thread may be blocked waiting on the worker thread when this fires
+    QObject::connect( worker, SIGNAL(finished()), worker_thread, SLOT(quit()), Qt::DirectConnection );
+    QObject::connect( worker_thread, SIGNAL(finished()), worker, SLOT(deleteLater()) );
+    worker_thread->start();
+}
+
+DatabaseExecutor::~DatabaseExecutor()
+{
+    {
+        QMutexLocker lock{ &mutex };
+        stopping = true;
+        if( running_cancel_flag ) *running_cancel_flag = true;
+        task_available.wakeAll();
+    }
+    worker_thread->wait();
+}
+
+quint64 DatabaseExecutor::Enqueue( QueryPriority priority, Job job )
+{
+    int depth = 0;
+    quint64 request_id = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        request_id = ++last_request_id;
+        Task task{ request_id, std::move( job ), std::make_shared<std::atomic_bool>( false ) };
+        ( priority == QueryPriority::Interactive ? interactive_queue : reporting_queue )
+                .push_back( std::move( task ) );
+        depth = QueueDepthLocked();
+        task_available.wakeOne();
+    }
+    emit queueDepthChanged( depth );
+    return request_id;
+}
+
+bool DatabaseExecutor::Cancel( quint64 request_id )
+{
+    bool found = false;
+    int depth = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        for( std::deque<Task> *queue : { &interactive_queue, &reporting_queue } ){
+            auto iter = std::find_if( queue->begin(), queue->end(), [=]( Task const & task ){
+                return task.id == request_id;
+            });
+            if( iter != queue->end() ){
+                *iter->cancelled = true;
+                queue->erase( iter );
+                found = true;
+                break;
+            }
+        }
+        if( !found && request_id != 0 && running_request_id == request_id ){
+            *running_cancel_flag = true;
+            found = true;
+        }
+        depth = QueueDepthLocked();
+    }
+    if( found ) emit queueDepthChanged( depth );
+    return found;
+}
+
+int DatabaseExecutor::QueueDepth() const
+{
+    QMutexLocker lock{ &mutex };
+    return QueueDepthLocked();
+}
+
+int DatabaseExecutor::QueueDepthLocked() const
+{
+    return static_cast<int>( interactive_queue.size() + reporting_queue.size() ) +
+            ( running_request_id != 0 ? 1 : 0 );
+}
+
+bool DatabaseExecutor::IsCurrentRequestCancelled()
+{
+    return current_cancel_flag && **current_cancel_flag;
+}
+
+bool DatabaseExecutor::WaitForTask( Task & task )
+{
+    QMutexLocker lock{ &mutex };
+    while( !stopping && interactive_queue.empty() && reporting_queue.empty() ){
+        task_available.wait( &mutex );
+    }
+    if( stopping ) return false;
+
+    // interactive requests always go before reporting ones
+    std::deque<Task> & queue = interactive_queue.empty() ? reporting_queue : interactive_queue;
+    task = std::move( queue.front() );
+    queue.pop_front();
+    running_request_id = task.id;
+    running_cancel_flag = task.cancelled;
+    return true;
+}
+
+void DatabaseExecutor::FinishTask()
+{
+    int depth = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        running_request_id = 0;
+        running_cancel_flag.reset();
+        depth = QueueDepthLocked();
+    }
+    emit queueDepthChanged( depth );
+}
+
+ExecutorWorker::ExecutorWorker( DatabaseExecutor *db_executor, QObject *parent ):
+    QObject( parent ), executor{ db_executor }
+{
+}
+
+void ExecutorWorker::onThreadStarted()
+{
+    ConnectionPool & pool = ConnectionPool::Instance();
+    DatabaseExecutor::Task task {};
+    while( executor->WaitForTask( task ) ){
+        // validated by the pool, so a restarted server is reconnected before the request runs
+        QSqlDatabase database = pool.Acquire();
+        current_cancel_flag = &task.cancelled;
+        task.job( database, task.cancelled );
+        QueryTracer::Instance().Flush(); // a SELECT whose rows were read by hand
+        current_cancel_flag = nullptr;
+        task = DatabaseExecutor::Task{};
+        executor->FinishTask();
+    }
+    pool.Release();
+    emit finished();
+}
@@ -0,0 +1,109 @@
+#ifndef DB_EXECUTOR_HPP
+#define DB_EXECUTOR_HPP
+
+#include <QMetaObject>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSqlDatabase>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+class QThread;
+
+enum class QueryPriority {
+    Interactive = 0, // somebody is waiting on the result
+    Reporting        // long running work that may wait behind interactive requests
+};
+
+template<typename T>
+struct QueryResult
+{
+    bool    ok = false;
+    QString error;
+    T       value {};
+};
+
+// every statement the GUI needs is submitted here and executed on a single worker thread that owns
+// its own pooled connection. Results are handed back on the GUI thread, so no SQL ever blocks the window.
+class DatabaseExecutor : public QObject
+{
+    Q_OBJECT
+public:
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+    using Job = std::function<void( QSqlDatabase &, CancelFlag const & )>;
+
+    static DatabaseExecutor & Instance();
+    ~DatabaseExecutor();
+
+    // runs `work( database )` on the worker thread, then `done( result )` on the GUI thread unless the
+    // request has been cancelled or `context` destroyed in the meantime. Returns the request's id.
+    template<typename Work, typename Done>
+    quint64 Submit( QueryPriority priority, QObject *context, Work work, Done done );
+
+    bool Cancel( quint64 request_id ); // drops a queued request, or the result of a running one
+    int  QueueDepth() const; // queued plus in-flight requests
+
+    // for long running work to poll between rows, only meaningful on the worker thread
+    static bool IsCurrentRequestCancelled();
+signals:
+    void queueDepthChanged( int );
+private:
+    friend class ExecutorWorker;
+
+    struct Task
+    {
+        quint64     id = 0;
+        Job         job;
+        CancelFlag  cancelled;
+    };
+
+    explicit DatabaseExecutor( QObject *parent = nullptr );
+    quint64 Enqueue( QueryPriority priority, Job job );
+    bool WaitForTask( Task & task ); // false once the executor is shutting down
+    void FinishTask();
+    int  QueueDepthLocked() const;
+private:
+    mutable QMutex      mutex;
+    QWaitCondition      task_available;
+    std::deque<Task>    interactive_queue;
+    std::deque<Task>    reporting_queue;
+    quint64             last_request_id;
+    quint64             running_request_id;
+    CancelFlag          running_cancel_flag;
+    bool                stopping;
+    QThread             *worker_thread;
+};
+
+class ExecutorWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ExecutorWorker( DatabaseExecutor *executor, QObject *parent = nullptr );
+public slots:
+    void onThreadStarted();
+signals:
+    void finished();
+private:
+    DatabaseExecutor *executor;
+};
+
+template<typename Work, typename Done>
+quint64 DatabaseExecutor::Submit( QueryPriority priority, QObject *context, Work work, Done done )
+{
+    QPointer<QObject> receiver{ context };
+    return Enqueue( priority, [this, receiver, work, done]( QSqlDatabase & database,
+                    CancelFlag const & cancelled ) mutable {
+        auto result = work( database );
+        // the checks happen on the GUI thread, where `receiver` lives
+        QMetaObject::invokeMethod( this, [receiver, cancelled, done, result]() mutable {
+            if( receiver && !*cancelled ) done( std::move( result ) );
+        }, Qt::QueuedConnection );
+    });
+}
+
+#endif // DB_EXECUTOR_HPP
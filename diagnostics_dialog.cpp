@@ -0,0 +1,90 @@
+#include "diagnostics_dialog.hpp"
+#include "query_tracer.hpp"
+
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+int const DiagnosticsDialog::REFRESH_INTERVAL_MS = 1000;
+
+namespace {
+QTableWidgetItem *NumberItem( QString const & text )
+{
+    QTableWidgetItem *item = new QTableWidgetItem( text );
+    item->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+    return item;
+}
+
+QString AsMsecs( qint64 usecs )
+{
+    return QString::number( usecs / 1000.0, 'f', 2 );
+}
+}
+
+DiagnosticsDialog::DiagnosticsDialog( QWidget *parent ) : QDialog( parent ),
+    countSpin( new QSpinBox ), thresholdSpin( new QSpinBox ), statementTable( new QTableWidget ),
+    refreshTimer( new QTimer( this ) )
+{
+    setWindowTitle( tr( "Query diagnostics" ) );
+    resize( 900, 450 );
+
+    countSpin->setRange( 1, 50 );
+    countSpin->setValue( 10 );
+    thresholdSpin->setRange( 1, 60 * 1000 );
+    thresholdSpin->setSuffix( tr( " ms" ) );
+    thresholdSpin->setValue( QueryTracer::Instance().SlowQueryThreshold() );
+
+    QStringList const headers { tr( "Statement" ), tr( "Calls" ), tr( "p50 (ms)" ), tr( "p95 (ms)" ),
+                                tr( "p99 (ms)" ), tr( "Max (ms)" ), tr( "Rows/call" ), tr( "KB" ) };
+    statementTable->setColumnCount( headers.size() );
+    statementTable->setHorizontalHeaderLabels( headers );
+    statementTable->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    statementTable->setSelectionBehavior( QAbstractItemView::SelectRows );
+    statementTable->verticalHeader()->hide();
+    statementTable->horizontalHeader()->setSectionResizeMode( 0, QHeaderView::Stretch );
+
+    QFormLayout *form = new QFormLayout;
+    form->addRow( tr( "Slowest statements" ), countSpin );
+    form->addRow( tr( "Log statements slower than" ), thresholdSpin );
+
+    QLabel *logLabel = new QLabel( tr( "Slow query log: %1" ).arg( QueryTracer::Instance().SlowLogPath() ) );
+    logLabel->setTextInteractionFlags( Qt::TextSelectableByMouse );
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->addLayout( form );
+    layout->addWidget( statementTable );
+    layout->addWidget( logLabel );
+    setLayout( layout );
+
+    QObject::connect( countSpin, SIGNAL(valueChanged(int)), this, SLOT(onRefresh()) );
+    QObject::connect( thresholdSpin, SIGNAL(valueChanged(int)), this, SLOT(onThresholdChanged(int)) );
+    QObject::connect( refreshTimer, SIGNAL(timeout()), this, SLOT(onRefresh()) );
+    refreshTimer->start( REFRESH_INTERVAL_MS );
+    onRefresh();
+}
+
+void DiagnosticsDialog::onRefresh()
+{
+    QList<StatementSummary> const summaries = QueryTracer::Instance().Slowest( countSpin->value() );
+    statementTable->setRowCount( summaries.size() );
+    for( int row = 0; row != summaries.size(); ++row ){
+        StatementSummary const & summary = summaries[row];
+        statementTable->setItem( row, 0, new QTableWidgetItem( summary.name ) );
+        statementTable->setItem( row, 1, NumberItem( QString::number( summary.calls ) ) );
+        statementTable->setItem( row, 2, NumberItem( AsMsecs( summary.p50 ) ) );
+        statementTable->setItem( row, 3, NumberItem( AsMsecs( summary.p95 ) ) );
+        statementTable->setItem( row, 4, NumberItem( AsMsecs( summary.p99 ) ) );
+        statementTable->setItem( row, 5, NumberItem( AsMsecs( summary.max ) ) );
+        statementTable->setItem( row, 6, NumberItem( QString::number( summary.rows / double( qMax<qint64>( 1, summary.calls ) ), 'f', 1 ) ) );
+        statementTable->setItem( row, 7, NumberItem( QString::number( summary.bytes / 1024.0, 'f', 1 ) ) );
+    }
+}
+
+void DiagnosticsDialog::onThresholdChanged( int msecs )
+{
+    QueryTracer::Instance().SetSlowQueryThreshold( msecs );
+}
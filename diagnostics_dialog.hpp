@@ -0,0 +1,30 @@
+#ifndef DIAGNOSTICS_DIALOG_HPP
+#define DIAGNOSTICS_DIALOG_HPP
+
+#include <QDialog>
+
+class QSpinBox;
+class QTableWidget;
+class QTimer;
+
+// the statements the QueryTracer has seen, slowest first, refreshed every second. Not in any menu,
+// AppMainWindow opens it on Ctrl+Shift+D
+class DiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit DiagnosticsDialog( QWidget *parent = nullptr );
+    ~DiagnosticsDialog() = default;
+
+    static int const REFRESH_INTERVAL_MS;
+private slots:
+    void onRefresh();
+    void onThresholdChanged( int msecs );
+private:
+    QSpinBox        *countSpin;
+    QSpinBox        *thresholdSpin;
+    QTableWidget    *statementTable;
+    QTimer          *refreshTimer;
+};
+
+#endif // DIAGNOSTICS_DIALOG_HPP
@@ -0,0 +1,509 @@
+#include "inventory_cache.hpp"
+#include "connection_settings.hpp"
+#include "db_executor.hpp"
+#include "query_tracer.hpp"
+#include "statement_cache.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QCache>
+#include <QVector>
+#include <QtConcurrent>
+#include <set>
+#include <utility>
+#include "search_index.hpp"
+
+int const InventoryCache::MAX_CACHE_BYTES = 32 * 1024 * 1024;
+int const InventoryCache::SNAPSHOT_MAX_AGE_DAYS = 30;
+int const InventoryCache::CATCH_UP_MARGIN_SECONDS = 300;
+
+namespace {
+struct LoadedInventory
+{
+    QList<DatabaseRecordFormat> records;
+    bool                        complete;
+    QString                     watermark;
+};
+
+struct InventoryDelta
+{
+    QList<DatabaseRecordFormat> changed;
+    QList<unsigned int>         deleted;
+    qint64                      row_count = 0;
+    QString                     watermark;
+};
+
+// the database's clock in the format of updated_at, taken before anything is read
+bool ReadWatermark( QSqlDatabase & database, QString & watermark, QString & error )
+{
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & now_query = statements.Prepare( database, StatementId::SelectWatermark );
+    if( !statements.Exec( database, StatementId::SelectWatermark, now_query ) || !now_query.next() ){
+        error = now_query.lastError().text();
+        return false;
+    }
+    watermark = now_query.value( 0 ).toString();
+    now_query.finish();
+    return true;
+}
+}
+
+// the cached copies together with what is derived from them, so a load can build all of it off the
+// GUI thread and swap it in at once. Copies log their own eviction, the index and the sorted keys
+// then let go of them too.
+struct InventoryCache::Records
+{
+    struct Entry
+    {
+        DatabaseRecordFormat    record;
+        QVector<unsigned int>   *evicted;
+        ~Entry(){ evicted->append( record.serial_number ); }
+    };
+
+    QVector<unsigned int>       evicted; // before the cache, its entries log into it while it is destroyed
+    QCache<unsigned int, Entry> cache{ MAX_CACHE_BYTES }; // least recently used go first
+    SearchIndex                 index;
+    std::set<unsigned int>      sorted_keys; // what Page() walks, without sorting or touching every record
+
+    // false if something had to be evicted to make room
+    bool Store( DatabaseRecordFormat const & record )
+    {
+        int const cost = Cost( record );
+        cache.remove( record.serial_number );
+        bool const is_fitting = cache.totalCost() + cost <= cache.maxCost();
+        cache.insert( record.serial_number, new Entry{ record, &evicted }, cost );
+        index.Insert( record.serial_number, record.book_title, record.author_name, record.publisher );
+        sorted_keys.insert( record.serial_number );
+        ForgetEvicted();
+        return is_fitting;
+    }
+
+    void Drop( unsigned int serial_number )
+    {
+        cache.remove( serial_number );
+        ForgetEvicted();
+    }
+
+    void ForgetEvicted()
+    {
+        for( unsigned int const serial_number : evicted ){
+            if( cache.contains( serial_number ) ) continue; // replaced rather than gone
+            index.Remove( serial_number );
+            sorted_keys.erase( serial_number );
+        }
+        evicted.clear();
+    }
+
+    DatabaseRecordFormat * Object( unsigned int serial_number ) const
+    {
+        Entry *entry = cache.object( serial_number );
+        return entry ? &entry->record : nullptr;
+    }
+};
+
+InventoryCache::InventoryCache( QObject *parent ): QObject( parent ),
+    records( new Records ), generation( 0 ), loading( false ), complete( false ), synced( false ),
+    reading_snapshot( false ), load_requested( false )
+{
+}
+
+InventoryCache::~InventoryCache() = default;
+
+InventoryCache & InventoryCache::Instance()
+{
+    static InventoryCache *cache = new InventoryCache( qApp );
+    return *cache;
+}
+
+int InventoryCache::Cost( DatabaseRecordFormat const & record )
+{
+    int const characters = record.book_title.size() + record.author_name.size() + record.publisher.size()
+            + record.location.size() + record.cover_hash.size();
+    // a std::set node: three links, the colour and the key
+    int const SORTED_KEY_BYTES = static_cast<int>( 4 * sizeof( void * ) + sizeof( unsigned int ) );
+    return static_cast<int>( sizeof( DatabaseRecordFormat ) ) + characters * static_cast<int>( sizeof( QChar ) )
+            + SearchIndex::DocumentBytes( record.book_title, record.author_name, record.publisher )
+            + SORTED_KEY_BYTES;
+}
+
+void InventoryCache::LoadSnapshot()
+{
+    {
+        QMutexLocker lock{ &mutex };
+        if( loading || complete ) return;
+        loading = true;
+        reading_snapshot = true;
+        touched.clear();
+    }
+    QString const identity = DatabaseIdentity();
+    QtConcurrent::run( [this, identity]{
+        QElapsedTimer elapsed {};
+        elapsed.start();
+        QList<DatabaseRecordFormat> loaded {};
+        SnapshotStamp snapshot_stamp {};
+        if( InventorySnapshot::Read( identity, loaded, snapshot_stamp ) &&
+                snapshot_stamp.synced_at.daysTo( QDateTime::currentDateTime() ) < SNAPSHOT_MAX_AGE_DAYS ){
+            Populate( loaded, true, snapshot_stamp, false );
+            QueryTracer::Instance().Timed( "inventory_cache_warm_start", elapsed.nsecsElapsed() / 1000, loaded.size() );
+        }
+        QMetaObject::invokeMethod( this, [this]{ SnapshotLoaded(); }, Qt::QueuedConnection );
+    });
+}
+
+void InventoryCache::SnapshotLoaded()
+{
+    bool is_load_requested = false;
+    {
+        QMutexLocker lock{ &mutex };
+        reading_snapshot = false;
+        loading = false;
+        is_load_requested = load_requested;
+        load_requested = false;
+    }
+    if( is_load_requested ) Load();
+}
+
+void InventoryCache::Load()
+{
+    QString since {};
+    {
+        QMutexLocker lock{ &mutex };
+        if( reading_snapshot ){
+            load_requested = true;
+            return;
+        }
+        if( loading || ( complete && synced ) ) return;
+        loading = true;
+        touched.clear();
+        // warm from the snapshot, only what changed since is missing
+        if( complete ) since = stamp.watermark;
+    }
+    if( !since.isEmpty() ){
+        CatchUp( since );
+        return;
+    }
+
+    // a cold start: from here until every record is served from memory
+    QElapsedTimer started {};
+    started.start();
+    QString const identity = DatabaseIdentity();
+    DatabaseExecutor::Instance().Submit( QueryPriority::Reporting, this, []( QSqlDatabase & database )
+    {
+        QueryResult<LoadedInventory> result {};
+        result.value.complete = true;
+        if( !ReadWatermark( database, result.value.watermark, result.error ) ) return result;
+        StatementCache & statements = StatementCache::ForThread();
+        QSqlQuery & inventory_query = statements.Prepare( database, StatementId::SelectInventory );
+        if( !statements.Exec( database, StatementId::SelectInventory, inventory_query ) ){
+            result.error = inventory_query.lastError().text();
+            return result;
+        }
+        // stop reading once the budget is spent, the rest would only evict what we already have
+        QElapsedTimer elapsed {};
+        elapsed.start();
+        qint64 total_cost = 0;
+        RowDecoder<DatabaseRecordFormat> const decoder{ inventory_query };
+        while( inventory_query.next() ){
+            DatabaseRecordFormat record {};
+            decoder.Decode( inventory_query, record );
+            total_cost += Cost( record );
+            if( total_cost > MAX_CACHE_BYTES ){
+                result.value.complete = false;
+                break;
+            }
+            result.value.records.append( std::move( record ) );
+        }
+        QueryTracer::Instance().Fetched( result.value.records.size(), total_cost, elapsed.nsecsElapsed() / 1000 );
+        inventory_query.finish();
+        result.ok = true;
+        return result;
+    }, [this, identity, started]( QueryResult<LoadedInventory> result ){
+        if( !result.ok ){
+            qDebug() << result.error;
+            QMutexLocker lock{ &mutex };
+            loading = false;
+            return;
+        }
+        SnapshotStamp const load_stamp{ identity, result.value.watermark, QDateTime::currentDateTime() };
+        QtConcurrent::run( [this, result, load_stamp, started]{
+            Populate( result.value.records, result.value.complete, load_stamp, true );
+            QueryTracer::Instance().Timed( "inventory_cache_cold_start", started.nsecsElapsed() / 1000,
+                                           result.value.records.size() );
+            if( IsComplete() ){
+                SaveSnapshot();
+            } else {
+                InventorySnapshot::Remove(); // it could only ever be partial
+            }
+        });
+    });
+}
+
+void InventoryCache::CatchUp( QString const & since )
+{
+    QElapsedTimer started {};
+    started.start();
+    DatabaseExecutor::Instance().Submit( QueryPriority::Reporting, this, [since]( QSqlDatabase & database )
+    {
+        QueryResult<InventoryDelta> result {};
+        if( !ReadWatermark( database, result.value.watermark, result.error ) ) return result;
+
+        StatementCache & statements = StatementCache::ForThread();
+        QSqlQuery & deleted_query = statements.Prepare( database, StatementId::SelectDeletedSince );
+        deleted_query.bindValue( ":since", since );
+        deleted_query.bindValue( ":margin", CATCH_UP_MARGIN_SECONDS );
+        if( !statements.Exec( database, StatementId::SelectDeletedSince, deleted_query ) ){
+            result.error = deleted_query.lastError().text();
+            return result;
+        }
+        while( deleted_query.next() ) result.value.deleted.append( deleted_query.value( 0 ).toUInt() );
+        deleted_query.finish();
+
+        QSqlQuery & changed_query = statements.Prepare( database, StatementId::SelectInventoryChangedSince );
+        changed_query.bindValue( ":since", since );
+        changed_query.bindValue( ":margin", CATCH_UP_MARGIN_SECONDS );
+        if( !statements.Exec( database, StatementId::SelectInventoryChangedSince, changed_query ) ){
+            result.error = changed_query.lastError().text();
+            return result;
+        }
+        FillFromQuery( result.value.changed, changed_query );
+        changed_query.finish();
+
+        // a cheap check that nothing went missing behind the tombstones' back
+        QSqlQuery count_query{ database };
+        if( !QueryTracer::Instance().Exec( "count_inventory", count_query, "SELECT COUNT(*) FROM inventory" ) ||
+            !count_query.next() ){
+            result.error = count_query.lastError().text();
+            return result;
+        }
+        result.value.row_count = count_query.value( 0 ).toLongLong();
+        result.ok = true;
+        return result;
+    }, [this, started]( QueryResult<InventoryDelta> result ){
+        if( !result.ok ){
+            // still serving the snapshot, the next Load() tries again
+            qDebug() << result.error;
+            QMutexLocker lock{ &mutex };
+            loading = false;
+            return;
+        }
+        bool is_consistent = true;
+        quint64 current_generation = 0;
+        {
+            QMutexLocker lock{ &mutex };
+            for( unsigned int const serial_number : result.value.deleted ){
+                if( !touched.contains( serial_number ) ) Drop( serial_number );
+            }
+            for( DatabaseRecordFormat const & record : result.value.changed ){
+                if( !touched.contains( record.serial_number ) ) Store( record );
+            }
+            touched.clear();
+            loading = false;
+            is_consistent = !complete || records->cache.count() == result.value.row_count;
+            synced = true;
+            stamp.watermark = result.value.watermark;
+            stamp.synced_at = QDateTime::currentDateTime();
+            current_generation = ++generation;
+        }
+        QueryTracer::Instance().Timed( "inventory_cache_catch_up", started.nsecsElapsed() / 1000,
+                                       result.value.changed.size() + result.value.deleted.size() );
+        if( !is_consistent ){
+            qDebug() << "The snapshot is out of step with the database, loading everything again";
+            InvalidateAll();
+            return;
+        }
+        emit invalidated( current_generation );
+        QtConcurrent::run( [this]{ SaveSnapshot(); } );
+    });
+}
+
+void InventoryCache::SaveSnapshot()
+{
+    QList<DatabaseRecordFormat> all {};
+    SnapshotStamp current_stamp {};
+    {
+        QMutexLocker lock{ &mutex };
+        if( !synced || !complete ) return;
+        current_stamp = stamp;
+        all.reserve( records->cache.count() );
+        for( unsigned int const serial_number : records->sorted_keys ) all.append( *records->Object( serial_number ) );
+    }
+    QMutexLocker lock{ &snapshot_mutex };
+    QElapsedTimer elapsed {};
+    elapsed.start();
+    QString error {};
+    if( !InventorySnapshot::Write( all, current_stamp, error ) ){
+        qDebug() << "Unable to write the inventory snapshot:" << error;
+        return;
+    }
+    QueryTracer::Instance().Timed( "inventory_snapshot_write", elapsed.nsecsElapsed() / 1000, all.size() );
+}
+
+void InventoryCache::Populate( QList<DatabaseRecordFormat> const & loaded, bool complete_load,
+                               SnapshotStamp const & load_stamp, bool synced_load )
+{
+    // built without the mutex, write-throughs carry on meanwhile and are taken over below
+    std::unique_ptr<Records> fresh{ new Records };
+    bool is_complete = complete_load;
+    for( DatabaseRecordFormat const & record : loaded ){
+        if( !fresh->Store( record ) ) is_complete = false;
+    }
+
+    quint64 current_generation = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        // records written through while we were loading are newer than what the load saw
+        for( unsigned int const serial_number : touched ){
+            if( DatabaseRecordFormat const *current = Object( serial_number ) ){
+                if( !fresh->Store( *current ) ) is_complete = false;
+            } else {
+                fresh->Drop( serial_number );
+            }
+        }
+        records.swap( fresh );
+        complete = is_complete;
+        touched.clear();
+        loading = false;
+        synced = synced_load;
+        stamp = load_stamp;
+        current_generation = ++generation;
+    }
+    // the replaced copies are freed here, outside the mutex
+    fresh.reset();
+    emit invalidated( current_generation );
+}
+
+void InventoryCache::InvalidateAll()
+{
+    std::unique_ptr<Records> stale{ new Records };
+    quint64 current_generation = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        records.swap( stale );
+        complete = false;
+        synced = false;
+        stamp.watermark.clear();
+        current_generation = ++generation;
+    }
+    stale.reset();
+    emit invalidated( current_generation );
+    Load();
+}
+
+void InventoryCache::Store( DatabaseRecordFormat const & record )
+{
+    if( !records->Store( record ) ) complete = false; // something was evicted
+}
+
+void InventoryCache::Drop( unsigned int serial_number )
+{
+    records->Drop( serial_number );
+}
+
+DatabaseRecordFormat * InventoryCache::Object( unsigned int serial_number ) const
+{
+    return records->Object( serial_number );
+}
+
+quint64 InventoryCache::Touch( unsigned int serial_number )
+{
+    if( loading ) touched.insert( serial_number );
+    return ++generation;
+}
+
+void InventoryCache::Insert( DatabaseRecordFormat const & record )
+{
+    quint64 current_generation = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        Store( record );
+        current_generation = Touch( record.serial_number );
+    }
+    emit recordChanged( record.serial_number, current_generation );
+}
+
+void InventoryCache::SetStock( unsigned int serial_number, unsigned int stock )
+{
+    quint64 current_generation = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        if( DatabaseRecordFormat *record = Object( serial_number ) ){
+            record->quantity = stock;
+        } else if( loading ){
+            // we cannot patch what the load has not delivered yet, let the load have it
+            return;
+        }
+        current_generation = Touch( serial_number );
+    }
+    emit recordChanged( serial_number, current_generation );
+}
+
+void InventoryCache::Remove( unsigned int serial_number )
+{
+    quint64 current_generation = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        Drop( serial_number );
+        current_generation = Touch( serial_number );
+    }
+    emit recordChanged( serial_number, current_generation );
+}
+
+bool InventoryCache::Find( unsigned int serial_number, DatabaseRecordFormat & record ) const
+{
+    QMutexLocker lock{ &mutex };
+    if( DatabaseRecordFormat const *cached = Object( serial_number ) ){
+        record = *cached;
+        return true;
+    }
+    return false;
+}
+
+bool InventoryCache::Search( QString const & terms, QList<DatabaseRecordFormat> & results, int limit ) const
+{
+    QMutexLocker lock{ &mutex };
+    if( !complete ) return false;
+
+    results.clear();
+    for( unsigned int const serial_number : records->index.Search( terms, limit ) ){
+        if( DatabaseRecordFormat const *record = Object( serial_number ) ) results.append( *record );
+    }
+    return true;
+}
+
+bool InventoryCache::Page( unsigned int key, bool forward, int page_size,
+                           QList<DatabaseRecordFormat> & page ) const
+{
+    QMutexLocker lock{ &mutex };
+    if( !complete ) return false;
+
+    // only the records on the page are looked up, and so only they count as recently used
+    page.clear();
+    if( forward ){
+        std::set<unsigned int> const & keys = records->sorted_keys;
+        for( auto iter = keys.upper_bound( key ); iter != keys.cend() && page.size() < page_size; ++iter ){
+            if( DatabaseRecordFormat const *record = Object( *iter ) ) page.append( *record );
+        }
+    } else {
+        std::set<unsigned int> const & keys = records->sorted_keys;
+        for( auto iter = keys.lower_bound( key ); iter != keys.cbegin() && page.size() < page_size; ){
+            --iter;
+            if( DatabaseRecordFormat const *record = Object( *iter ) ) page.prepend( *record );
+        }
+    }
+    return true;
+}
+
+bool InventoryCache::IsComplete() const
+{
+    QMutexLocker lock{ &mutex };
+    return complete;
+}
+
+quint64 InventoryCache::Generation() const
+{
+    QMutexLocker lock{ &mutex };
+    return generation;
+}
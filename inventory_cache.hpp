@@ -0,0 +1,93 @@
+#ifndef INVENTORY_CACHE_HPP
+#define INVENTORY_CACHE_HPP
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <memory>
+#include "resources.hpp"
+#include "inventory_snapshot.hpp"
+
+// process-wide copy of the inventory keyed by serial_number( covers are in the CoverStore ).
+// It is loaded once in the background and then written through by every path that changes the
+// inventory, so reads are answered without going back to the database. A complete cache is kept
+// on disk as an InventorySnapshot, stamped with the server time of its last sync( the watermark ):
+// the next start serves from the snapshot right away and only fetches the rows changed or deleted
+// since then. The cache is bounded by
+// MAX_CACHE_BYTES, once a record had to be evicted it is no longer complete and searches go to
+// the database again; single records are still served while they are cached. A record is charged
+// for its copy, its share of the search index and its sorted key, which all go when it is evicted.
+// Only the index's dictionary of words and trigrams is left out( see SearchIndex::DocumentBytes ).
+// Every method is thread safe, the write-through calls come from the executor's threads.
+class InventoryCache : public QObject
+{
+    Q_OBJECT
+public:
+    static InventoryCache & Instance();
+    ~InventoryCache() override;
+
+    // warm start from the on-disk snapshot, in the background. Call it before Load()
+    void LoadSnapshot();
+    // loads the whole inventory in the background( at most once at a time ). After a warm start only
+    // the changes since the snapshot's watermark are fetched
+    void Load();
+    // writes the snapshot if the cache is complete and has been synced with the database, blocks
+    void SaveSnapshot();
+    // drops everything and loads again, for when the inventory was changed behind our back
+    void InvalidateAll();
+
+    // write-through, to be called once the change is committed
+    void Insert( DatabaseRecordFormat const & record );
+    void SetStock( unsigned int serial_number, unsigned int stock );
+    void Remove( unsigned int serial_number );
+
+    bool Find( unsigned int serial_number, DatabaseRecordFormat & record ) const;
+    // ranked prefix/substring matches on title, author and publisher( see SearchIndex ), at most
+    // `limit` of them if it is positive. False if the cache cannot answer for the whole inventory,
+    // the caller must ask the database then
+    bool Search( QString const & terms, QList<DatabaseRecordFormat> & results, int limit = 0 ) const;
+    // the same window InventoryPager would fetch: up to page_size records after( or before ) key
+    bool Page( unsigned int key, bool forward, int page_size, QList<DatabaseRecordFormat> & page ) const;
+    bool IsComplete() const;
+    // bumped by every change, a view that remembers it can tell whether it is stale
+    quint64 Generation() const;
+
+    static int const MAX_CACHE_BYTES;
+    static int const SNAPSHOT_MAX_AGE_DAYS;   // older snapshots are ignored, older tombstones dropped
+    static int const CATCH_UP_MARGIN_SECONDS; // re-read before the watermark, for late commits
+signals:
+    // emitted after a record was inserted, updated or removed
+    void recordChanged( unsigned int serial_number, quint64 generation );
+    void invalidated( quint64 generation );
+private:
+    struct Records;
+
+    explicit InventoryCache( QObject *parent = nullptr );
+    // builds the loaded records into a cache of their own, then swaps it in. Not on the GUI thread
+    void Populate( QList<DatabaseRecordFormat> const & records, bool complete_load, SnapshotStamp const & stamp,
+                   bool synced_load );
+    void SnapshotLoaded();
+    void CatchUp( QString const & since );
+    // mutex must be held for these
+    void Store( DatabaseRecordFormat const & record );
+    void Drop( unsigned int serial_number );
+    DatabaseRecordFormat * Object( unsigned int serial_number ) const;
+    quint64 Touch( unsigned int serial_number ); // mutex must be held
+    static int Cost( DatabaseRecordFormat const & record ); // in bytes, see MAX_CACHE_BYTES
+private:
+    mutable QMutex      mutex;
+    std::unique_ptr<Records> records; // the copies, their search index and their sorted keys
+    QSet<unsigned int>  touched; // changed while a load is in flight, the load must not overwrite them
+    quint64             generation;
+    bool                loading;
+    bool                complete;
+    bool                synced;            // with the database, by a load or a catch-up in this run
+    bool                reading_snapshot;
+    bool                load_requested;    // while the snapshot was read
+    SnapshotStamp       stamp;             // of the last sync, or of the snapshot until then
+    QMutex              snapshot_mutex;    // one writer of the snapshot file at a time
+};
+
+#endif // INVENTORY_CACHE_HPP
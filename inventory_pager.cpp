@@ -0,0 +1,178 @@
+#include "inventory_pager.hpp"
+#include "db_executor.hpp"
+#include "inventory_cache.hpp"
+#include "statement_cache.hpp"
+
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTimer>
+#include <algorithm>
+
+int const InventoryPager::PAGE_SIZE = 50;
+
+namespace {
+QueryResult<QList<DatabaseRecordFormat>> FetchPage( QSqlDatabase & database, unsigned int key, bool forward,
+                                                    int page_size )
+{
+    QueryResult<QList<DatabaseRecordFormat>> result {};
+    StatementId const statement = forward ? StatementId::InventoryPageAfter : StatementId::InventoryPageBefore;
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & page_query = statements.Prepare( database, statement );
+    page_query.bindValue( ":key", key );
+    page_query.bindValue( ":page_size", page_size );
+
+    if( !statements.Exec( database, statement, page_query ) ){
+        result.error = page_query.lastError().text();
+        return result;
+    }
+    FillRecordFromQuery( result.value, page_query );
+    if( !forward ){
+        std::reverse( result.value.begin(), result.value.end() );
+    }
+    result.ok = true;
+    return result;
+}
+}
+
+InventoryPager::InventoryPager( int size, QObject *parent ):
+    QObject( parent ), page_size{ size }, last_ticket{ 0 }, anchor{ 0 }, pending_move{ PendingMove::None }
+{
+}
+
+void InventoryPager::Start()
+{
+    previous = next = current = Window{};
+    anchor = 0;
+    current.ticket = Request( anchor, true );
+}
+
+void InventoryPager::Reanchor()
+{
+    // the neighbours were cut at the old window's first and last keys, they are fetched again
+    previous = next = Window{};
+    pending_move = PendingMove::None;
+    current.ticket = Request( anchor, true );
+    current.reloading = true;
+    current.stepping_back = false;
+}
+
+int InventoryPager::Request( unsigned int key, bool forward )
+{
+    int const ticket = ++last_ticket;
+    int const size = page_size;
+    QList<DatabaseRecordFormat> cached_page {};
+    if( InventoryCache::Instance().Page( key, forward, size, cached_page ) ){
+        // delivered like a fetch, the caller records the ticket before the page arrives
+        QTimer::singleShot( 0, this, [this, ticket, cached_page]{
+            OnPageFetched( ticket, cached_page, true );
+        });
+        return ticket;
+    }
+    DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this, [=]( QSqlDatabase & database ){
+        return FetchPage( database, key, forward, size );
+    }, [this, ticket]( QueryResult<QList<DatabaseRecordFormat>> result ){
+        if( !result.ok ) qDebug() << result.error;
+        OnPageFetched( ticket, std::move( result.value ), result.ok );
+    });
+    return ticket;
+}
+
+void InventoryPager::Prefetch()
+{
+    if( current.records.isEmpty() ) return;
+
+    if( !next.loaded && next.ticket == 0 ){
+        next.ticket = Request( current.records.last().serial_number, true );
+    }
+    if( !previous.loaded && previous.ticket == 0 ){
+        previous.ticket = Request( current.records.first().serial_number, false );
+    }
+}
+
+bool InventoryPager::HasNext() const
+{
+    return !current.records.isEmpty() && !( next.loaded && next.records.isEmpty() );
+}
+
+bool InventoryPager::HasPrevious() const
+{
+    return !current.records.isEmpty() && !( previous.loaded && previous.records.isEmpty() );
+}
+
+bool InventoryPager::MoveNext()
+{
+    if( !HasNext() ) return false;
+    if( !next.loaded ){
+        pending_move = PendingMove::Next;
+        return false;
+    }
+    pending_move = PendingMove::None;
+    previous = std::move( current );
+    current = std::move( next );
+    next = Window{};
+    anchor = current.records.first().serial_number - 1;
+    Prefetch();
+    emit pageChanged( true );
+    return true;
+}
+
+bool InventoryPager::MovePrevious()
+{
+    if( !HasPrevious() ) return false;
+    if( !previous.loaded ){
+        pending_move = PendingMove::Previous;
+        return false;
+    }
+    pending_move = PendingMove::None;
+    next = std::move( current );
+    current = std::move( previous );
+    previous = Window{};
+    anchor = current.records.first().serial_number - 1;
+    Prefetch();
+    emit pageChanged( false );
+    return true;
+}
+
+void InventoryPager::OnPageFetched( int ticket, QList<DatabaseRecordFormat> records, bool ok )
+{
+    if( !ok ){
+        // forget the request so browsing in that direction can be retried
+        for( Window *window : { &previous, &current, &next } ){
+            if( window->ticket == ticket ) window->ticket = 0;
+        }
+        current.reloading = current.stepping_back = false;
+        pending_move = PendingMove::None;
+        emit fetchFailed();
+        return;
+    }
+
+    if( current.ticket == ticket && current.reloading && !current.stepping_back && records.isEmpty() &&
+            anchor != 0 ){
+        // everything from the anchor on is gone, step back to the window before it. Only once: if that
+        // one is empty too, the inventory is and the reload ends with an empty window
+        current.stepping_back = true;
+        current.ticket = Request( anchor + 1, false );
+    } else if( current.ticket == ticket ){
+        bool const is_reload = current.reloading;
+        current.records = std::move( records );
+        current.loaded = true;
+        current.ticket = 0;
+        current.reloading = current.stepping_back = false;
+        if( !current.records.isEmpty() ) anchor = current.records.first().serial_number - 1;
+        Prefetch();
+        if( is_reload ) emit pageReloaded();
+        else emit pageChanged( true );
+    } else if( next.ticket == ticket ){
+        next.records = std::move( records );
+        next.loaded = true;
+        next.ticket = 0;
+        if( pending_move == PendingMove::Next ) MoveNext();
+    } else if( previous.ticket == ticket ){
+        previous.records = std::move( records );
+        previous.loaded = true;
+        previous.ticket = 0;
+        if( pending_move == PendingMove::Previous ) MovePrevious();
+    }
+    // otherwise the window was dropped while its fetch was in flight
+}
@@ -0,0 +1,58 @@
+#ifndef INVENTORY_PAGER_HPP
+#define INVENTORY_PAGER_HPP
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include "resources.hpp"
+
+// keyset-paginated cursor over the inventory. Only the current window and its two neighbours are
+// ever held in memory, the neighbours are prefetched through the DatabaseExecutor as the user browses.
+class InventoryPager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit InventoryPager( int page_size = PAGE_SIZE, QObject *parent = nullptr );
+
+    void Start();
+    // fetches the current window again from where it started and drops its neighbours, for after a
+    // record in it was changed or deleted. If nothing is left from there on, the window before it
+    // becomes the current one
+    void Reanchor();
+    bool MoveNext(); // false if there's no next window or it's still on its way
+    bool MovePrevious();
+    bool HasNext() const;
+    bool HasPrevious() const;
+    QList<DatabaseRecordFormat> const & CurrentPage() const { return current.records; }
+
+    static int const PAGE_SIZE;
+signals:
+    void pageChanged( bool forward ); // the current window has been replaced
+    void pageReloaded(); // Reanchor() is done, the current window may be shorter or another one
+    void fetchFailed();
+private:
+    enum class PendingMove { None, Next, Previous };
+
+    struct Window
+    {
+        QList<DatabaseRecordFormat> records;
+        int                         ticket = 0; // non-zero while a fetch is in flight
+        bool                        loaded = false;
+        bool                        reloading = false; // the fetch was started by Reanchor()
+        bool                        stepping_back = false; // the reload found nothing, this is the window before
+    };
+
+    int  Request( unsigned int key, bool forward );
+    void Prefetch();
+    void OnPageFetched( int ticket, QList<DatabaseRecordFormat> records, bool ok );
+private:
+    int          page_size;
+    int          last_ticket;
+    unsigned int anchor; // the current window holds the records after this key
+    PendingMove  pending_move;
+    Window       previous;
+    Window       current;
+    Window       next;
+};
+
+#endif // INVENTORY_PAGER_HPP
@@ -0,0 +1,186 @@
+#include "inventory_snapshot.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include <cstring>
+
+namespace {
+quint32 const SNAPSHOT_MAGIC = 0x50484953; // "PHIS"
+quint32 const SNAPSHOT_VERSION = 1;
+
+struct StringRef
+{
+    quint32 offset; // in UTF-16 code units, into the string area
+    quint32 length;
+};
+
+struct SnapshotHeader
+{
+    quint32     magic;
+    quint32     version;
+    quint32     record_count;
+    quint32     reserved;
+    qint64      synced_at;      // msecs since the epoch
+    quint64     strings_offset; // in bytes, from the start of the file
+    quint64     strings_size;   // in UTF-16 code units
+    StringRef   identity;
+    StringRef   watermark;
+};
+
+struct SnapshotEntry
+{
+    quint32     serial_number;
+    quint32     quantity;
+    quint32     low_stock_threshold;
+    quint32     reserved;
+    double      price;
+    qint64      date_time_added; // msecs since the epoch, -1 if there's no date
+    StringRef   book_title;
+    StringRef   author_name;
+    StringRef   publisher;
+    StringRef   location;
+    StringRef   cover_hash;
+};
+
+// strings are interned while the snapshot is written
+class StringArea
+{
+public:
+    StringRef Add( QString const & text )
+    {
+        auto const iter = offsets.constFind( text );
+        if( iter != offsets.cend() ) return iter.value();
+        StringRef const ref{ static_cast<quint32>( units.size() ), static_cast<quint32>( text.size() ) };
+        int const old_size = units.size();
+        units.resize( old_size + text.size() );
+        std::memcpy( units.data() + old_size, text.utf16(), text.size() * sizeof( ushort ) );
+        offsets.insert( text, ref );
+        return ref;
+    }
+    QVector<ushort> const & Units() const { return units; }
+private:
+    QVector<ushort>             units;
+    QHash<QString, StringRef>   offsets;
+};
+
+QString ReadString( QChar const *strings, quint64 strings_size, StringRef const & ref, bool & is_valid )
+{
+    if( quint64( ref.offset ) + ref.length > strings_size ){
+        is_valid = false;
+        return QString();
+    }
+    return QString( strings + ref.offset, static_cast<int>( ref.length ) );
+}
+}
+
+namespace InventorySnapshot
+{
+QString Path()
+{
+    QString const directory = QStandardPaths::writableLocation( QStandardPaths::AppDataLocation );
+    QDir().mkpath( directory );
+    return directory + "/inventory.snapshot";
+}
+
+bool Read( QString const & identity, QList<DatabaseRecordFormat> & records, SnapshotStamp & stamp )
+{
+    QFile file{ Path() };
+    if( !file.open( QIODevice::ReadOnly ) || file.size() < static_cast<qint64>( sizeof( SnapshotHeader ) ) ){
+        return false;
+    }
+    quint64 const file_size = static_cast<quint64>( file.size() );
+    uchar const *data = file.map( 0, file.size() );
+    if( !data ) return false;
+
+    SnapshotHeader header {};
+    std::memcpy( &header, data, sizeof( header ) );
+    quint64 const entries_end = sizeof( SnapshotHeader ) + quint64( header.record_count ) * sizeof( SnapshotEntry );
+    if( header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+            header.strings_offset < entries_end || header.strings_offset % sizeof( QChar ) != 0 ||
+            header.strings_offset + header.strings_size * sizeof( QChar ) > file_size ){
+        return false;
+    }
+
+    // the mapping is page aligned and so are the areas in it, entries and strings are read in place
+    QChar const *strings = reinterpret_cast<QChar const *>( data + header.strings_offset );
+    bool is_valid = true;
+    stamp.identity = ReadString( strings, header.strings_size, header.identity, is_valid );
+    if( !is_valid || stamp.identity != identity ) return false;
+    stamp.watermark = ReadString( strings, header.strings_size, header.watermark, is_valid );
+    stamp.synced_at = QDateTime::fromMSecsSinceEpoch( header.synced_at );
+
+    SnapshotEntry const *entries = reinterpret_cast<SnapshotEntry const *>( data + sizeof( SnapshotHeader ) );
+    records.clear();
+    records.reserve( static_cast<int>( header.record_count ) );
+    for( quint32 i = 0; i != header.record_count && is_valid; ++i ){
+        SnapshotEntry const & entry = entries[i];
+        records.append( DatabaseRecordFormat{} );
+        DatabaseRecordFormat & record = records.last();
+        record.serial_number = entry.serial_number;
+        record.quantity = entry.quantity;
+        record.low_stock_threshold = entry.low_stock_threshold;
+        record.price = entry.price;
+        if( entry.date_time_added >= 0 ) record.date_time_added = QDateTime::fromMSecsSinceEpoch( entry.date_time_added );
+        record.book_title = ReadString( strings, header.strings_size, entry.book_title, is_valid );
+        record.author_name = ReadString( strings, header.strings_size, entry.author_name, is_valid );
+        record.publisher = ReadString( strings, header.strings_size, entry.publisher, is_valid );
+        record.location = ReadString( strings, header.strings_size, entry.location, is_valid );
+        record.cover_hash = ReadString( strings, header.strings_size, entry.cover_hash, is_valid );
+    }
+    if( !is_valid ) records.clear();
+    return is_valid;
+}
+
+bool Write( QList<DatabaseRecordFormat> const & records, SnapshotStamp const & stamp, QString & error )
+{
+    StringArea strings {};
+    SnapshotHeader header {};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.record_count = static_cast<quint32>( records.size() );
+    header.synced_at = stamp.synced_at.toMSecsSinceEpoch();
+    header.identity = strings.Add( stamp.identity );
+    header.watermark = strings.Add( stamp.watermark );
+
+    QVector<SnapshotEntry> entries( records.size() );
+    for( int i = 0; i != records.size(); ++i ){
+        DatabaseRecordFormat const & record = records[i];
+        SnapshotEntry & entry = entries[i];
+        entry.serial_number = record.serial_number;
+        entry.quantity = record.quantity;
+        entry.low_stock_threshold = record.low_stock_threshold;
+        entry.price = record.price;
+        entry.date_time_added = record.date_time_added.isValid() ? record.date_time_added.toMSecsSinceEpoch() : -1;
+        entry.book_title = strings.Add( record.book_title );
+        entry.author_name = strings.Add( record.author_name );
+        entry.publisher = strings.Add( record.publisher );
+        entry.location = strings.Add( record.location );
+        entry.cover_hash = strings.Add( record.cover_hash );
+    }
+    header.strings_offset = sizeof( SnapshotHeader ) + quint64( entries.size() ) * sizeof( SnapshotEntry );
+    header.strings_size = static_cast<quint64>( strings.Units().size() );
+
+    QSaveFile file{ Path() };
+    qint64 const header_size = sizeof( SnapshotHeader );
+    qint64 const entries_size = entries.size() * static_cast<qint64>( sizeof( SnapshotEntry ) );
+    qint64 const strings_size = strings.Units().size() * static_cast<qint64>( sizeof( ushort ) );
+    if( !file.open( QIODevice::WriteOnly ) ||
+            file.write( reinterpret_cast<char const *>( &header ), header_size ) != header_size ||
+            file.write( reinterpret_cast<char const *>( entries.constData() ), entries_size ) != entries_size ||
+            file.write( reinterpret_cast<char const *>( strings.Units().constData() ), strings_size ) != strings_size ||
+            !file.commit() ){
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Remove()
+{
+    QFile::remove( Path() );
+}
+}
@@ -0,0 +1,31 @@
+#ifndef INVENTORY_SNAPSHOT_HPP
+#define INVENTORY_SNAPSHOT_HPP
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include "resources.hpp"
+
+// what a snapshot holds besides the records
+struct SnapshotStamp
+{
+    QString     identity;  // DatabaseIdentity() of the database the records came from
+    QString     watermark; // database time of the last sync, as updated_at is written
+    QDateTime   synced_at; // local time of that sync
+};
+
+// compact binary copy of the inventory( covers aside ) on local disk. A header, a table of fixed
+// size entries and one area of UTF-16 strings that entries refer to by offset; repeated strings
+// such as authors and publishers are stored once. The file is read through a memory mapping and
+// written through a QSaveFile, so a reader never sees half a snapshot. Byte order is the host's,
+// snapshots are not meant to travel between machines.
+namespace InventorySnapshot
+{
+QString Path();
+// false if there's no snapshot or it is damaged, of another format version or for another database
+bool Read( QString const & identity, QList<DatabaseRecordFormat> & records, SnapshotStamp & stamp );
+bool Write( QList<DatabaseRecordFormat> const & records, SnapshotStamp const & stamp, QString & error );
+void Remove();
+}
+
+#endif // INVENTORY_SNAPSHOT_HPP
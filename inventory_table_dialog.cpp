@@ -0,0 +1,46 @@
+#include "inventory_table_dialog.hpp"
+#include "inventory_table_model.hpp"
+
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QTableView>
+#include <QVBoxLayout>
+
+InventoryTableDialog::InventoryTableDialog( QWidget *parent ) : QDialog( parent ),
+    filterEdit( new QLineEdit ), tableView( new QTableView ), model( new InventoryTableModel( this ) )
+{
+    setWindowTitle( tr( "Inventory" ) );
+    resize( 800, 500 );
+
+    filterEdit->setPlaceholderText( tr( "Filter by title, author or publisher and press Enter" ) );
+
+    tableView->setModel( model );
+    tableView->setSelectionBehavior( QAbstractItemView::SelectRows );
+    tableView->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    tableView->horizontalHeader()->setSortIndicator( 0, Qt::AscendingOrder );
+    tableView->setSortingEnabled( true ); // sorts, and so loads the first chunk
+    // uniform rows let the view work out its scroll range without asking for every row
+    tableView->verticalHeader()->setSectionResizeMode( QHeaderView::Fixed );
+    tableView->horizontalHeader()->setStretchLastSection( true );
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->addWidget( filterEdit );
+    layout->addWidget( tableView );
+    setLayout( layout );
+
+    QObject::connect( filterEdit, SIGNAL(returnPressed()), this, SLOT(onFilterEntered()) );
+    QObject::connect( model, SIGNAL(loadFailed()), this, SLOT(onLoadFailed()) );
+}
+
+void InventoryTableDialog::onFilterEntered()
+{
+    model->SetFilter( filterEdit->text() );
+}
+
+void InventoryTableDialog::onLoadFailed()
+{
+    QMessageBox::warning( this, "Inventory", tr( "Unable to retrieve any information from the inventory" ),
+                          QMessageBox::Ok );
+}
@@ -0,0 +1,25 @@
+#ifndef INVENTORY_TABLE_DIALOG_HPP
+#define INVENTORY_TABLE_DIALOG_HPP
+
+#include <QDialog>
+
+class QLineEdit;
+class QTableView;
+class InventoryTableModel;
+
+class InventoryTableDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit InventoryTableDialog( QWidget *parent = nullptr );
+    ~InventoryTableDialog() = default;
+private slots:
+    void onFilterEntered();
+    void onLoadFailed();
+private:
+    QLineEdit           *filterEdit;
+    QTableView          *tableView;
+    InventoryTableModel *model;
+};
+
+#endif // INVENTORY_TABLE_DIALOG_HPP
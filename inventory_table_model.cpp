@@ -0,0 +1,240 @@
+#include "inventory_table_model.hpp"
+#include "db_executor.hpp"
+#include "query_tracer.hpp"
+#include "storage_backend.hpp"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStringList>
+
+namespace {
+struct TableColumn
+{
+    char const *header;
+    char const *column;
+};
+
+TableColumn const TABLE_COLUMNS[] = {
+    { QT_TRANSLATE_NOOP( "InventoryTableModel", "Title" ), "book_title" },
+    { QT_TRANSLATE_NOOP( "InventoryTableModel", "Author" ), "author_name" },
+    { QT_TRANSLATE_NOOP( "InventoryTableModel", "Publisher" ), "publisher" },
+    { QT_TRANSLATE_NOOP( "InventoryTableModel", "Stock" ), "stock" },
+    { QT_TRANSLATE_NOOP( "InventoryTableModel", "Price" ), "price" },
+    { QT_TRANSLATE_NOOP( "InventoryTableModel", "Location" ), "location" },
+    { QT_TRANSLATE_NOOP( "InventoryTableModel", "Date added" ), "date_time" }
+};
+int const COLUMN_COUNT = sizeof( TABLE_COLUMNS ) / sizeof( TABLE_COLUMNS[0] );
+}
+
+int const InventoryTableModel::CHUNK_SIZE = 100;
+int const InventoryTableModel::CACHED_CHUNKS = 8; // a screenful of rows plus a margin either side
+
+InventoryTableModel::InventoryTableModel( QObject *parent ):
+    QAbstractTableModel( parent ), chunks( CACHED_CHUNKS ), generation{ 0 }, exposed_rows{ 0 }, at_end{ true },
+    sort_column{ 0 }, sort_order{ Qt::AscendingOrder }
+{
+}
+
+int InventoryTableModel::rowCount( QModelIndex const & parent ) const
+{
+    return parent.isValid() ? 0 : exposed_rows;
+}
+
+int InventoryTableModel::columnCount( QModelIndex const & parent ) const
+{
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant InventoryTableModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+    if( role != Qt::DisplayRole || orientation != Qt::Horizontal || section >= COLUMN_COUNT ){
+        return QAbstractTableModel::headerData( section, orientation, role );
+    }
+    return tr( TABLE_COLUMNS[section].header ); // marked for translation above
+}
+
+QVariant InventoryTableModel::data( QModelIndex const & index, int role ) const
+{
+    if( !index.isValid() || index.row() >= exposed_rows ) return QVariant();
+    if( role == Qt::TextAlignmentRole && ( index.column() == 3 || index.column() == 4 ) ){
+        return int( Qt::AlignRight | Qt::AlignVCenter );
+    }
+    if( role != Qt::DisplayRole ) return QVariant();
+
+    QList<DatabaseRecordFormat> const *chunk = Chunk( index.row() / CHUNK_SIZE );
+    int const offset = index.row() % CHUNK_SIZE;
+    if( !chunk || offset >= chunk->size() ) return QVariant();
+
+    DatabaseRecordFormat const & record = chunk->at( offset );
+    switch( index.column() ){
+    case 0: return record.book_title;
+    case 1: return record.author_name;
+    case 2: return record.publisher;
+    case 3: return record.quantity;
+    case 4: return record.price;
+    case 5: return record.location;
+    case 6: return record.date_time_added.toString();
+    default: return QVariant();
+    }
+}
+
+bool InventoryTableModel::canFetchMore( QModelIndex const & parent ) const
+{
+    return !parent.isValid() && !at_end;
+}
+
+void InventoryTableModel::fetchMore( QModelIndex const & parent )
+{
+    // the rows are inserted once the chunk after the last one read arrives
+    if( !parent.isValid() && !at_end ) LoadChunk( chunk_ends.size() );
+}
+
+void InventoryTableModel::sort( int column, Qt::SortOrder order )
+{
+    if( column < 0 || column >= COLUMN_COUNT ) return;
+    sort_column = column;
+    sort_order = order;
+    Refresh();
+}
+
+void InventoryTableModel::SetFilter( QString const & text )
+{
+    filter = text.trimmed();
+    Refresh();
+}
+
+void InventoryTableModel::Refresh()
+{
+    ++generation; // chunks of the old order or filter still on their way are dropped
+    beginResetModel();
+    chunks.clear();
+    chunk_ends.clear();
+    loading_chunks.clear();
+    exposed_rows = 0;
+    at_end = false;
+    endResetModel();
+    LoadChunk( 0 );
+}
+
+// the rows after `after` in the current order. NULLs come first in ascending order and last in
+// descending order, on MySQL and SQLite alike, and never compare equal to the key
+QString InventoryTableModel::WhereClause( ChunkEnd const * after ) const
+{
+    QStringList conditions {};
+    if( !filter.isEmpty() ){
+        conditions << "( book_title LIKE :pattern OR author_name LIKE :pattern OR publisher LIKE :pattern )";
+    }
+    if( after ){
+        QString const column = StorageBackend::Current().SortColumn( TABLE_COLUMNS[sort_column].column );
+        bool const ascending = sort_order == Qt::AscendingOrder;
+        if( after->sort_key.isNull() ){
+            conditions << ( ascending ? QString( "( ( %1 IS NULL AND serial_number > :serial_number ) OR "
+                                                 "%1 IS NOT NULL )" ).arg( column )
+                                      : QString( "( %1 IS NULL AND serial_number < :serial_number )" ).arg( column ) );
+        } else if( ascending ){
+            conditions << QString( "( %1 > :sort_key OR ( %1 = :sort_key AND serial_number > :serial_number ) )" )
+                          .arg( column );
+        } else {
+            conditions << QString( "( %1 < :sort_key OR ( %1 = :sort_key AND serial_number < :serial_number ) "
+                                   "OR %1 IS NULL )" ).arg( column );
+        }
+    }
+    return conditions.isEmpty() ? QString() : " WHERE " + conditions.join( " AND " );
+}
+
+QList<DatabaseRecordFormat> const * InventoryTableModel::Chunk( int chunk_index ) const
+{
+    if( QList<DatabaseRecordFormat> const *chunk = chunks.object( chunk_index ) ){
+        return chunk;
+    }
+    // data() is const, but fetching rows the view asks for doesn't change what the model represents
+    const_cast<InventoryTableModel*>( this )->LoadChunk( chunk_index );
+    return nullptr;
+}
+
+void InventoryTableModel::LoadChunk( int chunk_index )
+{
+    // a chunk can only be read once the one before it has been, its last row is where it starts
+    if( chunk_index > chunk_ends.size() || loading_chunks.contains( chunk_index ) ) return;
+    loading_chunks.insert( chunk_index );
+
+    bool const has_start = chunk_index > 0;
+    ChunkEnd const start = has_start ? chunk_ends.at( chunk_index - 1 ) : ChunkEnd{ QVariant(), 0 };
+    QString const column = StorageBackend::Current().SortColumn( TABLE_COLUMNS[sort_column].column );
+    QString const direction = sort_order == Qt::AscendingOrder ? "ASC" : "DESC";
+    QString const chunk_string = QString( "SELECT %1, %2 AS sort_key FROM inventory%3 "
+                                          "ORDER BY %2 %4, serial_number %4 LIMIT :limit" )
+            .arg( SelectColumns<DatabaseRecordFormat>( LargeObject ), column,
+                  WhereClause( has_start ? &start : nullptr ), direction );
+    QString const pattern = filter.isEmpty() ? QString() : "%" + filter + "%";
+    int const current_generation = generation;
+
+    DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this, [=]( QSqlDatabase & database )
+    {
+        QueryResult<ChunkRows> result {};
+        QSqlQuery chunk_query{ database };
+        chunk_query.setForwardOnly( true );
+        chunk_query.prepare( chunk_string );
+        if( !pattern.isEmpty() ) chunk_query.bindValue( ":pattern", pattern );
+        if( has_start ){
+            if( !start.sort_key.isNull() ) chunk_query.bindValue( ":sort_key", start.sort_key );
+            chunk_query.bindValue( ":serial_number", start.serial_number );
+        }
+        chunk_query.bindValue( ":limit", CHUNK_SIZE );
+
+        if( !QueryTracer::Instance().Exec( "inventory_table_chunk", chunk_query ) ){
+            result.error = chunk_query.lastError().text();
+            return result;
+        }
+        // the sort key is read as the database has it, it may be a shortened copy of the column
+        QElapsedTimer elapsed {};
+        elapsed.start();
+        int const sort_key = chunk_query.record().indexOf( "sort_key" );
+        RowDecoder<DatabaseRecordFormat> const decoder{ chunk_query };
+        while( chunk_query.next() ){
+            result.value.records.append( DatabaseRecordFormat{} );
+            decoder.Decode( chunk_query, result.value.records.last() );
+            result.value.end = ChunkEnd{ chunk_query.value( sort_key ), result.value.records.last().serial_number };
+        }
+        QueryTracer::Instance().Fetched( result.value.records.size(), 0, elapsed.nsecsElapsed() / 1000 );
+        result.ok = true;
+        return result;
+    }, [this, chunk_index, current_generation]( QueryResult<ChunkRows> result ){
+        if( !result.ok ){
+            qDebug() << result.error;
+            if( current_generation == generation ) loading_chunks.remove( chunk_index );
+            emit loadFailed();
+            return;
+        }
+        OnChunkLoaded( chunk_index, current_generation, std::move( result.value ) );
+    });
+}
+
+void InventoryTableModel::OnChunkLoaded( int chunk_index, int chunk_generation, ChunkRows rows )
+{
+    if( chunk_generation != generation ) return;
+    loading_chunks.remove( chunk_index );
+    int const first_row = chunk_index * CHUNK_SIZE;
+    int const row_count = rows.records.size();
+
+    if( chunk_index == chunk_ends.size() ){
+        // the next chunk, its rows are new to the view
+        at_end = row_count < CHUNK_SIZE;
+        if( row_count == 0 ) return;
+        chunk_ends.append( rows.end );
+        beginInsertRows( QModelIndex(), first_row, first_row + row_count - 1 );
+        chunks.insert( chunk_index, new QList<DatabaseRecordFormat>( std::move( rows.records ) ) );
+        exposed_rows += row_count;
+        endInsertRows();
+        return;
+    }
+    // read again after it was evicted
+    chunks.insert( chunk_index, new QList<DatabaseRecordFormat>( std::move( rows.records ) ) );
+    int const last_row = qMin( first_row + CHUNK_SIZE, exposed_rows ) - 1;
+    if( last_row >= first_row ){
+        emit dataChanged( index( first_row, 0 ), index( last_row, COLUMN_COUNT - 1 ) );
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef INVENTORY_TABLE_MODEL_HPP
+#define INVENTORY_TABLE_MODEL_HPP
+
+#include <QAbstractTableModel>
+#include <QCache>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVariant>
+#include "resources.hpp"
+
+// table model over the inventory that never holds the whole table. Rows are read in keyset chunks
+// through canFetchMore/fetchMore: each chunk continues after the last row of the one before it, in
+// the order of an indexed column, so there is neither a COUNT(*) nor an OFFSET to skip. Only the
+// chunks the view has recently touched are kept in memory, the others are read again from where
+// they started. Every query goes through the DatabaseExecutor: rows show up empty until their
+// chunk arrives.
+class InventoryTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit InventoryTableModel( QObject *parent = nullptr );
+
+    int rowCount( QModelIndex const & parent = QModelIndex() ) const override;
+    int columnCount( QModelIndex const & parent = QModelIndex() ) const override;
+    QVariant data( QModelIndex const & index, int role = Qt::DisplayRole ) const override;
+    QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override;
+    bool canFetchMore( QModelIndex const & parent ) const override;
+    void fetchMore( QModelIndex const & parent ) override;
+    void sort( int column, Qt::SortOrder order = Qt::AscendingOrder ) override;
+
+    void SetFilter( QString const & text );
+    void Refresh();
+
+    static int const CHUNK_SIZE;
+    static int const CACHED_CHUNKS;
+signals:
+    void loadFailed();
+private:
+    // the last row of a chunk, the next one starts after it
+    struct ChunkEnd
+    {
+        QVariant        sort_key;
+        unsigned int    serial_number;
+    };
+    struct ChunkRows
+    {
+        QList<DatabaseRecordFormat> records;
+        ChunkEnd                    end;
+    };
+
+    QList<DatabaseRecordFormat> const * Chunk( int chunk_index ) const;
+    void LoadChunk( int chunk_index );
+    void OnChunkLoaded( int chunk_index, int generation, ChunkRows rows );
+    QString WhereClause( ChunkEnd const * after ) const;
+private:
+    mutable QCache<int, QList<DatabaseRecordFormat>> chunks;
+    QList<ChunkEnd> chunk_ends; // of every chunk read so far
+    QSet<int>       loading_chunks;
+    int             generation; // bumped whenever the sort order or filter changes
+    int             exposed_rows;
+    bool            at_end; // the last chunk read was not a full one
+    QString         filter;
+    int             sort_column;
+    Qt::SortOrder   sort_order;
+};
+
+#endif // INVENTORY_TABLE_MODEL_HPP
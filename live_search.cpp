@@ -0,0 +1,153 @@
+#include "live_search.hpp"
+#include "db_executor.hpp"
+#include "inventory_cache.hpp"
+#include "statement_cache.hpp"
+
+#include <QFutureWatcher>
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtConcurrent>
+#include <algorithm>
+
+int const LiveSearch::DEFAULT_DEBOUNCE_MS = 150;
+int const LiveSearch::LATENCY_SAMPLES = 1000;
+
+namespace {
+using SearchResults = QList<DatabaseRecordFormat>;
+
+QueryResult<SearchResults> SearchDatabase( QSqlDatabase & database, QString const & text, int limit )
+{
+    QueryResult<SearchResults> result {};
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & search_query = statements.Prepare( database, StatementId::SearchInventory );
+    search_query.bindValue( ":terms", StatementCache::SearchTerms( text ) );
+    if( !statements.Exec( database, StatementId::SearchInventory, search_query ) ){
+        result.error = search_query.lastError().text();
+        return result;
+    }
+    RowDecoder<DatabaseRecordFormat> const decoder{ search_query };
+    while( result.value.size() < limit && search_query.next() ){
+        if( DatabaseExecutor::IsCurrentRequestCancelled() ) break;
+        result.value.append( DatabaseRecordFormat{} );
+        decoder.Decode( search_query, result.value.last() );
+    }
+    search_query.finish();
+    result.ok = true;
+    return result;
+}
+}
+
+LiveSearch::LiveSearch( QObject *parent ): QObject( parent ),
+    current_ticket( 0 ), db_request_id( 0 ), result_limit( 20 ), next_latency( 0 )
+{
+    QSettings settings{ "Phoebe", "BookManager" };
+    debounce_timer.setSingleShot( true );
+    debounce_timer.setInterval( settings.value( "search/debounce_ms", DEFAULT_DEBOUNCE_MS ).toInt() );
+    latencies.reserve( LATENCY_SAMPLES );
+    QObject::connect( &debounce_timer, SIGNAL(timeout()), this, SLOT(onDebounceTimeout()) );
+}
+
+void LiveSearch::SetDebounceInterval( int msecs )
+{
+    debounce_timer.setInterval( msecs );
+    QSettings{ "Phoebe", "BookManager" }.setValue( "search/debounce_ms", msecs );
+}
+
+int LiveSearch::DebounceInterval() const
+{
+    return debounce_timer.interval();
+}
+
+void LiveSearch::SetResultLimit( int limit )
+{
+    result_limit = limit;
+}
+
+void LiveSearch::onTextChanged( QString const & text )
+{
+    CancelInFlight();
+    ++current_ticket;
+    current_text = text;
+    since_keystroke.start();
+
+    if( text.trimmed().isEmpty() ){
+        debounce_timer.stop();
+        emit resultsReady( text, {} );
+        return;
+    }
+    debounce_timer.start();
+}
+
+void LiveSearch::CancelInFlight()
+{
+    // a cache lookup is left to finish, its ticket is stale by now and the results are dropped
+    if( db_request_id != 0 ){
+        DatabaseExecutor::Instance().Cancel( db_request_id );
+        db_request_id = 0;
+    }
+}
+
+void LiveSearch::onDebounceTimeout()
+{
+    quint64 const ticket = current_ticket;
+    QString const text = current_text;
+    int const limit = result_limit;
+
+    if( InventoryCache::Instance().IsComplete() ){
+        auto *watcher = new QFutureWatcher<SearchResults>( this );
+        QObject::connect( watcher, &QFutureWatcher<SearchResults>::finished, this, [=]{
+            Deliver( ticket, text, watcher->result() );
+            watcher->deleteLater();
+        });
+        watcher->setFuture( QtConcurrent::run( [text, limit]{
+            SearchResults results {};
+            InventoryCache::Instance().Search( text, results, limit );
+            return results;
+        }));
+        return;
+    }
+
+    db_request_id = DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this,
+                                                         [text, limit]( QSqlDatabase & database ){
+        return SearchDatabase( database, text, limit );
+    }, [=]( QueryResult<SearchResults> result ){
+        if( ticket == current_ticket ) db_request_id = 0;
+        if( !result.ok ){
+            qDebug() << result.error;
+            return;
+        }
+        Deliver( ticket, text, result.value );
+    });
+}
+
+void LiveSearch::Deliver( quint64 ticket, QString const & text, QList<DatabaseRecordFormat> const & results )
+{
+    if( ticket != current_ticket ) return; // the user has typed on since
+
+    qint64 const latency = since_keystroke.nsecsElapsed() / 1000;
+    if( latencies.size() < static_cast<std::size_t>( LATENCY_SAMPLES ) ){
+        latencies.push_back( latency );
+    } else {
+        latencies[next_latency] = latency;
+    }
+    next_latency = ( next_latency + 1 ) % LATENCY_SAMPLES;
+
+    emit resultsReady( text, results );
+    emit latencyChanged();
+}
+
+qint64 LiveSearch::LatencyPercentile( double percentile ) const
+{
+    if( latencies.empty() ) return -1;
+    std::vector<qint64> sorted = latencies;
+    std::size_t const rank = std::min( sorted.size() - 1,
+                                       static_cast<std::size_t>( percentile / 100.0 * sorted.size() ) );
+    std::nth_element( sorted.begin(), sorted.begin() + rank, sorted.end() );
+    return sorted[rank];
+}
+
+int LiveSearch::LatencySampleCount() const
+{
+    return static_cast<int>( latencies.size() );
+}
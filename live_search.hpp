@@ -0,0 +1,54 @@
+#ifndef LIVE_SEARCH_HPP
+#define LIVE_SEARCH_HPP
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <vector>
+#include "resources.hpp"
+
+// search-as-you-type behind the toolbar's search box. Every keystroke restarts the debounce timer,
+// once it fires the lookup runs off the GUI thread: against the InventoryCache when it is
+// complete, otherwise against the database. A newer keystroke cancels the lookup in flight and
+// only the results for the latest text are ever delivered.
+// The time from the last keystroke to its results( debounce included ) is sampled for the
+// percentiles shown by the debug overlay.
+class LiveSearch : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LiveSearch( QObject *parent = nullptr );
+
+    void SetDebounceInterval( int msecs );
+    int  DebounceInterval() const;
+    void SetResultLimit( int limit );
+    // in microseconds, -1 without samples
+    qint64 LatencyPercentile( double percentile ) const;
+    int    LatencySampleCount() const;
+
+    static int const DEFAULT_DEBOUNCE_MS;
+    static int const LATENCY_SAMPLES; // the most recent lookups the percentiles are computed over
+public slots:
+    void onTextChanged( QString const & text );
+signals:
+    void resultsReady( QString const & text, QList<DatabaseRecordFormat> const & results );
+    void latencyChanged();
+private slots:
+    void onDebounceTimeout();
+private:
+    void CancelInFlight();
+    void Deliver( quint64 ticket, QString const & text, QList<DatabaseRecordFormat> const & results );
+private:
+    QTimer          debounce_timer;
+    QElapsedTimer   since_keystroke;
+    QString         current_text;
+    quint64         current_ticket; // bumped by every keystroke, older lookups are stale
+    quint64         db_request_id;  // the executor request in flight, 0 if none
+    int             result_limit;
+    std::vector<qint64> latencies;  // ring buffer of LATENCY_SAMPLES
+    std::size_t     next_latency;
+};
+
+#endif // LIVE_SEARCH_HPP
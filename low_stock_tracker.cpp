@@ -0,0 +1,67 @@
+#include "low_stock_tracker.hpp"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+
+unsigned int const LowStockTracker::DEFAULT_THRESHOLD = 5;
+
+LowStockItem MakeLowStockItem( DatabaseRecordFormat const & record )
+{
+    return LowStockItem{ record.serial_number, record.quantity, record.low_stock_threshold,
+                         record.book_title, record.author_name };
+}
+
+LowStockTracker::LowStockTracker( QObject *parent ): QObject( parent )
+{
+    qRegisterMetaType<QList<LowStockItem>>( "QList<LowStockItem>" );
+}
+
+LowStockTracker & LowStockTracker::Instance()
+{
+    static LowStockTracker *tracker = new LowStockTracker( qApp );
+    return *tracker;
+}
+
+void LowStockTracker::Seed( QList<LowStockItem> const & items )
+{
+    QMutexLocker lock{ &mutex };
+    low_items.clear();
+    for( LowStockItem const & item : items ){
+        if( item.stock < item.threshold ) low_items.insert( item.serial_number, item );
+    }
+}
+
+void LowStockTracker::Update( LowStockItem const & item )
+{
+    Update( QList<LowStockItem>{ item } );
+}
+
+void LowStockTracker::Update( QList<LowStockItem> const & items )
+{
+    QList<LowStockItem> fell {};
+    {
+        QMutexLocker lock{ &mutex };
+        for( LowStockItem const & item : items ){
+            if( item.stock >= item.threshold ){
+                low_items.remove( item.serial_number );
+                continue;
+            }
+            if( !low_items.contains( item.serial_number ) ) fell.append( item );
+            low_items.insert( item.serial_number, item );
+        }
+    }
+    // emitted without the lock, receivers in other threads get a queued copy
+    if( !fell.isEmpty() ) emit stockFell( fell );
+}
+
+void LowStockTracker::Remove( unsigned int serial_number )
+{
+    QMutexLocker lock{ &mutex };
+    low_items.remove( serial_number );
+}
+
+QList<LowStockItem> LowStockTracker::Items() const
+{
+    QMutexLocker lock{ &mutex };
+    return low_items.values();
+}
@@ -0,0 +1,54 @@
+#ifndef LOW_STOCK_TRACKER_HPP
+#define LOW_STOCK_TRACKER_HPP
+
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include "resources.hpp"
+
+struct LowStockItem
+{
+    unsigned int    serial_number;
+    unsigned int    stock;
+    unsigned int    threshold;
+    QString         book_title;
+    QString         author_name;
+};
+
+Q_DECLARE_METATYPE( QList<LowStockItem> )
+
+LowStockItem MakeLowStockItem( DatabaseRecordFormat const & record );
+
+// the books that are currently below their low_stock_threshold. The set is seeded once when the
+// application starts and then kept up to date from the mutations the application performs itself
+// ( sales, updates, additions and deletions ), so the inventory is never re-queried for it.
+// Every method is thread safe, the mutations report from the executor's threads.
+class LowStockTracker : public QObject
+{
+    Q_OBJECT
+public:
+    static LowStockTracker & Instance();
+
+    // replaces the whole set, nothing is announced
+    void Seed( QList<LowStockItem> const & items );
+    // the current stock/threshold of a book, emits stockFell for the ones that just went below
+    void Update( LowStockItem const & item );
+    void Update( QList<LowStockItem> const & items );
+    void Remove( unsigned int serial_number );
+    QList<LowStockItem> Items() const;
+
+    static unsigned int const DEFAULT_THRESHOLD;
+signals:
+    // only the books whose stock has gone from at-or-above their threshold to below it
+    void stockFell( QList<LowStockItem> const & items );
+private:
+    explicit LowStockTracker( QObject *parent = nullptr );
+private:
+    mutable QMutex                      mutex;
+    QHash<unsigned int, LowStockItem>   low_items; // keyed by serial_number
+};
+
+#endif // LOW_STOCK_TRACKER_HPP
@@ -1,10 +1,17 @@
+#include "db_executor.hpp"
 #include "login_dialog.hpp"
+#include "report_journal.hpp"
 #include <QApplication>
 #include <QDebug>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    // qApp deletes its children in the order they were made: the executor goes first and joins its
+    // worker, so a checkout still running at exit appends to a journal that is still there
+    DatabaseExecutor::Instance();
+    // on the GUI thread, before any database worker can append a report
+    ReportJournal::Instance();
 
     LoginDialog w;
     w.show();
@@ -0,0 +1,305 @@
+#include "storage_backend.hpp"
+#include "add_item_dialog.hpp"
+#include "inventory_cache.hpp"
+#include "low_stock_tracker.hpp"
+
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+
+namespace {
+// TEXT can only be indexed by a prefix, which can't serve an ORDER BY. These columns are sorted by
+// an indexed copy of their first ROLLUP_KEY_LENGTH characters instead
+QStringList const TEXT_SORT_COLUMNS { "book_title", "author_name", "publisher", "location" };
+
+bool TableHasIndex( QSqlDatabase & database, QString const & table, QString const & index, QString & error )
+{
+    QSqlQuery index_query{ database };
+    index_query.prepare( "SELECT COUNT(*) FROM information_schema.statistics WHERE table_schema = DATABASE() "
+                         "AND table_name = :table AND index_name = :index" );
+    index_query.bindValue( ":table", table );
+    index_query.bindValue( ":index", index );
+    if( !index_query.exec() || !index_query.next() ){
+        error = index_query.lastError().text();
+        return false;
+    }
+    return index_query.value( 0 ).toInt() > 0;
+}
+
+bool EnsureIndex( QSqlDatabase & database, QString const & table, QString const & index,
+                  QString const & columns, QString & error )
+{
+    if( TableHasIndex( database, table, index, error ) ) return true;
+    if( !error.isEmpty() ) return false;
+
+    QSqlQuery index_query{ database };
+    if( !index_query.exec( QString( "ALTER TABLE %1 ADD INDEX %2 ( %3 )" ).arg( table, index, columns ) ) ){
+        error = index_query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// report generation filters on the date range first and the transaction type second
+bool CreateReportIndexes( QSqlDatabase & database, QString & error )
+{
+    return EnsureIndex( database, "reports", "reports_date_type", "date_performed, transaction_type", error );
+}
+
+bool TableHasColumn( QSqlDatabase & database, QString const & table, QString const & column, QString & error )
+{
+    QSqlQuery column_query{ database };
+    column_query.prepare( "SELECT COUNT(*) FROM information_schema.columns WHERE table_schema = DATABASE() "
+                          "AND table_name = :table AND column_name = :column" );
+    column_query.bindValue( ":table", table );
+    column_query.bindValue( ":column", column );
+    if( !column_query.exec() || !column_query.next() ){
+        error = column_query.lastError().text();
+        return false;
+    }
+    return column_query.value( 0 ).toInt() > 0;
+}
+
+bool EnsureColumn( QSqlDatabase & database, QString const & table, QString const & column,
+                   QString const & definition, QString & error )
+{
+    if( TableHasColumn( database, table, column, error ) ) return true;
+    if( !error.isEmpty() ) return false;
+
+    QSqlQuery alter_query{ database };
+    if( !alter_query.exec( QString( "ALTER TABLE %1 ADD COLUMN %2 %3" ).arg( table, column, definition ) ) ){
+        error = alter_query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// the inventory table is browsed in keyset chunks in the order of any of its columns, InnoDB appends
+// the primary key to every index so ties are ordered by serial_number as well
+bool CreateSortIndexes( QSqlDatabase & database, QString & error )
+{
+    QString const & table = AddItemDialog::TABLE_NAME;
+    for( QString const & column : TEXT_SORT_COLUMNS ){
+        QString const sort_column = column + "_sort";
+        if( !EnsureColumn( database, table, sort_column, QString( "VARCHAR(%1) AS ( LEFT( %2, %1 ) ) VIRTUAL" )
+                           .arg( ROLLUP_KEY_LENGTH ).arg( column ), error ) ||
+                !EnsureIndex( database, table, "inventory_" + sort_column, sort_column, error ) ){
+            return false;
+        }
+    }
+    for( QString const & column : { "stock", "price", "date_time" } ){
+        if( !EnsureIndex( database, table, QString( "inventory_%1_sort" ).arg( column ), column, error ) ){
+            return false;
+        }
+    }
+    return true;
+}
+
+// databases created before per-book thresholds get the column with the old fixed threshold, the
+// low stock lookup at startup is a range scan on the stock index. updated_at is the change
+// watermark the inventory snapshot catches up from
+bool UpgradeInventoryTable( QSqlDatabase & database, QString & error )
+{
+    QString const & table = AddItemDialog::TABLE_NAME;
+    return EnsureColumn( database, table, "low_stock_threshold",
+                         QString( "INTEGER NOT NULL DEFAULT %1" ).arg( LowStockTracker::DEFAULT_THRESHOLD ), error )
+            && EnsureColumn( database, table, "cover_hash", "CHAR(64) NULL", error )
+            && EnsureColumn( database, table, "updated_at", "TIMESTAMP(6) NOT NULL DEFAULT CURRENT_TIMESTAMP(6) "
+                             "ON UPDATE CURRENT_TIMESTAMP(6)", error )
+            && EnsureIndex( database, table, "inventory_updated_at", "updated_at", error )
+            && EnsureIndex( database, table, "inventory_stock", "stock, low_stock_threshold", error )
+            && EnsureIndex( database, table, "inventory_threshold", "low_stock_threshold", error )
+            && CreateSortIndexes( database, error );
+}
+
+// covers are shared by every till through the database, one row per distinct image keyed by its
+// SHA-256( see CoverStore )
+bool CreateCoversTable( QSqlDatabase & database, QString & error )
+{
+    QSqlQuery covers_query{ database };
+    if( !covers_query.exec( "CREATE TABLE IF NOT EXISTS covers ( cover_hash CHAR(64) PRIMARY KEY, "
+                            "cover LONGBLOB NOT NULL, stored_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP "
+                            ") ENGINE=InnoDB" ) ){
+        error = covers_query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// covers used to be BLOBs in the inventory rows. They are copied into the covers table in batches,
+// hashed by the server, and each row gets its hash. book_cover itself is left alone, tills still on
+// an older release read it. Safe to resume after a crash, and rows such a till adds later are
+// picked up on the next start.
+bool MigrateCoverBlobs( QSqlDatabase & database, QString & error )
+{
+    QString const & table = AddItemDialog::TABLE_NAME;
+    if( !TableHasColumn( database, table, "book_cover", error ) ) return error.isEmpty();
+
+    QString const pending = "book_cover IS NOT NULL AND LENGTH( book_cover ) > 0 AND cover_hash IS NULL "
+                            "ORDER BY serial_number LIMIT 100";
+    for( ;; ){
+        QSqlQuery copy_query{ database };
+        if( !copy_query.exec( QString( "INSERT IGNORE INTO covers ( cover_hash, cover ) SELECT SHA2( book_cover, 256 ), "
+                                       "book_cover FROM %1 WHERE %2" ).arg( table, pending ) ) ){
+            error = copy_query.lastError().text();
+            return false;
+        }
+        QSqlQuery hash_query{ database };
+        if( !hash_query.exec( QString( "UPDATE %1 SET cover_hash = SHA2( book_cover, 256 ) WHERE %2" )
+                              .arg( table, pending ) ) ){
+            error = hash_query.lastError().text();
+            return false;
+        }
+        if( hash_query.numRowsAffected() <= 0 ) return true;
+    }
+}
+
+// deleted books leave a tombstone for the snapshot catch-up( see InventoryCache ). Tombstones older
+// than any snapshot that is still used are dropped
+bool CreateDeletionsTable( QSqlDatabase & database, QString & error )
+{
+    QSqlQuery deletions_query{ database };
+    if( !deletions_query.exec( "CREATE TABLE IF NOT EXISTS inventory_deletions ( "
+                               "serial_number INTEGER PRIMARY KEY, "
+                               "deleted_at TIMESTAMP(6) NOT NULL DEFAULT CURRENT_TIMESTAMP(6) "
+                               "ON UPDATE CURRENT_TIMESTAMP(6), INDEX inventory_deletions_at( deleted_at ) "
+                               ") ENGINE=InnoDB" ) ){
+        error = deletions_query.lastError().text();
+        return false;
+    }
+    QSqlQuery prune_query{ database };
+    if( !prune_query.exec( QString( "DELETE FROM inventory_deletions WHERE deleted_at < NOW(6) - INTERVAL %1 DAY" )
+                           .arg( InventoryCache::SNAPSHOT_MAX_AGE_DAYS ) ) ){
+        error = prune_query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// the rollups are kept up to date by InsertReports, a new table is filled once from the existing reports
+bool CreateRollupTable( QSqlDatabase & database, QString & error )
+{
+    QSqlQuery exists_query{ database };
+    if( !exists_query.exec( "SELECT COUNT(*) FROM information_schema.tables WHERE table_schema = DATABASE() "
+                            "AND table_name = 'report_daily_rollups'" ) || !exists_query.next() ){
+        error = exists_query.lastError().text();
+        return false;
+    }
+    if( exists_query.value( 0 ).toInt() > 0 ) return true;
+
+    QSqlQuery rollup_query{ database };
+    if( !rollup_query.exec( QString( "CREATE TABLE report_daily_rollups ( "
+                                     "day DATE NOT NULL, transaction_type INTEGER NOT NULL, "
+                                     "book_title VARCHAR(%1) NOT NULL, author_name VARCHAR(%1) NOT NULL, "
+                                     "quantity BIGINT NOT NULL, total DOUBLE NOT NULL, "
+                                     "transactions INTEGER NOT NULL, "
+                                     "PRIMARY KEY( day, transaction_type, book_title, author_name ) "
+                                     ") ENGINE=InnoDB" ).arg( ROLLUP_KEY_LENGTH ) ) ){
+        error = rollup_query.lastError().text();
+        return false;
+    }
+
+    QSqlQuery backfill_query{ database };
+    if( !backfill_query.exec( QString( "INSERT INTO report_daily_rollups "
+                                       "SELECT DATE( date_performed ), transaction_type, "
+                                       "LEFT( IFNULL( book_title, '' ), %1 ), LEFT( IFNULL( author_name, '' ), %1 ), "
+                                       "SUM( stock ), IFNULL( SUM( total ), 0 ), COUNT(*) FROM reports "
+                                       "WHERE date_performed IS NOT NULL AND transaction_type IS NOT NULL "
+                                       "GROUP BY 1, 2, 3, 4" ).arg( ROLLUP_KEY_LENGTH ) ) ){
+        error = backfill_query.lastError().text();
+        // without its backfill the table would silently under-report, try again next start
+        QSqlQuery( database ).exec( "DROP TABLE report_daily_rollups" );
+        return false;
+    }
+    return true;
+}
+
+}
+
+MySqlBackend::MySqlBackend():
+    MySqlBackend( QSettings{ "Phoebe", "BookManager" }.value( "mysql/database", "debug_db" ).toString() )
+{
+}
+
+MySqlBackend::MySqlBackend( QString const & database_name ): database_name{ database_name }
+{
+    QSettings settings{ "Phoebe", "BookManager" };
+    // we use 'localhost' since we're running the code on our local machine
+    host_name = settings.value( "mysql/host", "localhost" ).toString();
+    port = settings.value( "mysql/port", 3306 ).toInt();
+    // no built-in account, the server's administrator hands one out to each shop
+    user_name = settings.value( "mysql/user" ).toString();
+    password = settings.value( "mysql/password" ).toString();
+}
+
+QSqlDatabase MySqlBackend::AddConnection( QString const & connection_name ) const
+{
+    QSqlDatabase database = QSqlDatabase::addDatabase( "QMYSQL", connection_name );
+    database.setHostName( host_name );
+    database.setPort( port );
+    database.setDatabaseName( database_name );
+    database.setUserName( user_name );
+    database.setPassword( password );
+    // no MYSQL_OPT_RECONNECT: it would silently drop an open transaction. Lost connections are
+    // reopened by the ConnectionPool and the StatementCache, which know when that is safe
+    database.setConnectOptions( "MYSQL_OPT_CONNECT_TIMEOUT=5" );
+    return database;
+}
+
+bool MySqlBackend::ConfigureConnection( QSqlDatabase & ) const
+{
+    return true;
+}
+
+QString MySqlBackend::Identity() const
+{
+    return QString( "QMYSQL://%1@%2:%3/%4" ).arg( user_name, host_name ).arg( port ).arg( database_name );
+}
+
+QString MySqlBackend::SortColumn( QString const & column ) const
+{
+    return TEXT_SORT_COLUMNS.contains( column ) ? column + "_sort" : column;
+}
+
+bool MySqlBackend::CreateSchema( QSqlDatabase & database, QString & error ) const
+{
+    QSqlQuery create_table_query{ database };
+    create_table_query.prepare( QString( "CREATE TABLE IF NOT EXISTS %1 ( "
+                                         "serial_number INTEGER AUTO_INCREMENT PRIMARY KEY, "
+                                         "book_title TEXT,"
+                                         "author_name TEXT,"
+                                         "publisher TEXT, date_time DATETIME, "
+                                         "stock INTEGER NOT NULL, price DOUBLE, "
+                                         "location TEXT, "
+                                         "low_stock_threshold INTEGER NOT NULL DEFAULT %2, "
+                                         "cover_hash CHAR(64) NULL, "
+                                         "updated_at TIMESTAMP(6) NOT NULL DEFAULT CURRENT_TIMESTAMP(6) "
+                                         "ON UPDATE CURRENT_TIMESTAMP(6), "
+                                         "FULLTEXT( book_title, author_name ) "
+                                         ") ENGINE=InnoDB"
+                                         "" ).arg( AddItemDialog::TABLE_NAME ).arg( LowStockTracker::DEFAULT_THRESHOLD ));
+    // we execute the query to create the table, if it fails, we quit!
+    if( !create_table_query.exec() ){
+        error = create_table_query.lastError().text();
+        return false;
+    }
+    if( !UpgradeInventoryTable( database, error ) || !CreateCoversTable( database, error ) ||
+            !MigrateCoverBlobs( database, error ) ||
+            !CreateDeletionsTable( database, error ) ){
+        return false;
+    }
+
+    QSqlQuery report_query{ database };
+    report_query.prepare( "CREATE TABLE IF NOT EXISTS reports ( "
+                          "serial_number INTEGER AUTO_INCREMENT PRIMARY KEY,"
+                          "book_title TEXT, author_name TEXT, stock INTEGER NOT NULL, "
+                          "price DOUBLE, total DOUBLE, date_performed DATETIME, "
+                          "transaction_type INTEGER ) ENGINE=InnoDB" );
+
+    if( !report_query.exec() ){
+        error = report_query.lastError().text();
+        return false;
+    }
+    return CreateReportIndexes( database, error ) && CreateRollupTable( database, error );
+}
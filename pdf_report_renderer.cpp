@@ -0,0 +1,194 @@
+#include "pdf_report_renderer.hpp"
+
+#include <QFile>
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QQueue>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <array>
+
+int const PdfReportRenderer::RESOLUTION = 300;
+int const PdfReportRenderer::PAGES_PER_TASK = 8;
+
+namespace {
+int const COLUMN_COUNT = 7;
+char const *const COLUMN_TITLES[COLUMN_COUNT] = { "Title", "Author", "Quantity", "Price", "Total",
+                                                  "Transaction", "Date" };
+qreal const COLUMN_WIDTHS[COLUMN_COUNT] = { 0.26, 0.20, 0.07, 0.09, 0.10, 0.11, 0.17 }; // of the page width
+qreal const ROW_HEIGHT_PT = 14.0;
+qreal const FONT_SIZE_PT = 8.0;
+qreal const TITLE_FONT_SIZE_PT = 12.0;
+qreal const CELL_PADDING_PT = 2.0;
+
+qreal ToDevice( qreal points )
+{
+    return points * PdfReportRenderer::RESOLUTION / 72.0;
+}
+
+// pixel sized, so metrics taken on a worker thread match what the painter uses on the device
+QFont MakeFont( qreal size_pt, bool is_bold )
+{
+    QFont font{ "Helvetica" };
+    font.setPixelSize( qRound( ToDevice( size_pt ) ) );
+    font.setBold( is_bold );
+    return font;
+}
+
+using PageCells = QVector<std::array<QString, COLUMN_COUNT>>;
+
+struct PageGeometry
+{
+    qreal width;
+    qreal row_height;
+    int   rows_per_page;
+    std::array<qreal, COLUMN_COUNT> column_x;
+    std::array<qreal, COLUMN_COUNT> column_width;
+};
+
+struct PageRange
+{
+    QList<ReportFormat> rows; // PAGES_PER_TASK pages worth, fewer for the last range
+    PageGeometry const  *geometry;
+};
+
+// the expensive part of table layout: formatting and eliding every cell to its column
+QVector<PageCells> LayoutPages( PageRange const & range )
+{
+    QFontMetricsF const metrics{ MakeFont( FONT_SIZE_PT, false ) };
+    qreal const padding = ToDevice( CELL_PADDING_PT );
+    PageGeometry const & geometry = *range.geometry;
+
+    QVector<PageCells> pages {};
+    pages.reserve( ( range.rows.size() + geometry.rows_per_page - 1 ) / geometry.rows_per_page );
+    for( int first_row = 0; first_row < range.rows.size(); first_row += geometry.rows_per_page ){
+        int const last_row = qMin( first_row + geometry.rows_per_page, range.rows.size() );
+        PageCells cells {};
+        cells.reserve( last_row - first_row );
+        for( int row = first_row; row < last_row; ++row ){
+            ReportFormat const & data = range.rows.at( row );
+            std::array<QString, COLUMN_COUNT> const texts { data.book_title, data.author_name,
+                        QString::number( data.quantity ), QString::number( data.price, 'f', 2 ),
+                        QString::number( data.total, 'f', 2 ), Stringify( data.detail ),
+                        data.date_time_added.toString( "yyyy-MM-dd HH:mm" ) };
+            std::array<QString, COLUMN_COUNT> line {};
+            for( int column = 0; column != COLUMN_COUNT; ++column ){
+                line[column] = metrics.elidedText( texts[column], Qt::ElideRight,
+                                                   geometry.column_width[column] - 2 * padding );
+            }
+            cells.append( line );
+        }
+        pages.append( cells );
+    }
+    return pages;
+}
+}
+
+PdfReportRenderer::PdfReportRenderer( QString const & report_title ): title{ report_title }
+{
+}
+
+qint64 PdfReportRenderer::Render( RowSource const & next_row, QString const & filename,
+                                  std::function<bool( qint64 )> const & on_page )
+{
+    QPdfWriter writer{ filename };
+    writer.setResolution( RESOLUTION );
+    writer.setPageSize( QPageSize( QPageSize::A4 ) );
+    writer.setPageMargins( QMarginsF( 15, 15, 15, 15 ), QPageLayout::Millimeter );
+    writer.setTitle( title );
+
+    QFont const title_font = MakeFont( TITLE_FONT_SIZE_PT, true ), header_font = MakeFont( FONT_SIZE_PT, true ),
+            cell_font = MakeFont( FONT_SIZE_PT, false );
+    qreal const padding = ToDevice( CELL_PADDING_PT );
+    qreal const title_height = ToDevice( TITLE_FONT_SIZE_PT * 2 );
+
+    PageGeometry geometry {};
+    geometry.width = writer.width();
+    geometry.row_height = ToDevice( ROW_HEIGHT_PT );
+    // every page carries the title and one header row
+    geometry.rows_per_page = qMax( 1, static_cast<int>( ( writer.height() - title_height ) / geometry.row_height ) - 1 );
+    qreal x = 0;
+    for( int column = 0; column != COLUMN_COUNT; ++column ){
+        geometry.column_x[column] = x;
+        geometry.column_width[column] = COLUMN_WIDTHS[column] * geometry.width;
+        x += geometry.column_width[column];
+    }
+
+    // the source is read on this thread only, a cursor belongs to the thread that executed it
+    int const rows_per_range = geometry.rows_per_page * PAGES_PER_TASK;
+    int const max_ranges_in_flight = qMax( 2, QThread::idealThreadCount() );
+    QQueue<QFuture<QVector<PageCells>>> layouts {};
+    bool has_more_rows = true;
+    auto lay_out_more = [&]{
+        while( has_more_rows && layouts.size() < max_ranges_in_flight ){
+            PageRange range{ {}, &geometry };
+            range.rows.reserve( rows_per_range );
+            ReportFormat row {};
+            while( range.rows.size() < rows_per_range ){
+                has_more_rows = next_row( row );
+                if( !has_more_rows ) break;
+                range.rows.append( row );
+            }
+            if( range.rows.isEmpty() ) return;
+            layouts.enqueue( QtConcurrent::run( LayoutPages, range ) );
+        }
+    };
+    // nothing to report, nothing written
+    lay_out_more();
+    if( layouts.isEmpty() ) return 0;
+
+    QPainter painter {};
+    if( !painter.begin( &writer ) ){
+        for( auto & layout : layouts ) layout.waitForFinished();
+        error = QString( "Unable to write %1" ).arg( filename );
+        return -1;
+    }
+
+    auto draw_row = [&]( qreal y, std::array<QString, COLUMN_COUNT> const & cells ){
+        for( int column = 0; column != COLUMN_COUNT; ++column ){
+            QRectF const cell{ geometry.column_x[column], y, geometry.column_width[column], geometry.row_height };
+            painter.drawRect( cell );
+            painter.drawText( cell.adjusted( padding, 0, -padding, 0 ), Qt::AlignVCenter | Qt::AlignLeft,
+                              cells[column] );
+        }
+    };
+    std::array<QString, COLUMN_COUNT> headers {};
+    for( int column = 0; column != COLUMN_COUNT; ++column ) headers[column] = COLUMN_TITLES[column];
+
+    qint64 rows_done = 0;
+    int page_number = 0;
+    // ranges are painted in order, each one as soon as it has been laid out
+    while( !layouts.isEmpty() ){
+        QVector<PageCells> const pages = layouts.dequeue().result();
+        lay_out_more();
+        for( PageCells const & cells : pages ){
+            if( page_number != 0 ) writer.newPage();
+            ++page_number;
+
+            painter.setFont( title_font );
+            painter.drawText( QRectF( 0, 0, geometry.width, title_height ), Qt::AlignCenter,
+                              QString( "Bookshop Report( %1 ) - page %2" ).arg( title, QString::number( page_number ) ) );
+            painter.setFont( header_font );
+            draw_row( title_height, headers );
+            painter.setFont( cell_font );
+            qreal y = title_height + geometry.row_height;
+            for( auto const & line : cells ){
+                draw_row( y, line );
+                y += geometry.row_height;
+            }
+
+            rows_done += cells.size();
+            if( on_page && !on_page( rows_done ) ){
+                for( auto & layout : layouts ) layout.waitForFinished();
+                painter.end();
+                QFile::remove( filename );
+                error = "Cancelled";
+                return -1;
+            }
+        }
+    }
+    painter.end();
+    return rows_done;
+}
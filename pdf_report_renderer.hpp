@@ -0,0 +1,37 @@
+#ifndef PDF_REPORT_RENDERER_HPP
+#define PDF_REPORT_RENDERER_HPP
+
+#include <QFont>
+#include <QList>
+#include <QString>
+#include <functional>
+#include "resources.hpp"
+
+// lays report rows out as fixed-height table rows straight onto a QPdfWriter, the page title and
+// the column headers are repeated on every page. Rows are pulled from a source as they are needed,
+// PAGES_PER_TASK pages at a time: those are laid out in parallel on the global thread pool while
+// the next ones are read, and finished pages are painted and written in order. At most a few
+// ranges of rows are held at any time, however long the report.
+class PdfReportRenderer
+{
+public:
+    // fills in the next row, false once there are no more
+    using RowSource = std::function<bool( ReportFormat & )>;
+
+    explicit PdfReportRenderer( QString const & title );
+
+    // returns the number of rows written, no file is written for a report without rows. -1 on
+    // failure, or when `on_page( rows_done )`, called after every page, returned false: the file
+    // is removed then.
+    qint64 Render( RowSource const & next_row, QString const & filename,
+                   std::function<bool( qint64 )> const & on_page = {} );
+    QString const & ErrorString() const { return error; }
+
+    static int const RESOLUTION;
+    static int const PAGES_PER_TASK;
+private:
+    QString title;
+    QString error;
+};
+
+#endif // PDF_REPORT_RENDERER_HPP
@@ -0,0 +1,219 @@
+#include "query_tracer.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+
+int const QueryTracer::DEFAULT_SLOW_QUERY_MS = 250;
+qint64 const QueryTracer::SLOW_LOG_MAX_BYTES = 1024 * 1024;
+int const QueryTracer::SLOW_LOG_FILES = 3;
+
+namespace {
+// the trace of this thread's last SELECT, until its rows have been decoded
+struct PendingTrace
+{
+    QueryTrace  trace;
+    bool        is_open = false;
+};
+
+thread_local PendingTrace pending {};
+
+QString AsMsecs( qint64 usecs )
+{
+    return QString::number( usecs / 1000.0, 'f', 2 ) + "ms";
+}
+}
+
+LatencyHistogram::LatencyHistogram(): count( 0 ), total( 0 ), max( 0 )
+{
+    counts.fill( 0 );
+}
+
+int LatencyHistogram::IndexOf( qint64 value )
+{
+    if( value < SUB_BUCKETS ) return static_cast<int>( qMax<qint64>( 0, value ) );
+    // shifted right until it lands in the upper half of the sub-buckets
+    int const highest_bit = 63 - qCountLeadingZeroBits( static_cast<quint64>( value ) );
+    int const shift = highest_bit - ( SUB_BUCKET_BITS - 1 );
+    int const sub_bucket = static_cast<int>( value >> shift );
+    return SUB_BUCKETS + ( shift - 1 ) * HALF_SUB_BUCKETS + ( sub_bucket - HALF_SUB_BUCKETS );
+}
+
+qint64 LatencyHistogram::HighestValueAt( int index )
+{
+    if( index < SUB_BUCKETS ) return index;
+    int const shift = ( index - SUB_BUCKETS ) / HALF_SUB_BUCKETS + 1;
+    qint64 const sub_bucket = ( index - SUB_BUCKETS ) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+    return ( ( sub_bucket + 1 ) << shift ) - 1;
+}
+
+void LatencyHistogram::Record( qint64 usecs )
+{
+    qint64 const value = qBound<qint64>( 0, usecs, HighestValueAt( BUCKET_COUNT - 1 ) );
+    ++counts[ IndexOf( value ) ];
+    ++count;
+    total += value;
+    max = qMax( max, value );
+}
+
+qint64 LatencyHistogram::ValueAtPercentile( double percentile ) const
+{
+    if( count == 0 ) return 0;
+    qint64 const wanted = qMax<qint64>( 1, static_cast<qint64>( std::ceil( percentile / 100.0 * count ) ) );
+    qint64 seen = 0;
+    for( int index = 0; index != BUCKET_COUNT; ++index ){
+        seen += counts[index];
+        if( seen >= wanted ) return qMin( HighestValueAt( index ), max );
+    }
+    return max;
+}
+
+QueryTracer::QueryTracer()
+{
+    QSettings settings{ "Phoebe", "BookManager" };
+    slow_query_usecs = settings.value( "diagnostics/slow_query_ms", DEFAULT_SLOW_QUERY_MS ).toLongLong() * 1000;
+    log_file.setFileName( SlowLogPath() );
+}
+
+QueryTracer & QueryTracer::Instance()
+{
+    static QueryTracer tracer {};
+    return tracer;
+}
+
+void QueryTracer::Executed( QString const & name, qint64 prepare_usecs, qint64 exec_usecs, QSqlQuery const & query )
+{
+    Flush();
+    QueryTrace trace {};
+    trace.name = name;
+    trace.prepare_usecs = prepare_usecs;
+    trace.exec_usecs = exec_usecs;
+    if( !query.isSelect() ){
+        trace.rows = query.numRowsAffected();
+        Record( trace );
+        return;
+    }
+    pending.trace = trace;
+    pending.is_open = true;
+}
+
+void QueryTracer::Fetched( qint64 rows, qint64 bytes, qint64 fetch_usecs )
+{
+    if( !pending.is_open ) return; // not one of ours
+    pending.trace.rows = qMax<qint64>( 0, pending.trace.rows ) + rows;
+    pending.trace.bytes += bytes;
+    pending.trace.fetch_usecs += fetch_usecs;
+    Flush();
+}
+
+void QueryTracer::Flush()
+{
+    if( !pending.is_open ) return;
+    pending.is_open = false;
+    Record( pending.trace );
+}
+
+bool QueryTracer::Exec( QString const & name, QSqlQuery & query, QString const & sql )
+{
+    Flush();
+    QElapsedTimer elapsed {};
+    elapsed.start();
+    bool const is_executed = sql.isEmpty() ? query.exec() : query.exec( sql );
+    Executed( name, 0, elapsed.nsecsElapsed() / 1000, query );
+    return is_executed;
+}
+
+void QueryTracer::Timed( QString const & name, qint64 usecs, qint64 rows )
+{
+    QueryTrace trace {};
+    trace.name = name;
+    trace.exec_usecs = usecs;
+    trace.rows = rows;
+    Record( trace );
+}
+
+void QueryTracer::Record( QueryTrace const & trace )
+{
+    qint64 const total_usecs = trace.prepare_usecs + trace.exec_usecs + trace.fetch_usecs;
+    {
+        QMutexLocker lock{ &mutex };
+        Statistics & statement = statistics[trace.name];
+        statement.latency.Record( total_usecs );
+        statement.rows += qMax<qint64>( 0, trace.rows );
+        statement.bytes += trace.bytes;
+    }
+    if( total_usecs >= slow_query_usecs ) LogSlow( trace, total_usecs );
+}
+
+QList<StatementSummary> QueryTracer::Slowest( int count ) const
+{
+    QList<StatementSummary> summaries {};
+    {
+        QMutexLocker lock{ &mutex };
+        for( auto iter = statistics.cbegin(); iter != statistics.cend(); ++iter ){
+            LatencyHistogram const & latency = iter.value().latency;
+            summaries.append( StatementSummary{ iter.key(), latency.Count(), latency.ValueAtPercentile( 50 ),
+                                                latency.ValueAtPercentile( 95 ), latency.ValueAtPercentile( 99 ),
+                                                latency.Max(), iter.value().rows, iter.value().bytes } );
+        }
+    }
+    std::sort( summaries.begin(), summaries.end(), []( StatementSummary const & a, StatementSummary const & b ){
+        return a.p99 > b.p99;
+    });
+    return summaries.mid( 0, count );
+}
+
+int QueryTracer::SlowQueryThreshold() const
+{
+    return static_cast<int>( slow_query_usecs / 1000 );
+}
+
+void QueryTracer::SetSlowQueryThreshold( int msecs )
+{
+    slow_query_usecs = qint64( msecs ) * 1000;
+    QSettings{ "Phoebe", "BookManager" }.setValue( "diagnostics/slow_query_ms", msecs );
+}
+
+QString QueryTracer::SlowLogPath() const
+{
+    QString const directory = QStandardPaths::writableLocation( QStandardPaths::AppDataLocation );
+    QDir().mkpath( directory );
+    return directory + "/slow_queries.log";
+}
+
+void QueryTracer::LogSlow( QueryTrace const & trace, qint64 total_usecs )
+{
+    QString const line = QString( "%1 %2 total=%3 prepare=%4 exec=%5 fetch=%6 rows=%7 bytes=%8\n" )
+            .arg( QDateTime::currentDateTime().toString( Qt::ISODateWithMs ), trace.name, AsMsecs( total_usecs ),
+                  AsMsecs( trace.prepare_usecs ), AsMsecs( trace.exec_usecs ), AsMsecs( trace.fetch_usecs ) )
+            .arg( trace.rows ).arg( trace.bytes );
+
+    QMutexLocker lock{ &log_mutex };
+    if( log_file.isOpen() && log_file.size() >= SLOW_LOG_MAX_BYTES ) RotateLog();
+    if( !log_file.isOpen() && !log_file.open( QIODevice::WriteOnly | QIODevice::Append ) ){
+        qDebug() << "Unable to open the slow query log:" << log_file.errorString();
+        return;
+    }
+    log_file.write( line.toUtf8() );
+    log_file.flush();
+}
+
+// slow_queries.log becomes slow_queries.log.1, .1 becomes .2 and so on, the oldest is dropped
+void QueryTracer::RotateLog()
+{
+    log_file.close();
+    QString const path = log_file.fileName();
+    QFile::remove( QString( "%1.%2" ).arg( path ).arg( SLOW_LOG_FILES ) );
+    for( int file = SLOW_LOG_FILES - 1; file >= 1; --file ){
+        QFile::rename( QString( "%1.%2" ).arg( path ).arg( file ), QString( "%1.%2" ).arg( path ).arg( file + 1 ) );
+    }
+    QFile::rename( path, path + ".1" );
+}
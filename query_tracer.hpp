@@ -0,0 +1,113 @@
+#ifndef QUERY_TRACER_HPP
+#define QUERY_TRACER_HPP
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <array>
+#include <atomic>
+
+class QSqlQuery;
+
+// one execution of a statement, times in microseconds
+struct QueryTrace
+{
+    QString name;
+    qint64  prepare_usecs = 0; // 0 when the prepared statement was reused
+    qint64  exec_usecs = 0;
+    qint64  fetch_usecs = 0;   // decoding the result set( see FillFromQuery )
+    qint64  rows = -1;         // returned or affected, -1 if unknown
+    qint64  bytes = 0;         // decoded, estimated from a sample of the rows
+};
+
+// latency distribution in the manner of HdrHistogram: values below 128us are counted exactly,
+// larger ones in buckets 1/64th of a power of two wide, so any percentile is within 1.6% of the
+// recorded value in a fixed 9KB. Not thread safe.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void Record( qint64 usecs );
+    qint64 Count() const { return count; }
+    qint64 Max() const { return max; }
+    qint64 Mean() const { return count == 0 ? 0 : total / count; }
+    qint64 ValueAtPercentile( double percentile ) const; // the highest value its bucket can hold
+private:
+    static int const SUB_BUCKET_BITS = 7;
+    static int const SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static int const HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+    static int const MAX_SHIFT = 40 - SUB_BUCKET_BITS; // values above 2^40us( 12 days ) are clamped
+    static int const BUCKET_COUNT = SUB_BUCKETS + MAX_SHIFT * HALF_SUB_BUCKETS;
+
+    static int IndexOf( qint64 value );
+    static qint64 HighestValueAt( int index );
+private:
+    std::array<quint32, BUCKET_COUNT> counts;
+    qint64 count;
+    qint64 total;
+    qint64 max;
+};
+
+// what the diagnostics dialog shows for a statement, times in microseconds
+struct StatementSummary
+{
+    QString name;
+    qint64  calls;
+    qint64  p50;
+    qint64  p95;
+    qint64  p99;
+    qint64  max;
+    qint64  rows;  // over all calls
+    qint64  bytes; // over all calls
+};
+
+// times every statement the application runs. StatementCache reports its statements itself,
+// anything else runs through Exec(). A SELECT's trace stays open on its thread until the rows
+// have been decoded( FillFromQuery reports them through Fetched ), the thread's next statement
+// or Flush() closes it. Closed traces go into a latency histogram per statement, and those that
+// took longer than the slow query threshold are written to a rotating log. Thread safe.
+class QueryTracer
+{
+public:
+    static QueryTracer & Instance();
+
+    void Executed( QString const & name, qint64 prepare_usecs, qint64 exec_usecs, QSqlQuery const & query );
+    void Fetched( qint64 rows, qint64 bytes, qint64 fetch_usecs );
+    void Flush();
+    // query.exec(), or query.exec( sql ) if `sql` is given, traced under `name`
+    bool Exec( QString const & name, QSqlQuery & query, QString const & sql = QString() );
+    // a step that is not a statement, e.g. the inventory cache's start, recorded and shown like one
+    void Timed( QString const & name, qint64 usecs, qint64 rows );
+
+    QList<StatementSummary> Slowest( int count ) const; // by their 99th percentile
+    int  SlowQueryThreshold() const; // in milliseconds
+    void SetSlowQueryThreshold( int msecs );
+    QString SlowLogPath() const;
+
+    static int const DEFAULT_SLOW_QUERY_MS;
+    static qint64 const SLOW_LOG_MAX_BYTES; // per file
+    static int const SLOW_LOG_FILES;        // kept besides the current one
+private:
+    struct Statistics
+    {
+        LatencyHistogram    latency; // prepare, exec and fetch together
+        qint64              rows = 0;
+        qint64              bytes = 0;
+    };
+
+    QueryTracer();
+    void Record( QueryTrace const & trace );
+    void LogSlow( QueryTrace const & trace, qint64 total_usecs );
+    void RotateLog();
+private:
+    mutable QMutex              mutex;
+    QHash<QString, Statistics>  statistics;
+    std::atomic<qint64>         slow_query_usecs;
+    QMutex                      log_mutex;
+    QFile                       log_file;
+};
+
+#endif // QUERY_TRACER_HPP
@@ -1,31 +1,35 @@
 #include "report_dialog.hpp"
 #include "ui_report_dialog.h"
+#include "report_export.hpp"
 
 #include <QFileDialog>
 #include <QList>
 #include <QMessageBox>
-#include <QPrinter>
-#include <QSqlQuery>
-#include <QDebug>
-#include <QSqlError>
 #include <QStringList>
-#include <QTextDocument>
-#include <QTextStream>
 
 ReportDialog::ReportDialog(QWidget *parent) :
     QDialog(parent),
-    ui( new Ui::ReportDialog ), type{ ReportActionType::ALL }, format{ ReportFormatType::PDF }
+    ui( new Ui::ReportDialog ), type{ ReportActionType::ALL }, format{ ReportFormatType::PDF },
+    granularity{ ReportGranularity::Transactions }, current_export_id{ 0 }
 {
     ui->setupUi(this);
 
     SetupWindow();
-    setMaximumSize( 320, 270 );
+    setMaximumSize( 320, 350 );
     setWindowTitle( "Generate report" );
 
     QObject::connect( ui->formatComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(onFormatChanged(int)) );
     QObject::connect( ui->reportTypeComboBox, SIGNAL(currentIndexChanged(int)), this,
                       SLOT(onReportChanged(int)) );
+    QObject::connect( ui->granularityComboBox, SIGNAL(currentIndexChanged(int)), this,
+                      SLOT(onGranularityChanged(int)) );
     QObject::connect( ui->pushButton, SIGNAL(clicked(bool)), this, SLOT(onGenerateButtonClicked()) );
+    QObject::connect( ui->cancelButton, SIGNAL(clicked(bool)), this, SLOT(onCancelButtonClicked()) );
+    QObject::connect( &ReportExporter::Instance(), SIGNAL(progress(quint64,qint64,qint64,double)), this,
+                      SLOT(onExportProgress(quint64,qint64,qint64,double)) );
+    QObject::connect( &ReportExporter::Instance(), SIGNAL(finished(quint64,bool,QString)), this,
+                      SLOT(onExportFinished(quint64,bool,QString)) );
+    ResetProgress();
 }
 
 ReportDialog::~ReportDialog()
@@ -41,6 +45,7 @@ void ReportDialog::SetupWindow()
 
     format_type_list << "PDF" << "CSV";
     ui->formatComboBox->addItems( format_type_list );
+    ui->granularityComboBox->addItems( QStringList{ "Every transaction", "Daily totals", "Monthly totals" } );
     ui->toDateTimeEdit->setDateTime( QDateTime::currentDateTime() );
 }
 
@@ -57,98 +62,114 @@ void ReportDialog::onReportChanged( int new_report_type )
     }
 }
 
-QSqlQuery ReportDialog::GetQuery()
+void ReportDialog::onGranularityChanged( int new_granularity )
 {
-    QString to_date = GetDateTime( ui->toDateTimeEdit->dateTime() ),
-            from_date = GetDateTime( ui->fromDateTimeEdit->dateTime() );
+    granularity = static_cast<ReportGranularity>( new_granularity );
+}
 
+// totals come from the daily rollups, only single transactions need the reports table itself
+StatementId ReportDialog::GetStatement( ReportActionType type, ReportGranularity granularity )
+{
     bool const is_generating_all = ( type == ReportActionType::ALL );
-    QString query_string = tr( "SELECT * FROM reports WHERE "
-                               "( date_performed >= :from && date_performed <= :to ) %1" )
-            .arg( is_generating_all? "" : "&& transaction_type = :type ");
-
-    QSqlQuery query {};
-    query.prepare( query_string );
-    query.bindValue(":from", from_date );
-    query.bindValue( ":to", to_date );
-    if( !is_generating_all ){
-        query.bindValue( ":type", static_cast<int>( type ) );
+    switch( granularity ){
+    case ReportGranularity::Daily:
+        return is_generating_all ? StatementId::DailyRollupsInRange : StatementId::DailyRollupsInRangeByType;
+    case ReportGranularity::Monthly:
+        return is_generating_all ? StatementId::MonthlyRollupsInRange : StatementId::MonthlyRollupsInRangeByType;
+    case ReportGranularity::Transactions:
+    default:
+        return is_generating_all ? StatementId::ReportsInRange : StatementId::ReportsInRangeByType;
     }
+}
 
-    return query;
+// bound as QDateTime, so the range is compared in the format the rows were stored in( see InlineSql )
+QMap<QString, QVariant> ReportDialog::QueryValues( QDateTime const & from, QDateTime const & to,
+                                                  ReportActionType type )
+{
+    QMap<QString, QVariant> values {};
+    values.insert( ":from", from );
+    values.insert( ":to", to );
+    if( type != ReportActionType::ALL ){
+        values.insert( ":type", static_cast<int>( type ) );
+    }
+    return values;
 }
 
 void ReportDialog::onGenerateButtonClicked()
 {
     bool const is_csv = ( format == ReportFormatType::CSV );
+    QString const filename = QFileDialog::getSaveFileName( this, tr("Save file"), "",
+                                                           is_csv ? tr( "CSV (*.csv)" ) : tr( "PDF (*.pdf)" ) );
+    if( filename.isNull() ) return;
 
-    QSqlQuery select_all_query { GetQuery() };
+    ReportRequest request {};
+    request.format = format;
+    request.filename = filename;
+    request.title = ( type == ReportActionType::ALL ? QString( "All transactions" ) : Stringify( type ) );
+    request.statement = GetStatement( type, granularity );
+    request.values = QueryValues( ui->fromDateTimeEdit->dateTime(), ui->toDateTimeEdit->dateTime(), type );
+
+    current_export_id = ReportExporter::Instance().Start( request );
+    ui->pushButton->setEnabled( false );
+    ui->cancelButton->setEnabled( true );
+    ui->progressBar->setRange( 0, 0 ); // busy until the number of rows is known
+    ui->progressBar->setVisible( true );
+}
 
-    if( !select_all_query.exec() ){
-        qDebug() << select_all_query.lastError();
-        qDebug() << "Executed query" << select_all_query.executedQuery();
-        QMessageBox::critical( this, "Report", "Unable to generate report from the database" );
-        return;
-    }
-    QList<ReportFormat> data_list {};
+// the user asked for it, so the cancellation is not reported back as a failure
+void ReportDialog::onCancelButtonClicked()
+{
+    quint64 const export_id = current_export_id;
+    ResetProgress();
+    if( export_id != 0 ) ReportExporter::Instance().Cancel( export_id );
+}
 
-    FillReportFromQuery( data_list, select_all_query );
-    if( data_list.isEmpty() ){
-        QMessageBox::information( this, "Report", "There's nothing to report at the moment");
-        return;
+void ReportDialog::reject()
+{
+    if( current_export_id != 0 && ReportExporter::Instance().IsRunning( current_export_id ) ){
+        auto const answer = QMessageBox::question( this, "Report", "The report is still being generated, "
+                                                   "keep generating it in the background?",
+                                                   QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel );
+        if( answer == QMessageBox::Cancel ) return;
+        quint64 const export_id = current_export_id;
+        current_export_id = 0;
+        if( answer == QMessageBox::Yes ){
+            ReportExporter::Instance().Detach( export_id );
+        } else {
+            ReportExporter::Instance().Cancel( export_id );
+        }
     }
+    QDialog::reject();
+}
 
-    QString const filename = QFileDialog::getSaveFileName( this, tr("Save file"), "",
-                                                           tr( is_csv ? "CSV (*.csv)" : "PDF(*.pdf)" ) );
-
-    if( filename.isNull() ) return;
-
-    if( is_csv ){
-        QFile file{ filename };
-        if( !file.open( QIODevice::WriteOnly ) ){
-            QMessageBox::critical( this, "Save report", "Error saving report file, try again later",
-                                   QMessageBox::Ok );
-            return;
-        }
-        QTextStream file_stream(&file);
-        file_stream << "book_title, author_name, stock, date_perfomed, transaction_type\r\n";
-        for( auto const & data: data_list ){
-            file_stream << data.book_title << ", " << data.author_name << ", " << data.quantity << ", "
-                        << data.date_time_added.toString() << ", " << Stringify( data.detail ) << "\r\n";
-        }
-        file.close();
-    } else { // it's a PDF
-        QString pdf_string(
-                    tr( "<div align=\"center\"><big>Bookshop Report( %1 )</big><br><br><br>"
-                        "<table border = \"1\"><tr>"
-                        "<th>Title</th>"
-                        "<th>Author</th>"
-                        "<th>Quantity</th>"
-                        "<th>Price</th>"
-                        "<th>Total</th>"
-                        "<th>Transaction</th>"
-                        "<th>Date</th></tr>" )
-                    .arg( type == ReportActionType::ALL ? "All transactions" : Stringify( type )));
-        for( auto const & data: data_list ){
-            pdf_string += ( "<tr><td>" + data.book_title + "</td><td>" + data.author_name +
-                            "</td><td>" + QString::number( data.quantity ) + "</td>" +
-                            "<td>" + QString::number( data.price ) + "</td>" +
-                            "<td>" + QString::number( data.total ) + "</td><td>" +
-                            Stringify( data.detail ) + "</td><td>" + data.date_time_added.toString() +
-                            "</td></tr>");
-        }
+void ReportDialog::ResetProgress()
+{
+    current_export_id = 0;
+    ui->pushButton->setEnabled( true );
+    ui->cancelButton->setEnabled( false );
+    ui->progressBar->setVisible( false );
+    setWindowTitle( "Generate report" );
+}
 
-        pdf_string += "</table></div>";
-        QPrinter printer( QPrinter::PrinterResolution );
-        printer.setOutputFormat( QPrinter::PdfFormat );
-        printer.setPaperSize( QPrinter::A4 );
-        printer.setOutputFileName( filename );
+void ReportDialog::onExportFinished( quint64 export_id, bool ok, QString const & message )
+{
+    if( export_id != current_export_id ) return;
+    ResetProgress();
+    if( ok ){
+        QMessageBox::information( this, "Report", message );
+    } else {
+        QMessageBox::critical( this, "Report", message );
+    }
+}
 
-        QTextDocument htmlDoc {};
-        htmlDoc.setHtml( pdf_string );
-        htmlDoc.setPageSize( printer.pageRect().size() );
-        htmlDoc.print( &printer );
+void ReportDialog::onExportProgress( quint64 export_id, qint64 rows, qint64 total, double rows_per_second )
+{
+    if( export_id != current_export_id ) return;
+    if( total > 0 ){
+        // QProgressBar counts in int, so large reports are shown in per mille
+        ui->progressBar->setRange( 0, 1000 );
+        ui->progressBar->setValue( static_cast<int>( rows * 1000 / total ) );
     }
-    QMessageBox::information( this, "Report", tr( "Report has been generated successfully into %1")
-                              .arg( filename ));
+    setWindowTitle( tr( "Generate report - %1 rows( %2 rows/s )" )
+                    .arg( QString::number( rows ), QString::number( rows_per_second, 'f', 0 ) ) );
 }
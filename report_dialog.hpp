@@ -3,15 +3,11 @@
 
 #include <QDialog>
 #include "resources.hpp"
+#include "statement_cache.hpp"
 
 namespace Ui {
 class ReportDialog;
 }
-enum class ReportFormatType {
-    PDF = 0,
-    CSV,
-    INVALID
-};
 
 class ReportDialog : public QDialog
 {
@@ -20,17 +16,30 @@ class ReportDialog : public QDialog
 public:
     explicit ReportDialog( QWidget *parent = 0);
     ~ReportDialog();
+
+    // the statement and the values a report runs with, shared with the tests and the benchmarks
+    static StatementId GetStatement( ReportActionType type, ReportGranularity granularity );
+    static QMap<QString, QVariant> QueryValues( QDateTime const & from, QDateTime const & to,
+                                               ReportActionType type );
 private:
     void SetupWindow();
-    QSqlQuery GetQuery();
+    void ResetProgress();
+public slots:
+    void reject() override;
 private slots:
     void onFormatChanged( int );
     void onReportChanged( int );
+    void onGranularityChanged( int );
     void onGenerateButtonClicked();
+    void onCancelButtonClicked();
+    void onExportProgress( quint64 export_id, qint64 rows, qint64 total, double rows_per_second );
+    void onExportFinished( quint64 export_id, bool ok, QString const & message );
 private:
     Ui::ReportDialog *ui;
     ReportFormatType format;
     ReportActionType type;
+    ReportGranularity granularity;
+    quint64 current_export_id;
 };
 
 #endif // REPORT_DIALOG_HPP
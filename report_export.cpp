@@ -0,0 +1,383 @@
+#include "report_export.hpp"
+#include "connection_pool.hpp"
+#include "pdf_report_renderer.hpp"
+#include "query_tracer.hpp"
+#include "storage_backend.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QIODevice>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtConcurrent>
+
+int const CsvWriter::BUFFER_SIZE = 1024 * 1024;
+int const ReportExporter::PROGRESS_INTERVAL_MS = 250;
+int const ReportExporter::MAX_CONCURRENT_EXPORTS = 2;
+
+CsvWriter::CsvWriter( QIODevice *output, int buffer_size ):
+    device{ output }, flush_threshold{ buffer_size }, at_row_start{ true }, has_failed{ false }
+{
+    // some headroom, so a field that crosses the threshold does not reallocate
+    buffer.reserve( buffer_size + 4096 );
+}
+
+CsvWriter::~CsvWriter()
+{
+    Flush();
+}
+
+void CsvWriter::StartField()
+{
+    if( !at_row_start ) buffer.append( ',' );
+    at_row_start = false;
+}
+
+void CsvWriter::WriteField( QString const & field )
+{
+    StartField();
+    bool needs_quotes = false;
+    for( QChar const c : field ){
+        if( c == QLatin1Char( ',' ) || c == QLatin1Char( '"' ) || c == QLatin1Char( '\r' ) ||
+                c == QLatin1Char( '\n' ) ){
+            needs_quotes = true;
+            break;
+        }
+    }
+    if( !needs_quotes ){
+        AppendUtf8( field );
+        return;
+    }
+    buffer.append( '"' );
+    if( field.contains( QLatin1Char( '"' ) ) ){
+        AppendUtf8( QString( field ).replace( QLatin1Char( '"' ), QLatin1String( "\"\"" ) ) );
+    } else {
+        AppendUtf8( field );
+    }
+    buffer.append( '"' );
+}
+
+void CsvWriter::WriteField( qint64 number )
+{
+    StartField();
+    buffer.append( QByteArray::number( number ) );
+}
+
+void CsvWriter::WriteField( double number )
+{
+    StartField();
+    buffer.append( QByteArray::number( number, 'g', 15 ) );
+}
+
+void CsvWriter::AppendUtf8( QString const & text )
+{
+    // ASCII needs no encoding step, which saves a temporary per field
+    for( QChar const c : text ){
+        if( c.unicode() >= 0x80 ){
+            buffer.append( text.toUtf8() );
+            return;
+        }
+    }
+    int const old_size = buffer.size();
+    buffer.resize( old_size + text.size() );
+    char *out = buffer.data() + old_size;
+    for( QChar const c : text ){
+        *out++ = static_cast<char>( c.unicode() );
+    }
+}
+
+void CsvWriter::EndRow()
+{
+    buffer.append( "\r\n", 2 );
+    at_row_start = true;
+    if( buffer.size() >= flush_threshold ) Flush();
+}
+
+bool CsvWriter::Flush()
+{
+    if( !buffer.isEmpty() && !has_failed ){
+        has_failed = ( device->write( buffer ) != buffer.size() );
+    }
+    buffer.resize( 0 ); // keeps the reserved capacity
+    return !has_failed;
+}
+
+ReportExporter & ReportExporter::Instance()
+{
+    // lives as long as the application, so export threads can always signal through it
+    static ReportExporter *exporter = new ReportExporter( qApp );
+    return *exporter;
+}
+
+ReportExporter::ReportExporter( QObject *parent ): QObject( parent ), last_export_id{ 0 }
+{
+    // every export holds a pooled connection for as long as it runs
+    export_threads.setMaxThreadCount( MAX_CONCURRENT_EXPORTS );
+}
+
+ReportExporter::~ReportExporter()
+{
+    // running jobs stop at their next check
+    {
+        QMutexLocker lock{ &mutex };
+        jobs.clear();
+    }
+    export_threads.waitForDone();
+    QMutexLocker lock{ &mutex };
+    while( !killing.isEmpty() ) kill_done.wait( &mutex );
+}
+
+quint64 ReportExporter::Start( ReportRequest const & request )
+{
+    quint64 export_id = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        export_id = ++last_export_id;
+        Job job {};
+        job.filename = request.filename;
+        jobs.insert( export_id, job );
+    }
+    QtConcurrent::run( &export_threads, [this, export_id, request]{
+        ConnectionPool & pool = ConnectionPool::Instance();
+        QueryResult<qint64> result {};
+        {
+            QSqlDatabase database = pool.Acquire();
+            if( database.isOpen() ){
+                result = RunJob( database, export_id, request );
+            } else {
+                result.error = database.lastError().text();
+            }
+        }
+        pool.Release();
+        // the result is handed over on the GUI thread, the exporter outlives its threads
+        QMetaObject::invokeMethod( this, [this, export_id, result]{
+            FinishJob( export_id, result );
+        }, Qt::QueuedConnection );
+    });
+    return export_id;
+}
+
+void ReportExporter::Cancel( quint64 export_id )
+{
+    qint64 connection_id = 0;
+    {
+        QMutexLocker lock{ &mutex };
+        if( !jobs.contains( export_id ) ) return;
+        connection_id = jobs.take( export_id ).connection_id;
+        if( connection_id != 0 ) killing.insert( export_id );
+    }
+    // the job stops at its next check and never reports back, a statement it still has running
+    // on the server is killed
+    if( connection_id != 0 ) KillQuery( export_id, connection_id );
+    emit finished( export_id, false, tr( "Report cancelled" ) );
+}
+
+void ReportExporter::Detach( quint64 export_id )
+{
+    QMutexLocker lock{ &mutex };
+    auto iter = jobs.find( export_id );
+    if( iter != jobs.end() ) iter->detached = true;
+}
+
+bool ReportExporter::IsRunning( quint64 export_id ) const
+{
+    QMutexLocker lock{ &mutex };
+    return jobs.contains( export_id );
+}
+
+bool ReportExporter::IsCancelled( quint64 export_id ) const
+{
+    QMutexLocker lock{ &mutex };
+    return export_id != 0 && !jobs.contains( export_id );
+}
+
+void ReportExporter::KillQuery( quint64 export_id, qint64 connection_id )
+{
+    // the job's own connection is busy running the statement, the kill needs a connection of its own
+    QtConcurrent::run( [this, export_id, connection_id]{
+        ConnectionPool & pool = ConnectionPool::Instance();
+        {
+            QSqlDatabase database = pool.Acquire();
+            QSqlQuery kill_query{ database };
+            QString const sql = QString( "KILL QUERY %1" ).arg( connection_id );
+            if( !QueryTracer::Instance().Exec( "kill_query", kill_query, sql ) ){
+                qDebug() << kill_query.lastError();
+            }
+        }
+        pool.Release();
+
+        QMutexLocker lock{ &mutex };
+        killing.remove( export_id );
+        kill_done.wakeAll();
+    });
+}
+
+void ReportExporter::ForgetConnection( quint64 export_id )
+{
+    // the job is done with the server. A kill still on its way has to land before the connection
+    // runs anything else, or it would hit whatever runs next.
+    QMutexLocker lock{ &mutex };
+    while( killing.contains( export_id ) ) kill_done.wait( &mutex );
+    auto iter = jobs.find( export_id );
+    if( iter != jobs.end() ) iter->connection_id = 0;
+}
+
+QueryResult<qint64> ReportExporter::RunJob( QSqlDatabase & database, quint64 export_id,
+                                            ReportRequest const & request )
+{
+    QueryResult<qint64> result {};
+    // without a server to kill the statement on, a cancelled job stops at its next check
+    qint64 connection_id = 0;
+    QSqlQuery id_query{ database };
+    if( StorageBackend::Current().CanKillQueries() &&
+            QueryTracer::Instance().Exec( "select_connection_id", id_query, "SELECT CONNECTION_ID()" ) && id_query.next() ){
+        connection_id = id_query.value( 0 ).toLongLong();
+    }
+    {
+        QMutexLocker lock{ &mutex };
+        auto iter = jobs.find( export_id );
+        if( iter == jobs.end() ) return result; // cancelled while queued
+        iter->connection_id = connection_id;
+    }
+
+    // a prepared statement would be buffered whole by QMYSQL, the values are formatted in instead
+    QSqlQuery export_query{ database };
+    export_query.setForwardOnly( true );
+    if( !QueryTracer::Instance().Exec( StatementCache::Name( request.statement ), export_query,
+                                       StatementCache::InlineSql( database, request.statement, request.values ) ) ){
+        ForgetConnection( export_id );
+        result.error = export_query.lastError().text();
+        return result;
+    }
+    if( request.format == ReportFormatType::CSV ){
+        result = WriteCsv( export_query, request.filename, export_id );
+    } else {
+        result = WritePdf( export_query, request.title, request.filename, export_id );
+    }
+    ForgetConnection( export_id );
+    return result;
+}
+
+void ReportExporter::FinishJob( quint64 export_id, QueryResult<qint64> const & result )
+{
+    Job job {};
+    {
+        QMutexLocker lock{ &mutex };
+        if( !jobs.contains( export_id ) ) return; // cancelled, already reported
+        job = jobs.take( export_id );
+    }
+
+    QString message {};
+    if( !result.ok ){
+        message = tr( "Unable to generate report from the database:\n%1" ).arg( result.error );
+    } else if( result.value == 0 ){
+        message = tr( "There's nothing to report at the moment" );
+    } else {
+        message = tr( "Report has been generated successfully into %1" ).arg( job.filename );
+    }
+    emit finished( export_id, result.ok, message );
+    if( job.detached ) emit backgroundJobFinished( export_id, result.ok, message );
+}
+
+QueryResult<qint64> ReportExporter::WriteCsv( QSqlQuery & query, QString const & filename, quint64 export_id )
+{
+    QueryResult<qint64> result {};
+    // nothing is left behind on failure or cancellation, the file only appears once complete
+    QSaveFile file{ filename };
+    if( !file.open( QIODevice::WriteOnly ) ){
+        result.error = file.errorString();
+        return result;
+    }
+
+    CsvWriter writer{ &file };
+    for( QString const & header : { "book_title", "author_name", "stock", "date_performed", "transaction_type" } ){
+        writer.WriteField( header );
+    }
+    writer.EndRow();
+
+    // column ordinals are resolved once, rows are then read positionally
+    QSqlRecord const record = query.record();
+    int const title = record.indexOf( "book_title" ), author = record.indexOf( "author_name" ),
+            stock = record.indexOf( "stock" ), date_performed = record.indexOf( "date_performed" ),
+            transaction_type = record.indexOf( "transaction_type" );
+
+    QElapsedTimer elapsed {}, since_progress {};
+    elapsed.start();
+    since_progress.start();
+    qint64 rows = 0;
+    while( query.next() ){
+        writer.WriteField( query.value( title ).toString() );
+        writer.WriteField( query.value( author ).toString() );
+        writer.WriteField( query.value( stock ).toLongLong() );
+        writer.WriteField( query.value( date_performed ).toDateTime().toString() );
+        writer.WriteField( Stringify( static_cast<ReportActionType>( query.value( transaction_type ).toInt() ) ) );
+        writer.EndRow();
+        ++rows;
+
+        if( since_progress.elapsed() >= PROGRESS_INTERVAL_MS ){
+            if( IsCancelled( export_id ) ){
+                file.cancelWriting();
+                result.error = "Export cancelled";
+                return result;
+            }
+            emit progress( export_id, rows, -1, rows * 1000.0 / qMax<qint64>( 1, elapsed.elapsed() ) );
+            since_progress.restart();
+        }
+    }
+    QueryTracer::Instance().Fetched( rows, 0, elapsed.nsecsElapsed() / 1000 );
+    if( query.lastError().isValid() ){
+        result.error = query.lastError().text();
+        file.cancelWriting();
+        return result;
+    }
+    if( !writer.Flush() || !file.commit() ){
+        result.error = file.errorString();
+        return result;
+    }
+    emit progress( export_id, rows, rows, rows * 1000.0 / qMax<qint64>( 1, elapsed.elapsed() ) );
+    result.ok = true;
+    result.value = rows;
+    return result;
+}
+
+QueryResult<qint64> ReportExporter::WritePdf( QSqlQuery & query, QString const & title,
+                                              QString const & filename, quint64 export_id )
+{
+    QueryResult<qint64> result {};
+    QElapsedTimer elapsed {}, since_progress {};
+    elapsed.start();
+    since_progress.start();
+
+    // rows are decoded as the renderer asks for them, only the pages being laid out are in memory
+    RowDecoder<ReportFormat> const decoder{ query };
+    PdfReportRenderer renderer{ title };
+    qint64 const rows = renderer.Render( [&]( ReportFormat & row ){
+        if( !query.next() ) return false;
+        decoder.Decode( query, row );
+        return true;
+    }, filename, [&]( qint64 rows_done ){
+        if( IsCancelled( export_id ) ) return false;
+        if( since_progress.elapsed() >= PROGRESS_INTERVAL_MS ){
+            emit progress( export_id, rows_done, -1, rows_done * 1000.0 / qMax<qint64>( 1, elapsed.elapsed() ) );
+            since_progress.restart();
+        }
+        return true;
+    });
+    if( rows < 0 ){
+        result.error = renderer.ErrorString();
+        return result;
+    }
+    QueryTracer::Instance().Fetched( rows, 0, elapsed.nsecsElapsed() / 1000 );
+    if( query.lastError().isValid() ){
+        QFile::remove( filename );
+        result.error = query.lastError().text();
+        return result;
+    }
+    emit progress( export_id, rows, rows, rows * 1000.0 / qMax<qint64>( 1, elapsed.elapsed() ) );
+    result.ok = true;
+    result.value = rows;
+    return result;
+}
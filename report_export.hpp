@@ -0,0 +1,111 @@
+#ifndef REPORT_EXPORT_HPP
+#define REPORT_EXPORT_HPP
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include "db_executor.hpp"
+#include "resources.hpp"
+#include "statement_cache.hpp"
+
+class QIODevice;
+class QSqlQuery;
+
+// RFC 4180 CSV through a large write buffer: fields are quoted only when they contain a comma,
+// a quote or a line break, quotes are doubled and rows end in CRLF.
+class CsvWriter
+{
+public:
+    explicit CsvWriter( QIODevice *device, int buffer_size = BUFFER_SIZE );
+    ~CsvWriter();
+
+    void WriteField( QString const & field );
+    void WriteField( qint64 number );
+    void WriteField( double number );
+    void EndRow();
+    bool Flush(); // false if the device refused the data
+
+    static int const BUFFER_SIZE;
+private:
+    void StartField();
+    void AppendUtf8( QString const & text );
+private:
+    QIODevice  *device;
+    QByteArray buffer;
+    int        flush_threshold;
+    bool       at_row_start;
+    bool       has_failed;
+};
+
+struct ReportRequest
+{
+    ReportFormatType        format;
+    QString                 filename;
+    QString                 title;
+    StatementId             statement;
+    QMap<QString, QVariant> values; // bound to the statement's placeholders
+};
+
+// runs report jobs on threads of their own, each with its own pooled connection, so a long report
+// never holds up the DatabaseExecutor. CSV and PDF are both written straight from a forward-only
+// query, so memory use does not depend on the number of rows. A job belongs to the exporter rather
+// than the dialog that started it, so it keeps running when that dialog closes.
+class ReportExporter : public QObject
+{
+    Q_OBJECT
+public:
+    static ReportExporter & Instance();
+    ~ReportExporter();
+
+    quint64 Start( ReportRequest const & request ); // returns the job's export id
+    // stops the job locally and kills its statement on the server. The job does not run anything
+    // else on its connection before the kill is through, so the kill cannot hit another statement.
+    void Cancel( quint64 export_id );
+    // nobody is watching the job anymore, its completion is announced through backgroundJobFinished
+    void Detach( quint64 export_id );
+    bool IsRunning( quint64 export_id ) const;
+
+    // run on an export thread and return the number of rows written. They stop early( and write
+    // nothing ) once the job is cancelled, export id 0 writes outside of any job and runs to the end.
+    QueryResult<qint64> WriteCsv( QSqlQuery & query, QString const & filename, quint64 export_id );
+    QueryResult<qint64> WritePdf( QSqlQuery & query, QString const & title, QString const & filename,
+                                  quint64 export_id );
+
+    static int const PROGRESS_INTERVAL_MS;
+    static int const MAX_CONCURRENT_EXPORTS;
+signals:
+    // `total` is -1 while the number of rows is unknown
+    void progress( quint64 export_id, qint64 rows, qint64 total, double rows_per_second );
+    void finished( quint64 export_id, bool ok, QString const & message );
+    void backgroundJobFinished( quint64 export_id, bool ok, QString const & message );
+private:
+    struct Job
+    {
+        QString filename;
+        qint64  connection_id = 0; // server side id of the connection running the job, 0 until known
+        bool    detached = false;
+    };
+
+    explicit ReportExporter( QObject *parent = nullptr );
+    QueryResult<qint64> RunJob( QSqlDatabase & database, quint64 export_id, ReportRequest const & request );
+    void FinishJob( quint64 export_id, QueryResult<qint64> const & result );
+    bool IsCancelled( quint64 export_id ) const;
+    // waits for a kill of the job's statement that is still on its way
+    void ForgetConnection( quint64 export_id );
+    void KillQuery( quint64 export_id, qint64 connection_id );
+private:
+    mutable QMutex      mutex;
+    QWaitCondition      kill_done;
+    QHash<quint64, Job> jobs;
+    QSet<quint64>       killing; // jobs whose statement is being killed
+    quint64             last_export_id;
+    QThreadPool         export_threads;
+};
+
+#endif // REPORT_EXPORT_HPP
@@ -0,0 +1,279 @@
+#include "report_journal.hpp"
+#include "connection_pool.hpp"
+#include "statement_cache.hpp"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+int const ReportJournal::FLUSH_BATCH_SIZE = 50;
+int const ReportJournal::FLUSH_INTERVAL_MS = 2000;
+int const ReportJournal::RETRY_INTERVAL_MS = 5000;
+qint64 const ReportJournal::COMPACT_AFTER_BYTES = 1024 * 1024;
+
+namespace {
+// the offset of the first row that is not committed yet
+qint64 const HEADER_SIZE = sizeof( qint64 );
+
+QDataStream & operator<<( QDataStream & stream, ReportFormat const & report )
+{
+    return stream << report.serial_number << report.quantity << report.price << report.total
+                  << report.book_title << report.author_name << report.date_time_added
+                  << static_cast<int>( report.detail );
+}
+
+QDataStream & operator>>( QDataStream & stream, ReportFormat & report )
+{
+    int detail = 0;
+    stream >> report.serial_number >> report.quantity >> report.price >> report.total
+           >> report.book_title >> report.author_name >> report.date_time_added >> detail;
+    report.detail = static_cast<ReportActionType>( detail );
+    return stream;
+}
+
+// a batch lost halfway with its connection is written again as a whole, the journal keeps it otherwise
+bool WriteBatch( QSqlDatabase & database, QList<ReportFormat> const & batch )
+{
+    StatementCache & statements = StatementCache::ForThread();
+    return statements.Transact( database, [&]{
+        if( !statements.Begin( database ) ) return false;
+        if( !InsertReports( database, batch ) || !statements.Commit( database ) ){
+            statements.Rollback( database );
+            return false;
+        }
+        return true;
+    });
+}
+
+// QFile::flush() only hands the rows to the OS, a power cut could still take them
+bool SyncToDisk( QFile & file )
+{
+    if( !file.flush() ) return false;
+#ifdef Q_OS_WIN
+    return _commit( file.handle() ) == 0;
+#else
+    return fsync( file.handle() ) == 0;
+#endif
+}
+
+QString JournalPath()
+{
+    QString const directory = QStandardPaths::writableLocation( QStandardPaths::AppDataLocation );
+    QDir().mkpath( directory );
+    return directory + "/report_journal.dat";
+}
+}
+
+ReportJournal & ReportJournal::Instance()
+{
+    // owned by the application object, so the last batch is flushed before the process exits. Made
+    // after the DatabaseExecutor( see main() ), so it is deleted after the executor's worker is joined
+    static ReportJournal *journal = new ReportJournal( qApp );
+    return *journal;
+}
+
+ReportJournal::ReportJournal( QObject *parent ): QObject( parent ),
+    journal_file{ JournalPath() }, stopping{ false }, worker_thread( new QThread( this ) )
+{
+    Q_ASSERT( QThread::currentThread() == qApp->thread() );
+    // not opened for appending, the header is written in place
+    if( !journal_file.open( QIODevice::ReadWrite ) ){
+        qDebug() << "Unable to open the report journal" << journal_file.fileName();
+    }
+    LoadJournal();
+
+    JournalWorker *worker = new JournalWorker( this );
+    worker->moveToThread( worker_thread );
+    QObject::connect( worker_thread, SIGNAL(started()), worker, SLOT(onThreadStarted()) );
+    QObject::connect( worker, SIGNAL(finished()), worker_thread, SLOT(quit()), Qt::DirectConnection );
+    QObject::connect( worker_thread, SIGNAL(finished()), worker, SLOT(deleteLater()) );
+}
+
+ReportJournal::~ReportJournal()
+{
+    {
+        QMutexLocker lock{ &mutex };
+        stopping = true;
+        rows_available.wakeAll();
+    }
+    worker_thread->wait();
+}
+
+void ReportJournal::Start()
+{
+    if( !worker_thread->isRunning() ) worker_thread->start();
+}
+
+void ReportJournal::Append( ReportFormat const & report )
+{
+    Append( QList<ReportFormat>{ report } );
+}
+
+void ReportJournal::Append( QList<ReportFormat> const & reports )
+{
+    if( reports.isEmpty() ) return;
+
+    QMutexLocker lock{ &mutex };
+    journal_file.seek( journal_file.size() );
+    QDataStream stream{ &journal_file };
+    stream.setVersion( QDataStream::Qt_5_0 );
+    for( ReportFormat const & report : reports ){
+        stream << report;
+        pending_ends.append( journal_file.pos() );
+    }
+    SyncToDisk( journal_file );
+
+    bool const was_empty = pending.isEmpty();
+    pending.append( reports );
+    // the first row starts the flush timer, a full batch cuts it short
+    if( was_empty || pending.size() >= FLUSH_BATCH_SIZE ) rows_available.wakeOne();
+}
+
+int ReportJournal::PendingCount() const
+{
+    QMutexLocker lock{ &mutex };
+    return pending.size();
+}
+
+bool ReportJournal::WaitForBatch( QList<ReportFormat> & batch, bool last_flush_failed )
+{
+    QMutexLocker lock{ &mutex };
+    while( !stopping && pending.isEmpty() ){
+        rows_available.wait( &mutex );
+    }
+    // a batch is due once it is full or its oldest row has waited long enough, after a failure
+    // the database gets some time to come back
+    QElapsedTimer waited {};
+    waited.start();
+    int const interval = last_flush_failed ? RETRY_INTERVAL_MS : FLUSH_INTERVAL_MS;
+    while( !stopping && ( last_flush_failed || pending.size() < FLUSH_BATCH_SIZE ) ){
+        qint64 const remaining = interval - waited.elapsed();
+        if( remaining <= 0 ) break;
+        rows_available.wait( &mutex, static_cast<unsigned long>( remaining ) );
+    }
+    batch = pending.mid( 0, FLUSH_BATCH_SIZE );
+    // when stopping, whatever is left is flushed until an attempt fails, the rest is replayed next start
+    if( stopping ) return !batch.isEmpty() && !last_flush_failed;
+    return true;
+}
+
+void ReportJournal::BatchCommitted( int count )
+{
+    QMutexLocker lock{ &mutex };
+    qint64 const committed_offset = pending_ends.at( count - 1 );
+    pending.erase( pending.begin(), pending.begin() + count );
+    pending_ends.erase( pending_ends.begin(), pending_ends.begin() + count );
+    if( pending.isEmpty() ){
+        // truncated first, a header past the end of the file means every row was committed
+        journal_file.resize( HEADER_SIZE );
+        WriteHeader( HEADER_SIZE );
+    } else if( committed_offset >= COMPACT_AFTER_BYTES ){
+        CompactJournal( committed_offset );
+    } else {
+        WriteHeader( committed_offset );
+    }
+}
+
+void ReportJournal::LoadJournal()
+{
+    if( !journal_file.isOpen() ) return;
+
+    QDataStream stream{ &journal_file };
+    stream.setVersion( QDataStream::Qt_5_0 );
+    qint64 const size = journal_file.size();
+    qint64 committed_offset = 0;
+    if( size >= HEADER_SIZE ) stream >> committed_offset;
+    if( size < HEADER_SIZE || committed_offset > size ){
+        journal_file.resize( 0 );
+        WriteHeader( HEADER_SIZE );
+        return;
+    }
+
+    qint64 end = qMax( committed_offset, HEADER_SIZE );
+    journal_file.seek( end );
+    while( !stream.atEnd() ){
+        ReportFormat report {};
+        stream >> report;
+        if( stream.status() != QDataStream::Ok ) break; // torn write at the end of the file
+        end = journal_file.pos();
+        pending.append( report );
+        pending_ends.append( end );
+    }
+    // new rows go right after the last whole one
+    if( end < size ) journal_file.resize( end );
+    if( !pending.isEmpty() ) qDebug() << "Replaying" << pending.size() << "journaled reports";
+}
+
+bool ReportJournal::WriteHeader( qint64 committed_offset )
+{
+    journal_file.seek( 0 );
+    QDataStream stream{ &journal_file };
+    stream << committed_offset;
+    return SyncToDisk( journal_file );
+}
+
+void ReportJournal::CompactJournal( qint64 committed_offset )
+{
+    // the rows that are not committed yet replace the journal in a single rename, if that fails
+    // the journal just grows for a while longer
+    QSaveFile compacted{ journal_file.fileName() };
+    QList<qint64> compacted_ends {};
+    bool is_compacted = compacted.open( QIODevice::WriteOnly );
+    if( is_compacted ){
+        QDataStream stream{ &compacted };
+        stream.setVersion( QDataStream::Qt_5_0 );
+        stream << HEADER_SIZE;
+        for( ReportFormat const & report : pending ){
+            stream << report;
+            compacted_ends.append( compacted.pos() );
+        }
+        // the journal is closed for the rename, Windows does not replace open files
+        journal_file.close();
+        is_compacted = compacted.commit();
+    }
+    if( !journal_file.isOpen() && !journal_file.open( QIODevice::ReadWrite ) ){
+        qDebug() << "Unable to reopen the report journal" << journal_file.fileName();
+    }
+    if( is_compacted ){
+        pending_ends = compacted_ends;
+    } else {
+        WriteHeader( committed_offset );
+    }
+}
+
+JournalWorker::JournalWorker( ReportJournal *report_journal, QObject *parent ):
+    QObject( parent ), journal{ report_journal }
+{
+}
+
+void JournalWorker::onThreadStarted()
+{
+    ConnectionPool & pool = ConnectionPool::Instance();
+    QList<ReportFormat> batch {};
+    bool last_flush_failed = false;
+    while( journal->WaitForBatch( batch, last_flush_failed ) ){
+        if( batch.isEmpty() ) continue;
+
+        QSqlDatabase database = pool.Acquire();
+        last_flush_failed = !WriteBatch( database, batch );
+        if( last_flush_failed ){
+            qDebug() << "Reports kept in the journal, the database is unavailable";
+        } else {
+            journal->BatchCommitted( batch.size() );
+        }
+    }
+    pool.Release();
+    emit finished();
+}
@@ -0,0 +1,72 @@
+#ifndef REPORT_JOURNAL_HPP
+#define REPORT_JOURNAL_HPP
+
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QWaitCondition>
+#include "resources.hpp"
+
+class QThread;
+
+// audit rows for the reports table. Append() only queues the row and records it in a local journal
+// file, a background thread writes queued rows to the database in multi-row batches once
+// FLUSH_BATCH_SIZE rows are waiting or FLUSH_INTERVAL_MS has passed. Rows stay in the journal until
+// their batch is committed, so they survive the database being unavailable and are replayed on the
+// next start( at-least-once: a crash right after a commit may write that batch twice ).
+// The journal is append-only, its header holds the offset of the first row not yet committed. It is
+// truncated once every row is committed and compacted once the committed part grows too large.
+class ReportJournal : public QObject
+{
+    Q_OBJECT
+public:
+    // created on the GUI thread before any other thread appends, see main()
+    static ReportJournal & Instance();
+    ~ReportJournal();
+
+    // starts writing to the database, which must have the reports table by now
+    void Start();
+    // thread safe and never touches the database
+    void Append( ReportFormat const & report );
+    void Append( QList<ReportFormat> const & reports );
+    int  PendingCount() const;
+
+    static int const FLUSH_BATCH_SIZE;
+    static int const FLUSH_INTERVAL_MS;
+    static int const RETRY_INTERVAL_MS;
+    static qint64 const COMPACT_AFTER_BYTES;
+private:
+    friend class JournalWorker;
+
+    explicit ReportJournal( QObject *parent = nullptr );
+    bool WaitForBatch( QList<ReportFormat> & batch, bool last_flush_failed ); // false when stopping
+    void BatchCommitted( int count );
+    void LoadJournal();
+    // mutex must be held for these
+    bool WriteHeader( qint64 committed_offset );
+    void CompactJournal( qint64 committed_offset );
+private:
+    mutable QMutex      mutex;
+    QWaitCondition      rows_available;
+    QList<ReportFormat> pending; // oldest first, the head may be in flight
+    QList<qint64>       pending_ends; // where each pending row ends in the journal file
+    QFile               journal_file;
+    bool                stopping;
+    QThread             *worker_thread;
+};
+
+class JournalWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit JournalWorker( ReportJournal *journal, QObject *parent = nullptr );
+public slots:
+    void onThreadStarted();
+signals:
+    void finished();
+private:
+    ReportJournal *journal;
+};
+
+#endif // REPORT_JOURNAL_HPP
@@ -4,10 +4,14 @@
 #include <QByteArray>
 #include <QString>
 #include <QDateTime>
+#include <QSqlDatabase>
 #include <QSqlRecord>
 #include <QSqlQuery>
 #include <QList>
+#include <QMetaType>
 #include <QVariant>
+#include <tuple>
+#include "schema.hpp"
 
 enum class ReportActionType {
     ALL = 0,
@@ -27,7 +31,24 @@ struct DatabaseRecordFormat
     QString         publisher;
     QDateTime       date_time_added;
     QString         location; // where in the "inventory" it is physically located.
-    QByteArray      book_cover; // could be BLOB data or NULL
+    unsigned int    low_stock_threshold; // the user is alerted once the stock falls below this
+    QString         cover_hash; // SHA-256 of the cover in the CoverStore, empty if there's none
+};
+
+Q_DECLARE_METATYPE( DatabaseRecordFormat )
+
+enum class ReportFormatType {
+    PDF = 0,
+    CSV,
+    INVALID
+};
+
+// granularity a report is generated at, anything coarser than single transactions is served from
+// the report_daily_rollups table instead of scanning reports
+enum class ReportGranularity {
+    Transactions = 0,
+    Daily,
+    Monthly
 };
 
 struct ReportFormat
@@ -42,52 +63,80 @@ struct ReportFormat
     ReportActionType    detail;
 };
 
+template<>
+struct TableSchema<DatabaseRecordFormat>
+{
+    static constexpr char const *table = "inventory";
+    static constexpr auto columns = std::make_tuple(
+            MakeColumn( "serial_number", &DatabaseRecordFormat::serial_number, PrimaryKey ),
+            MakeColumn( "stock", &DatabaseRecordFormat::quantity ),
+            MakeColumn( "price", &DatabaseRecordFormat::price ),
+            MakeColumn( "book_title", &DatabaseRecordFormat::book_title ),
+            MakeColumn( "author_name", &DatabaseRecordFormat::author_name ),
+            MakeColumn( "publisher", &DatabaseRecordFormat::publisher ),
+            MakeColumn( "date_time", &DatabaseRecordFormat::date_time_added ),
+            MakeColumn( "location", &DatabaseRecordFormat::location ),
+            MakeColumn( "low_stock_threshold", &DatabaseRecordFormat::low_stock_threshold ),
+            MakeColumn( "cover_hash", &DatabaseRecordFormat::cover_hash ) );
+};
+
+template<>
+struct TableSchema<ReportFormat>
+{
+    static constexpr char const *table = "reports";
+    static constexpr auto columns = std::make_tuple(
+            MakeColumn( "serial_number", &ReportFormat::serial_number, PrimaryKey ),
+            MakeColumn( "stock", &ReportFormat::quantity ),
+            MakeColumn( "price", &ReportFormat::price ),
+            MakeColumn( "total", &ReportFormat::total ),
+            MakeColumn( "book_title", &ReportFormat::book_title ),
+            MakeColumn( "author_name", &ReportFormat::author_name ),
+            MakeColumn( "date_performed", &ReportFormat::date_time_added ),
+            MakeColumn( "transaction_type", &ReportFormat::detail ) );
+};
+
+// per-day, per-type, per-title totals of the reports table, kept up to date by InsertReports
+struct DailyRollup
+{
+    QDate               day;
+    ReportActionType    detail;
+    QString             book_title;
+    QString             author_name;
+    qint64              quantity;
+    double              total;
+    int                 transactions;
+};
+
+template<>
+struct TableSchema<DailyRollup>
+{
+    static constexpr char const *table = "report_daily_rollups";
+    static constexpr auto columns = std::make_tuple(
+            MakeColumn( "day", &DailyRollup::day ),
+            MakeColumn( "transaction_type", &DailyRollup::detail ),
+            MakeColumn( "book_title", &DailyRollup::book_title ),
+            MakeColumn( "author_name", &DailyRollup::author_name ),
+            MakeColumn( "quantity", &DailyRollup::quantity ),
+            MakeColumn( "total", &DailyRollup::total ),
+            MakeColumn( "transactions", &DailyRollup::transactions ) );
+};
+
+// titles and authors are part of the rollup key, which MySQL limits in length
+static int const ROLLUP_KEY_LENGTH = 191;
+
 static void FillRecordFromQuery( QList<DatabaseRecordFormat> &list, QSqlQuery &query)
 {
-    QSqlRecord record {};
-    while( query.next() ){
-        record = query.record();
-        bool const has_cover = record.contains( "book_cover" );
-        DatabaseRecordFormat data =
-        {
-            record.value( "serial_number" ).toInt(), // serial number
-            record.value( "stock" ).toInt(), // stock number
-            record.value( "price" ).toDouble(),
-            record.value( "book_title" ).toString(), // book's title
-            record.value( "author_name" ).toString(), // author's name
-            record.value( "publisher" ).toString(), // publisher
-            record.value( "date_time").toDateTime(), // date time
-            record.value( "location" ).toString(), // location
-            has_cover == true ? record.value( "book_cover" ).toByteArray() : QByteArray() // cover page
-        };
-        list.append( data );
-    }
+    FillFromQuery( list, query );
 }
 static void FillReportFromQuery( QList<ReportFormat> &data_list, QSqlQuery &query )
 {
-    QSqlRecord record {};
-    while( query.next() ){
-        record = query.record();
-        ReportFormat data = {
-            record.value( "serial_number" ).toInt(), // serial number
-            record.value( "stock" ).toInt(), // stock number
-            record.value( "price" ).toDouble(),
-            record.value( "total" ).toDouble(),
-            record.value( "book_title" ).toString(), // book's title
-            record.value( "author_name" ).toString(), // author's name
-            record.value( "date_performed").toDateTime(), // date time
-            static_cast<ReportActionType>( record.value( "transaction_type" ).toInt() ), // location
-        };
-        data_list.append( data );
-    }
+    FillFromQuery( data_list, query );
 }
 
-static QString GetDateTime( QDateTime const & date_time )
-{
-    QString date_string = date_time.date().toString( "yyyy-MM-dd"),
-            time_string = date_time.time().toString("HH-mm-ss");
-    return date_string + " " + time_string;
-}
+// writes `reports` with as few round-trips as possible, a few multi-row INSERTs, and folds them
+// into the daily rollups. Meant to run inside a transaction, so the rollups never
+// disagree with the rows they summarise. Defined in statement_cache.cpp
+bool InsertReports( QSqlDatabase & database, QList<ReportFormat> const & reports );
 
 static QString Stringify( ReportActionType type )
 {
@@ -0,0 +1,299 @@
+#ifndef SCHEMA_HPP
+#define SCHEMA_HPP
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVariant>
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "query_tracer.hpp"
+
+// compile-time description of how a C++ record maps onto the columns of a table. Every record
+// that is read from or written to the database specialises TableSchema (see resources.hpp) and
+// the decoders and statement generators below are derived from that one description.
+
+enum ColumnFlag {
+    NoFlag      = 0x0,
+    PrimaryKey  = 0x1, // generated by the database, never bound on INSERT
+    LargeObject = 0x2  // BLOBs, fetched on demand and never part of list queries
+};
+
+template<typename Record, typename Field>
+struct Column
+{
+    char const      *name;
+    Field Record::* member;
+    int             flags;
+};
+
+template<typename Record, typename Field>
+constexpr Column<Record, Field> MakeColumn( char const *name, Field Record::*member, int flags = NoFlag )
+{
+    return Column<Record, Field>{ name, member, flags };
+}
+
+template<typename Record>
+struct TableSchema; // specialised for every record, provides `table` and `columns`
+
+template<typename T, typename = void>
+struct ColumnTraits
+{
+    static T FromVariant( QVariant const & value ){ return value.value<T>(); }
+    static QVariant ToVariant( T const & value ){ return QVariant::fromValue( value ); }
+};
+
+// enumerations are stored as plain integers in the database
+template<typename T>
+struct ColumnTraits<T, std::enable_if_t<std::is_enum<T>::value>>
+{
+    static T FromVariant( QVariant const & value ){ return static_cast<T>( value.toInt() ); }
+    static QVariant ToVariant( T const & value ){ return static_cast<int>( value ); }
+};
+
+namespace detail {
+template<typename Tuple, typename Func, std::size_t... Index>
+void ForEachColumnImpl( Tuple const & columns, Func && func, std::index_sequence<Index...> )
+{
+    ( func( std::get<Index>( columns ), Index ), ... );
+}
+}
+
+template<typename Record>
+constexpr std::size_t ColumnCount()
+{
+    return std::tuple_size<std::decay_t<decltype( TableSchema<Record>::columns )>>::value;
+}
+
+// calls func( column, index ) for every column of Record's schema, in declaration order
+template<typename Record, typename Func>
+void ForEachColumn( Func && func )
+{
+    detail::ForEachColumnImpl( TableSchema<Record>::columns, std::forward<Func>( func ),
+                               std::make_index_sequence<ColumnCount<Record>()>{} );
+}
+
+// resolves the ordinal of every column once per result set, rows are then decoded positionally
+// without copying the QSqlRecord or looking columns up by name. Columns missing from the
+// result set are left value-initialized.
+template<typename Record>
+class RowDecoder
+{
+public:
+    explicit RowDecoder( QSqlQuery const & query )
+    {
+        QSqlRecord const record = query.record();
+        ForEachColumn<Record>( [&]( auto const & column, std::size_t index ){
+            ordinals[index] = record.indexOf( column.name );
+        });
+    }
+
+    void Decode( QSqlQuery const & query, Record & data ) const
+    {
+        ForEachColumn<Record>( [&]( auto const & column, std::size_t index ){
+            if( ordinals[index] < 0 ) return;
+            using Field = std::decay_t<decltype( data.*( column.member ) )>;
+            data.*( column.member ) = ColumnTraits<Field>::FromVariant( query.value( ordinals[index] ) );
+        });
+    }
+private:
+    std::array<int, ColumnCount<Record>()> ordinals;
+};
+
+// what a decoded value occupies, strings and byte arrays by their contents
+inline qint64 FieldBytes( QString const & value ){ return value.size() * qint64( sizeof( QChar ) ); }
+inline qint64 FieldBytes( QByteArray const & value ){ return value.size(); }
+template<typename T>
+qint64 FieldBytes( T const & ){ return sizeof( T ); }
+
+// FillFromQuery measures one row in this many and extrapolates, the sizes are only reported
+int const DECODED_BYTES_SAMPLE_ROWS = 16;
+
+template<typename Record>
+qint64 DecodedBytes( Record const & data )
+{
+    qint64 bytes = 0;
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t ){
+        bytes += FieldBytes( data.*( column.member ) );
+    });
+    return bytes;
+}
+
+// the query should have been made forward-only before it was executed. The rows, their size( from
+// a sample of them ) and the time spent decoding them are reported to the QueryTracer
+template<typename Record>
+void FillFromQuery( QList<Record> & list, QSqlQuery & query )
+{
+    QElapsedTimer elapsed {};
+    elapsed.start();
+    int const size = query.size(); // -1 if the driver cannot tell
+    if( size > 0 ) list.reserve( list.size() + size );
+
+    qint64 rows = 0, sampled_rows = 0, sampled_bytes = 0;
+    RowDecoder<Record> const decoder{ query };
+    while( query.next() ){
+        list.append( Record{} );
+        decoder.Decode( query, list.last() );
+        if( rows % DECODED_BYTES_SAMPLE_ROWS == 0 ){
+            sampled_bytes += DecodedBytes( list.last() );
+            ++sampled_rows;
+        }
+        ++rows;
+    }
+    qint64 const bytes = sampled_rows == 0 ? 0 : sampled_bytes * rows / sampled_rows;
+    QueryTracer::Instance().Fetched( rows, bytes, elapsed.nsecsElapsed() / 1000 );
+}
+
+// comma separated column list for SELECTs, e.g. SelectColumns<Record>( LargeObject ) leaves out BLOBs
+template<typename Record>
+QString SelectColumns( int skip = NoFlag )
+{
+    QStringList names {};
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t ){
+        if( column.flags & skip ) return;
+        names << QString( column.name );
+    });
+    return names.join( ", " );
+}
+
+// INSERT INTO table ( a, b ) VALUES ( :a, :b ), primary keys are left to the database
+template<typename Record>
+QString InsertStatement()
+{
+    QStringList names {}, placeholders {};
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t ){
+        if( column.flags & PrimaryKey ) return;
+        names << QString( column.name );
+        placeholders << ( ":" + QString( column.name ) );
+    });
+    return QString( "INSERT INTO %1 ( %2 ) VALUES ( %3 )" ).arg( QString( TableSchema<Record>::table ) )
+            .arg( names.join( ", " ) ).arg( placeholders.join( ", " ) );
+}
+
+// INSERT INTO table ( a, b ) VALUES ( :a_0, :b_0 ), ( :a_1, :b_1 ), ... for `rows` records in one
+// statement, the values are bound with BindRecordRow
+template<typename Record>
+QString InsertStatement( int rows )
+{
+    QStringList names {}, values {};
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t ){
+        if( column.flags & PrimaryKey ) return;
+        names << QString( column.name );
+    });
+    for( int row = 0; row != rows; ++row ){
+        QStringList placeholders {};
+        for( QString const & name : names ) placeholders << QString( ":%1_%2" ).arg( name ).arg( row );
+        values << ( "( " + placeholders.join( ", " ) + " )" );
+    }
+    return QString( "INSERT INTO %1 ( %2 ) VALUES %3" ).arg( QString( TableSchema<Record>::table ) )
+            .arg( names.join( ", " ) ).arg( values.join( ", " ) );
+}
+
+// UPDATE table SET a = :a, b = :b WHERE key = :key
+template<typename Record>
+QString UpdateStatement()
+{
+    QStringList assignments {};
+    QString condition {};
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t ){
+        QString const name { column.name };
+        if( column.flags & PrimaryKey ){
+            condition = name + " = :" + name;
+        } else {
+            assignments << ( name + " = :" + name );
+        }
+    });
+    return QString( "UPDATE %1 SET %2 WHERE %3" ).arg( QString( TableSchema<Record>::table ) )
+            .arg( assignments.join( ", " ) ).arg( condition );
+}
+
+// one bit per column, in declaration order
+using ColumnMask = quint64;
+
+template<typename Record>
+constexpr ColumnMask ColumnBit( std::size_t index )
+{
+    static_assert( ColumnCount<Record>() <= 64, "ColumnMask has room for 64 columns" );
+    return ColumnMask{ 1 } << index;
+}
+
+// the columns( primary keys aside ) whose values differ between `before` and `after`
+template<typename Record>
+ColumnMask ChangedColumns( Record const & before, Record const & after )
+{
+    ColumnMask changed = 0;
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t index ){
+        if( column.flags & PrimaryKey ) return;
+        if( !( before.*( column.member ) == after.*( column.member ) ) ) changed |= ColumnBit<Record>( index );
+    });
+    return changed;
+}
+
+// copies the columns in `columns` from `source` into `destination`
+template<typename Record>
+void CopyColumns( Record & destination, Record const & source, ColumnMask columns )
+{
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t index ){
+        if( columns & ColumnBit<Record>( index ) ) destination.*( column.member ) = source.*( column.member );
+    });
+}
+
+// UPDATE table SET a = :a WHERE key = :key, for only the columns in `columns`
+template<typename Record>
+QString UpdateStatement( ColumnMask columns )
+{
+    QStringList assignments {};
+    QString condition {};
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t index ){
+        QString const name { column.name };
+        if( column.flags & PrimaryKey ){
+            condition = name + " = :" + name;
+        } else if( columns & ColumnBit<Record>( index ) ){
+            assignments << ( name + " = :" + name );
+        }
+    });
+    return QString( "UPDATE %1 SET %2 WHERE %3" ).arg( QString( TableSchema<Record>::table ) )
+            .arg( assignments.join( ", " ) ).arg( condition );
+}
+
+// binds the primary key and the columns in `columns`, for UpdateStatement( columns )
+template<typename Record>
+void BindColumns( QSqlQuery & query, Record const & data, ColumnMask columns )
+{
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t index ){
+        if( !( column.flags & PrimaryKey ) && !( columns & ColumnBit<Record>( index ) ) ) return;
+        using Field = std::decay_t<decltype( data.*( column.member ) )>;
+        query.bindValue( ":" + QString( column.name ), ColumnTraits<Field>::ToVariant( data.*( column.member ) ) );
+    });
+}
+
+// binds every column of `data` to its ":column_name" placeholder, except the ones flagged in `skip`
+template<typename Record>
+void BindRecord( QSqlQuery & query, Record const & data, int skip = NoFlag )
+{
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t ){
+        if( column.flags & skip ) return;
+        using Field = std::decay_t<decltype( data.*( column.member ) )>;
+        query.bindValue( ":" + QString( column.name ), ColumnTraits<Field>::ToVariant( data.*( column.member ) ) );
+    });
+}
+
+// binds `data` as row `row` of a multi-row InsertStatement
+template<typename Record>
+void BindRecordRow( QSqlQuery & query, Record const & data, int row, int skip = PrimaryKey )
+{
+    QString const suffix = "_" + QString::number( row );
+    ForEachColumn<Record>( [&]( auto const & column, std::size_t ){
+        if( column.flags & skip ) return;
+        using Field = std::decay_t<decltype( data.*( column.member ) )>;
+        query.bindValue( ":" + QString( column.name ) + suffix, ColumnTraits<Field>::ToVariant( data.*( column.member ) ) );
+    });
+}
+
+#endif // SCHEMA_HPP
@@ -0,0 +1,205 @@
+#include "search_index.hpp"
+
+#include <QRegularExpression>
+#include <QSet>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+int const FIELD_WEIGHTS[] = { 3, 2, 1 }; // title, author, publisher
+
+enum MatchKind {
+    NoMatch = 0,
+    Substring,
+    Prefix,
+    WholeWord
+};
+
+struct Rank
+{
+    unsigned int    serial_number;
+    int             matched_terms;
+    int             score;
+};
+}
+
+QStringList SearchIndex::Words( QString const & text )
+{
+    static QRegularExpression const separator{ "\\W+", QRegularExpression::UseUnicodePropertiesOption };
+    return text.toLower().split( separator, Qt::SkipEmptyParts );
+}
+
+QList<quint64> SearchIndex::Trigrams( QString const & word )
+{
+    QList<quint64> keys {};
+    for( int i = 0; i + 3 <= word.size(); ++i ){
+        keys << ( ( quint64( word[i].unicode() ) << 32 ) | ( quint64( word[i + 1].unicode() ) << 16 )
+                  | quint64( word[i + 2].unicode() ) );
+    }
+    return keys;
+}
+
+int SearchIndex::DocumentBytes( QString const & book_title, QString const & author_name,
+                                QString const & publisher )
+{
+    // a QString's shared header and a QHash node, give or take
+    int const STRING_HEADER_BYTES = 24, NODE_BYTES = 32;
+    int bytes = NODE_BYTES + static_cast<int>( sizeof( unsigned int ) + sizeof( Document ) );
+    QSet<QString> unique_words {};
+    for( QString const & text : { book_title, author_name, publisher } ){
+        for( QString const & word : Words( text ) ){
+            bytes += static_cast<int>( sizeof( QString ) ) + STRING_HEADER_BYTES +
+                     word.size() * static_cast<int>( sizeof( QChar ) );
+            unique_words.insert( word );
+        }
+    }
+    for( QString const & word : unique_words ){
+        bytes += static_cast<int>( sizeof( unsigned int ) ) * ( 1 + qMax( 0, word.size() - 2 ) );
+    }
+    return bytes;
+}
+
+void SearchIndex::AddPosting( Postings & postings, unsigned int serial_number )
+{
+    auto iter = std::lower_bound( postings.begin(), postings.end(), serial_number );
+    if( iter == postings.end() || *iter != serial_number ) postings.insert( iter, serial_number );
+}
+
+bool SearchIndex::RemovePosting( Postings & postings, unsigned int serial_number )
+{
+    auto iter = std::lower_bound( postings.begin(), postings.end(), serial_number );
+    if( iter != postings.end() && *iter == serial_number ) postings.erase( iter );
+    return postings.empty();
+}
+
+void SearchIndex::Insert( unsigned int serial_number, QString const & book_title, QString const & author_name,
+                          QString const & publisher )
+{
+    Remove( serial_number );
+
+    Document document {};
+    document.words[Title] = Words( book_title );
+    document.words[Author] = Words( author_name );
+    document.words[Publisher] = Words( publisher );
+
+    QSet<QString> unique_words {};
+    for( QStringList const & field_words : document.words ){
+        for( QString const & word : field_words ) unique_words.insert( word );
+    }
+    QSet<quint64> unique_trigrams {};
+    for( QString const & word : unique_words ){
+        AddPosting( words[word], serial_number );
+        for( quint64 const key : Trigrams( word ) ) unique_trigrams.insert( key );
+    }
+    for( quint64 const key : unique_trigrams ) AddPosting( trigrams[key], serial_number );
+
+    documents.insert( serial_number, document );
+}
+
+void SearchIndex::Remove( unsigned int serial_number )
+{
+    auto document = documents.find( serial_number );
+    if( document == documents.end() ) return;
+
+    for( QStringList const & field_words : document->words ){
+        for( QString const & word : field_words ){
+            auto postings = words.find( word );
+            if( postings != words.end() && RemovePosting( *postings, serial_number ) ) words.erase( postings );
+            for( quint64 const key : Trigrams( word ) ){
+                auto trigram_postings = trigrams.find( key );
+                if( trigram_postings != trigrams.end() && RemovePosting( *trigram_postings, serial_number ) ){
+                    trigrams.erase( trigram_postings );
+                }
+            }
+        }
+    }
+    documents.erase( document );
+}
+
+void SearchIndex::Clear()
+{
+    documents.clear();
+    words.clear();
+    trigrams.clear();
+}
+
+// every book that may match `term`, Score() weeds out the false positives of the trigrams
+SearchIndex::Postings SearchIndex::Candidates( QString const & term ) const
+{
+    Postings candidates {};
+    if( term.size() < 3 ){
+        // too short for a trigram, only word prefixes are looked up
+        for( auto iter = words.lowerBound( term ); iter != words.cend() && iter.key().startsWith( term ); ++iter ){
+            candidates.insert( candidates.end(), iter->cbegin(), iter->cend() );
+        }
+        std::sort( candidates.begin(), candidates.end() );
+        candidates.erase( std::unique( candidates.begin(), candidates.end() ), candidates.end() );
+        return candidates;
+    }
+
+    std::vector<Postings const *> lists {};
+    for( quint64 const key : Trigrams( term ) ){
+        auto postings = trigrams.find( key );
+        if( postings == trigrams.cend() ) return candidates;
+        lists.push_back( &( *postings ) );
+    }
+    // intersect starting with the shortest list
+    std::sort( lists.begin(), lists.end(), []( Postings const *a, Postings const *b ){
+        return a->size() < b->size();
+    });
+    candidates = *lists.front();
+    for( std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i ){
+        Postings intersection {};
+        std::set_intersection( candidates.cbegin(), candidates.cend(), lists[i]->cbegin(), lists[i]->cend(),
+                               std::back_inserter( intersection ) );
+        candidates.swap( intersection );
+    }
+    return candidates;
+}
+
+int SearchIndex::Score( Document const & document, QString const & term ) const
+{
+    int best = 0;
+    for( int field = Title; field != FieldCount; ++field ){
+        for( QString const & word : document.words[field] ){
+            MatchKind const kind = word == term ? WholeWord : word.startsWith( term ) ? Prefix
+                                                : word.contains( term ) ? Substring : NoMatch;
+            best = std::max( best, kind * FIELD_WEIGHTS[field] );
+        }
+    }
+    return best;
+}
+
+QList<unsigned int> SearchIndex::Search( QString const & text, int limit ) const
+{
+    QStringList terms = Words( text );
+    terms.removeDuplicates();
+
+    QHash<unsigned int, Rank> ranks {};
+    for( QString const & term : terms ){
+        for( unsigned int const serial_number : Candidates( term ) ){
+            auto document = documents.constFind( serial_number );
+            if( document == documents.cend() ) continue;
+            int const score = Score( *document, term );
+            if( score == 0 ) continue;
+            Rank & rank = ranks[serial_number];
+            rank.serial_number = serial_number;
+            rank.matched_terms += 1;
+            rank.score += score;
+        }
+    }
+
+    std::vector<Rank> ordered( ranks.cbegin(), ranks.cend() );
+    auto better = []( Rank const & a, Rank const & b ){
+        if( a.matched_terms != b.matched_terms ) return a.matched_terms > b.matched_terms;
+        if( a.score != b.score ) return a.score > b.score;
+        return a.serial_number < b.serial_number;
+    };
+    std::size_t const count = limit > 0 ? std::min<std::size_t>( limit, ordered.size() ) : ordered.size();
+    std::partial_sort( ordered.begin(), ordered.begin() + count, ordered.end(), better );
+
+    QList<unsigned int> results {};
+    results.reserve( static_cast<int>( count ) );
+    for( std::size_t i = 0; i != count; ++i ) results << ordered[i].serial_number;
+    return results;
+}
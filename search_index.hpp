@@ -0,0 +1,53 @@
+#ifndef SEARCH_INDEX_HPP
+#define SEARCH_INDEX_HPP
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+// in-memory full text index over the title, author and publisher of every book. Words are kept in
+// a sorted dictionary for prefix lookups and every word is also broken into trigrams, so a search
+// term matches whole words, word prefixes and substrings of words( given it has three or more
+// characters ). Results are ranked by how many of the terms they match, then by how well: whole
+// words over prefixes over substrings, titles over authors over publishers.
+// Not thread safe, the owner( see InventoryCache ) serializes access.
+class SearchIndex
+{
+public:
+    void Insert( unsigned int serial_number, QString const & book_title, QString const & author_name,
+                 QString const & publisher );
+    void Remove( unsigned int serial_number );
+    void Clear();
+    // serial numbers, best match first. `limit` <= 0 returns every match
+    QList<unsigned int> Search( QString const & text, int limit ) const;
+    int Size() const { return documents.size(); }
+
+    static QStringList Words( QString const & text ); // lower-cased
+    // roughly what Insert() adds for one book: its copy of the words, a posting per distinct word and
+    // trigram and its node. The dictionaries' keys are shared by every book using them, so they grow
+    // with the vocabulary rather than the catalog and are not counted
+    static int DocumentBytes( QString const & book_title, QString const & author_name, QString const & publisher );
+private:
+    enum Field { Title = 0, Author, Publisher, FieldCount };
+    using Postings = std::vector<unsigned int>; // sorted serial numbers
+
+    struct Document
+    {
+        QStringList words[FieldCount];
+    };
+
+    static QList<quint64> Trigrams( QString const & word );
+    static void AddPosting( Postings & postings, unsigned int serial_number );
+    static bool RemovePosting( Postings & postings, unsigned int serial_number ); // true once empty
+    Postings Candidates( QString const & term ) const;
+    int Score( Document const & document, QString const & term ) const;
+private:
+    QHash<unsigned int, Document>   documents;
+    QMap<QString, Postings>         words;      // sorted, prefixes are a contiguous range
+    QHash<quint64, Postings>        trigrams;   // three UTF-16 code units packed into one key
+};
+
+#endif // SEARCH_INDEX_HPP
@@ -0,0 +1,135 @@
+#include "storage_backend.hpp"
+#include "add_item_dialog.hpp"
+#include "inventory_cache.hpp"
+#include "low_stock_tracker.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QStringList>
+
+int const SqliteBackend::BUSY_TIMEOUT_MS = 5000;
+
+namespace {
+// the time as text that sorts in time order, with milliseconds like the watermarks MySQL hands out
+QString const NOW = "strftime( '%Y-%m-%d %H:%M:%f', 'now' )";
+
+bool ExecAll( QSqlDatabase & database, QStringList const & statements, QString & error )
+{
+    for( QString const & statement : statements ){
+        QSqlQuery query{ database };
+        if( !query.exec( statement ) ){
+            error = query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+SqliteBackend::SqliteBackend():
+    SqliteBackend( QSettings{ "Phoebe", "BookManager" }.value( "sqlite/path",
+                   QStandardPaths::writableLocation( QStandardPaths::AppDataLocation ) + "/inventory.sqlite3" ).toString() )
+{
+}
+
+SqliteBackend::SqliteBackend( QString const & path ): path{ path }
+{
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+}
+
+QSqlDatabase SqliteBackend::AddConnection( QString const & connection_name ) const
+{
+    QSqlDatabase database = QSqlDatabase::addDatabase( "QSQLITE", connection_name );
+    database.setDatabaseName( path );
+    // a writer holds the lock for a moment only, wait for it instead of failing
+    database.setConnectOptions( QString( "QSQLITE_BUSY_TIMEOUT=%1" ).arg( BUSY_TIMEOUT_MS ) );
+    return database;
+}
+
+bool SqliteBackend::ConfigureConnection( QSqlDatabase & database ) const
+{
+    // WAL lets the pool's readers run while a transaction commits, NORMAL only syncs at checkpoints
+    QString error {};
+    if( !ExecAll( database, { "PRAGMA journal_mode = WAL", "PRAGMA synchronous = NORMAL" }, error ) ){
+        qDebug() << "Unable to configure" << database.connectionName() << error;
+        return false;
+    }
+    return true;
+}
+
+QString SqliteBackend::Identity() const
+{
+    return "QSQLITE://" + QFileInfo( path ).absoluteFilePath();
+}
+
+bool SqliteBackend::CreateSchema( QSqlDatabase & database, QString & error ) const
+{
+    QString const & table = AddItemDialog::TABLE_NAME;
+    QStringList const statements {
+        QString( "CREATE TABLE IF NOT EXISTS %1 ( "
+                 "serial_number INTEGER PRIMARY KEY AUTOINCREMENT, "
+                 "book_title TEXT, author_name TEXT, publisher TEXT, date_time DATETIME, "
+                 "stock INTEGER NOT NULL, price DOUBLE, location TEXT, "
+                 "low_stock_threshold INTEGER NOT NULL DEFAULT %2, "
+                 "cover_hash CHAR(64) NULL, "
+                 "updated_at TEXT NOT NULL DEFAULT ( %3 ) )" )
+                .arg( table ).arg( LowStockTracker::DEFAULT_THRESHOLD ).arg( NOW ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_updated_at ON %1( updated_at )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_stock ON %1( stock, low_stock_threshold )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_threshold ON %1( low_stock_threshold )" ).arg( table ),
+        // the table view reads the inventory in keyset chunks in the order of any of these( see
+        // InventoryTableModel ), the rowid breaks ties
+        QString( "CREATE INDEX IF NOT EXISTS inventory_book_title_sort ON %1( book_title )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_author_name_sort ON %1( author_name )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_publisher_sort ON %1( publisher )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_location_sort ON %1( location )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_stock_sort ON %1( stock )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_price_sort ON %1( price )" ).arg( table ),
+        QString( "CREATE INDEX IF NOT EXISTS inventory_date_time_sort ON %1( date_time )" ).arg( table ),
+        // there's no ON UPDATE for a column default, the trigger keeps the watermark moving instead.
+        // It only fires for statements that left updated_at alone, so it never fires itself
+        QString( "CREATE TRIGGER IF NOT EXISTS inventory_touch AFTER UPDATE ON %1 "
+                 "FOR EACH ROW WHEN NEW.updated_at = OLD.updated_at BEGIN "
+                 "UPDATE %1 SET updated_at = %2 WHERE serial_number = NEW.serial_number; END" ).arg( table, NOW ),
+        // an external content index: the titles and authors are stored once, in the inventory
+        QString( "CREATE VIRTUAL TABLE IF NOT EXISTS inventory_fts USING fts5( book_title, author_name, "
+                 "content='%1', content_rowid='serial_number' )" ).arg( table ),
+        QString( "CREATE TRIGGER IF NOT EXISTS inventory_fts_insert AFTER INSERT ON %1 BEGIN "
+                 "INSERT INTO inventory_fts( rowid, book_title, author_name ) "
+                 "VALUES ( NEW.serial_number, NEW.book_title, NEW.author_name ); END" ).arg( table ),
+        QString( "CREATE TRIGGER IF NOT EXISTS inventory_fts_delete AFTER DELETE ON %1 BEGIN "
+                 "INSERT INTO inventory_fts( inventory_fts, rowid, book_title, author_name ) "
+                 "VALUES ( 'delete', OLD.serial_number, OLD.book_title, OLD.author_name ); END" ).arg( table ),
+        QString( "CREATE TRIGGER IF NOT EXISTS inventory_fts_update AFTER UPDATE OF book_title, author_name ON %1 "
+                 "BEGIN INSERT INTO inventory_fts( inventory_fts, rowid, book_title, author_name ) "
+                 "VALUES ( 'delete', OLD.serial_number, OLD.book_title, OLD.author_name ); "
+                 "INSERT INTO inventory_fts( rowid, book_title, author_name ) "
+                 "VALUES ( NEW.serial_number, NEW.book_title, NEW.author_name ); END" ).arg( table ),
+        // tombstones for the snapshot catch-up( see InventoryCache )
+        QString( "CREATE TABLE IF NOT EXISTS inventory_deletions ( serial_number INTEGER PRIMARY KEY, "
+                 "deleted_at TEXT NOT NULL DEFAULT ( %1 ) )" ).arg( NOW ),
+        "CREATE INDEX IF NOT EXISTS inventory_deletions_at ON inventory_deletions( deleted_at )",
+        QString( "DELETE FROM inventory_deletions WHERE deleted_at < strftime( '%Y-%m-%d %H:%M:%f', 'now', '-%1 days' )" )
+                .arg( InventoryCache::SNAPSHOT_MAX_AGE_DAYS ),
+        // covers are shared by every till through the database, one row per distinct image( see CoverStore )
+        "CREATE TABLE IF NOT EXISTS covers ( cover_hash CHAR(64) PRIMARY KEY, cover BLOB NOT NULL, "
+        "stored_at TEXT NOT NULL DEFAULT CURRENT_TIMESTAMP )",
+        "CREATE TABLE IF NOT EXISTS reports ( "
+        "serial_number INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "book_title TEXT, author_name TEXT, stock INTEGER NOT NULL, "
+        "price DOUBLE, total DOUBLE, date_performed DATETIME, transaction_type INTEGER )",
+        "CREATE INDEX IF NOT EXISTS reports_date_type ON reports( date_performed, transaction_type )",
+        // created together with the reports, so there is never anything to backfill
+        "CREATE TABLE IF NOT EXISTS report_daily_rollups ( "
+        "day DATE NOT NULL, transaction_type INTEGER NOT NULL, "
+        "book_title TEXT NOT NULL, author_name TEXT NOT NULL, "
+        "quantity BIGINT NOT NULL, total DOUBLE NOT NULL, transactions INTEGER NOT NULL, "
+        "PRIMARY KEY( day, transaction_type, book_title, author_name ) ) WITHOUT ROWID"
+    };
+    return ExecAll( database, statements, error );
+}
@@ -0,0 +1,451 @@
+#include "statement_cache.hpp"
+#include "query_tracer.hpp"
+#include "resources.hpp"
+#include "storage_backend.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlField>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <map>
+
+namespace {
+struct StatementStats
+{
+    std::atomic<quint64> hits{ 0 };
+    std::atomic<quint64> prepares{ 0 };
+    std::atomic<quint64> reprepares{ 0 };
+};
+
+std::array<StatementStats, static_cast<int>( StatementId::Count )> statement_stats {};
+
+// MySQL: unknown prepared statement handler, server has gone away, lost connection during query
+bool IsLostStatement( QSqlError const & error )
+{
+    QString const code = error.nativeErrorCode();
+    return code == "1243" || code == "2006" || code == "2013" || error.type() == QSqlError::ConnectionError;
+}
+
+bool IsConnectionLost( QSqlError const & error )
+{
+    QString const code = error.nativeErrorCode();
+    return code == "2006" || code == "2013" || error.type() == QSqlError::ConnectionError;
+}
+
+// BEGIN, COMMIT and ROLLBACK go through the driver rather than a QSqlQuery, they are timed here
+template<typename Call>
+bool Traced( QString const & name, Call call )
+{
+    QueryTracer & tracer = QueryTracer::Instance();
+    tracer.Flush();
+    QElapsedTimer elapsed {};
+    elapsed.start();
+    bool const is_done = call();
+    tracer.Timed( name, elapsed.nsecsElapsed() / 1000, -1 );
+    return is_done;
+}
+}
+
+StatementCache & StatementCache::ForThread()
+{
+    // the pool empties it through Clear() before the thread's connection is removed
+    thread_local StatementCache cache {};
+    return cache;
+}
+
+QString StatementCache::Name( StatementId id )
+{
+    switch( id ){
+    case StatementId::InsertInventory: return "insert_inventory";
+    case StatementId::DeleteInventory: return "delete_inventory";
+    case StatementId::RecordDeletion: return "record_deletion";
+    case StatementId::SellStock: return "sell_stock";
+    case StatementId::SelectStock: return "select_stock";
+    case StatementId::SelectLowStock: return "select_low_stock";
+    case StatementId::SearchInventory: return "search_inventory";
+    case StatementId::SelectInventory: return "select_inventory";
+    case StatementId::SelectWatermark: return "select_watermark";
+    case StatementId::SelectInventoryChangedSince: return "select_inventory_changed_since";
+    case StatementId::SelectDeletedSince: return "select_deleted_since";
+    case StatementId::InventoryPageAfter: return "inventory_page_after";
+    case StatementId::InventoryPageBefore: return "inventory_page_before";
+    case StatementId::ReportsInRange: return "reports_in_range";
+    case StatementId::ReportsInRangeByType: return "reports_in_range_by_type";
+    case StatementId::DailyRollupsInRange: return "daily_rollups_in_range";
+    case StatementId::DailyRollupsInRangeByType: return "daily_rollups_in_range_by_type";
+    case StatementId::MonthlyRollupsInRange: return "monthly_rollups_in_range";
+    case StatementId::MonthlyRollupsInRangeByType: return "monthly_rollups_in_range_by_type";
+    case StatementId::InsertCover: return "insert_cover";
+    case StatementId::SelectCover: return "select_cover";
+    case StatementId::Count:
+    default:
+        return "unknown";
+    }
+}
+
+QString StatementCache::Sql( StatementId id )
+{
+    QString const inventory_columns = SelectColumns<DatabaseRecordFormat>( LargeObject );
+    bool const is_sqlite = StorageBackend::Current().Dialect() == SqlDialect::Sqlite;
+    switch( id ){
+    case StatementId::InsertInventory:
+        return InsertStatement<DatabaseRecordFormat>();
+    case StatementId::DeleteInventory:
+        return "DELETE FROM inventory WHERE serial_number = :serial_number";
+    case StatementId::RecordDeletion:
+        // deleted_at defaults to the current time on both backends
+        return "REPLACE INTO inventory_deletions ( serial_number ) VALUES ( :serial_number )";
+    case StatementId::SellStock:
+        // relative and guarded, a sale never takes the stock below zero nor overwrites a concurrent one.
+        // On MySQL, LAST_INSERT_ID( expr ) hands the new stock back with the OK packet( see
+        // lastInsertId() ). SQLite has no round-trip to save, the stock is read afterwards
+        if( is_sqlite ){
+            return "UPDATE inventory SET stock = stock - :quantity "
+                   "WHERE serial_number = :serial_number AND stock >= :quantity";
+        }
+        return "UPDATE inventory SET stock = LAST_INSERT_ID( stock - :quantity ) "
+               "WHERE serial_number = :serial_number AND stock >= :quantity";
+    case StatementId::SelectStock:
+        return "SELECT stock FROM inventory WHERE serial_number = :serial_number";
+    case StatementId::SelectLowStock:
+        // the first condition is a range on the inventory_stock index, bounded by the largest threshold
+        return "SELECT serial_number, book_title, author_name, stock, low_stock_threshold FROM inventory "
+               "WHERE stock < ( SELECT MAX( low_stock_threshold ) FROM inventory ) "
+               "AND stock < low_stock_threshold";
+    case StatementId::SearchInventory:
+        // best matches first on SQLite, MySQL's natural language mode ranks them already
+        if( is_sqlite ){
+            return QString( "SELECT %1 FROM inventory JOIN ( SELECT rowid AS matched, rank FROM inventory_fts "
+                            "WHERE inventory_fts MATCH :terms ) AS matches ON serial_number = matches.matched "
+                            "ORDER BY matches.rank" ).arg( inventory_columns );
+        }
+        return QString( "SELECT %1 FROM inventory WHERE MATCH ( book_title, author_name ) "
+                        "AGAINST ( :terms IN NATURAL LANGUAGE MODE )" ).arg( inventory_columns );
+    case StatementId::SelectInventory:
+        return QString( "SELECT %1 FROM inventory" ).arg( inventory_columns );
+    // the server's time as text, in the format of the updated_at columns
+    case StatementId::SelectWatermark:
+        return is_sqlite ? "SELECT strftime( '%Y-%m-%d %H:%M:%f', 'now' )" : "SELECT CAST( NOW(6) AS CHAR )";
+    // a change committed late may carry an earlier stamp, so the catch-up re-reads a margin before
+    // the watermark. Rows are applied idempotently
+    case StatementId::SelectInventoryChangedSince:
+        return QString( "SELECT %1 FROM inventory WHERE updated_at >= %2" )
+                .arg( inventory_columns, is_sqlite ? "strftime( '%Y-%m-%d %H:%M:%f', :since, -:margin || ' seconds' )" :
+                                                     "TIMESTAMPADD( SECOND, -:margin, :since )" );
+    case StatementId::SelectDeletedSince:
+        return QString( "SELECT serial_number FROM inventory_deletions WHERE deleted_at >= %1" )
+                .arg( is_sqlite ? "strftime( '%Y-%m-%d %H:%M:%f', :since, -:margin || ' seconds' )" :
+                                  "TIMESTAMPADD( SECOND, -:margin, :since )" );
+    case StatementId::InventoryPageAfter:
+        return QString( "SELECT %1 FROM inventory WHERE serial_number > :key "
+                        "ORDER BY serial_number ASC LIMIT :page_size" ).arg( inventory_columns );
+    case StatementId::InventoryPageBefore:
+        return QString( "SELECT %1 FROM inventory WHERE serial_number < :key "
+                        "ORDER BY serial_number DESC LIMIT :page_size" ).arg( inventory_columns );
+    case StatementId::ReportsInRange:
+        return QString( "SELECT %1 FROM reports WHERE ( date_performed >= :from AND date_performed <= :to )" )
+                .arg( SelectColumns<ReportFormat>() );
+    case StatementId::ReportsInRangeByType:
+        return QString( "SELECT %1 FROM reports WHERE ( date_performed >= :from AND date_performed <= :to ) "
+                        "AND transaction_type = :type" ).arg( SelectColumns<ReportFormat>() );
+    // rollups are read back as report rows, one per day( or month ), type and title
+    case StatementId::DailyRollupsInRange:
+    case StatementId::DailyRollupsInRangeByType:
+        return QString( "SELECT book_title, author_name, quantity AS stock, total, "
+                        "total / NULLIF( quantity, 0 ) AS price, day AS date_performed, transaction_type "
+                        "FROM report_daily_rollups WHERE day >= DATE( :from ) AND day <= DATE( :to ) %1"
+                        "ORDER BY day, transaction_type, book_title" )
+                .arg( QString( id == StatementId::DailyRollupsInRange ? "" : "AND transaction_type = :type " ) );
+    case StatementId::MonthlyRollupsInRange:
+    case StatementId::MonthlyRollupsInRangeByType:
+        return QString( "SELECT book_title, author_name, SUM( quantity ) AS stock, SUM( total ) AS total, "
+                        "SUM( total ) / NULLIF( SUM( quantity ), 0 ) AS price, "
+                        "%1 AS date_performed, transaction_type "
+                        "FROM report_daily_rollups WHERE day >= DATE( :from ) AND day <= DATE( :to ) %2"
+                        "GROUP BY date_performed, transaction_type, book_title, author_name "
+                        "ORDER BY date_performed, transaction_type, book_title" )
+                .arg( is_sqlite ? "DATE( day, 'start of month' )" : "CAST( DATE_FORMAT( day, '%Y-%m-01' ) AS DATE )",
+                      id == StatementId::MonthlyRollupsInRange ? "" : "AND transaction_type = :type " );
+    // a cover that is stored already is only stamped again, so the garbage collection leaves it alone
+    // until the row that refers to it is committed
+    case StatementId::InsertCover:
+        if( is_sqlite ){
+            return "INSERT INTO covers ( cover_hash, cover ) VALUES ( :cover_hash, :cover ) "
+                   "ON CONFLICT( cover_hash ) DO UPDATE SET stored_at = CURRENT_TIMESTAMP";
+        }
+        return "INSERT INTO covers ( cover_hash, cover ) VALUES ( :cover_hash, :cover ) "
+               "ON DUPLICATE KEY UPDATE stored_at = CURRENT_TIMESTAMP";
+    case StatementId::SelectCover:
+        return "SELECT cover FROM covers WHERE cover_hash = :cover_hash";
+    case StatementId::Count:
+    default:
+        return QString();
+    }
+}
+
+QString StatementCache::InlineSql( QSqlDatabase const & database, StatementId id,
+                                   QMap<QString, QVariant> const & values )
+{
+    QString sql = Sql( id );
+    // longest placeholders first, so that :to can never eat into a :total
+    QStringList names = values.keys();
+    std::sort( names.begin(), names.end(), []( QString const & a, QString const & b ){
+        return a.size() > b.size();
+    });
+    for( QString const & name : names ){
+        QVariant const & value = values[name];
+        // the drivers' own format drops the milliseconds, and SQLite compares the stored text
+        if( value.type() == QVariant::DateTime ){
+            sql.replace( name, "'" + value.toDateTime().toString( "yyyy-MM-ddThh:mm:ss.zzz" ) + "'" );
+            continue;
+        }
+        QSqlField field{ QString(), value.type() };
+        field.setValue( value );
+        sql.replace( name, database.driver()->formatValue( field ) );
+    }
+    return sql;
+}
+
+QString StatementCache::SearchTerms( QString const & text )
+{
+    if( StorageBackend::Current().Dialect() != SqlDialect::Sqlite ) return text;
+
+    // any of the words, each as a prefix. Quoted, so nothing the user types is FTS5 syntax
+    QStringList terms = text.split( QRegularExpression( "\\W+" ), Qt::SkipEmptyParts );
+    for( QString & term : terms ) term = '"' + term + "\"*";
+    return terms.isEmpty() ? QString( "\"\"" ) : terms.join( " OR " );
+}
+
+QString StatementCache::RollupUpsertClause()
+{
+    if( StorageBackend::Current().Dialect() == SqlDialect::Sqlite ){
+        return " ON CONFLICT( day, transaction_type, book_title, author_name ) DO UPDATE SET "
+               "quantity = quantity + excluded.quantity, total = total + excluded.total, "
+               "transactions = transactions + excluded.transactions";
+    }
+    return " ON DUPLICATE KEY UPDATE quantity = quantity + VALUES( quantity ), total = total + VALUES( total ), "
+           "transactions = transactions + VALUES( transactions )";
+}
+
+namespace {
+// adds `reports` to the daily rollups, one upsert per ROLLUPS_PER_UPSERT distinct day/type/title
+bool UpdateDailyRollups( QSqlDatabase & database, QList<ReportFormat> const & reports )
+{
+    using RollupKey = std::tuple<QDate, int, QString, QString>;
+    std::map<RollupKey, DailyRollup> rollups {};
+    for( ReportFormat const & report : reports ){
+        QString const title = report.book_title.left( ROLLUP_KEY_LENGTH ),
+                author = report.author_name.left( ROLLUP_KEY_LENGTH );
+        RollupKey const key{ report.date_time_added.date(), static_cast<int>( report.detail ), title, author };
+        auto iter = rollups.find( key );
+        if( iter == rollups.end() ){
+            iter = rollups.emplace( key, DailyRollup{ report.date_time_added.date(), report.detail, title, author,
+                                                      0, 0.0, 0 } ).first;
+        }
+        iter->second.quantity += report.quantity;
+        iter->second.total += report.total;
+        iter->second.transactions += 1;
+    }
+
+    int const ROLLUPS_PER_UPSERT = 100;
+    auto iter = rollups.cbegin();
+    while( iter != rollups.cend() ){
+        int const rows = qMin<int>( ROLLUPS_PER_UPSERT, static_cast<int>( std::distance( iter, rollups.cend() ) ) );
+        QSqlQuery rollup_query{ database };
+        rollup_query.prepare( InsertStatement<DailyRollup>( rows ) + StatementCache::RollupUpsertClause() );
+        for( int row = 0; row != rows; ++row, ++iter ){
+            BindRecordRow( rollup_query, iter->second, row );
+        }
+        if( !QueryTracer::Instance().Exec( "upsert_daily_rollups", rollup_query ) ){
+            qDebug() << rollup_query.lastError();
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+// one multi-row INSERT per REPORTS_PER_INSERT rows, then the rollups( see resources.hpp )
+bool InsertReports( QSqlDatabase & database, QList<ReportFormat> const & reports )
+{
+    int const REPORTS_PER_INSERT = 100;
+    for( int first = 0; first < reports.size(); first += REPORTS_PER_INSERT ){
+        int const rows = qMin( REPORTS_PER_INSERT, reports.size() - first );
+        QSqlQuery report_query{ database };
+        report_query.prepare( InsertStatement<ReportFormat>( rows ) );
+        for( int row = 0; row != rows; ++row ){
+            BindRecordRow( report_query, reports[first + row], row );
+        }
+        if( !QueryTracer::Instance().Exec( "insert_reports", report_query ) ){
+            qDebug() << report_query.lastError();
+            return false;
+        }
+    }
+    return UpdateDailyRollups( database, reports );
+}
+
+QSqlQuery & StatementCache::Prepare( QSqlDatabase & database, StatementId id )
+{
+    if( database.connectionName() != connection_name ){
+        Clear();
+        connection_name = database.connectionName();
+    }
+
+    Entry & entry = entries[ static_cast<int>( id ) ];
+    if( entry.query && !entry.stale ){
+        ++statement_stats[ static_cast<int>( id ) ].hits;
+        entry.query->finish(); // releases the previous result set, keeps the statement
+        return *entry.query;
+    }
+
+    bool const is_reprepare = entry.stale;
+    QElapsedTimer elapsed {};
+    elapsed.start();
+    bool const is_prepared = PrepareEntry( database, id, entry );
+    entry.prepare_usecs = elapsed.nsecsElapsed() / 1000;
+    if( !is_prepared ){
+        unprepared = *entry.query;
+        entry.query.reset();
+        return unprepared;
+    }
+    ++( is_reprepare ? statement_stats[ static_cast<int>( id ) ].reprepares :
+                       statement_stats[ static_cast<int>( id ) ].prepares );
+    return *entry.query;
+}
+
+bool StatementCache::PrepareEntry( QSqlDatabase & database, StatementId id, Entry & entry )
+{
+    entry.query.reset( new QSqlQuery( database ) );
+    entry.query->setForwardOnly( true );
+    entry.stale = false;
+    if( !entry.query->prepare( Sql( id ) ) ){
+        qDebug() << Name( id ) << entry.query->lastError();
+        return false;
+    }
+    return true;
+}
+
+bool StatementCache::Exec( QSqlDatabase & database, StatementId id, QSqlQuery & query )
+{
+    if( before_exec ) before_exec( id );
+    QElapsedTimer elapsed {};
+    elapsed.start();
+    bool const is_executed = ExecWithRetry( database, id, query );
+    Entry & entry = entries[ static_cast<int>( id ) ];
+    QueryTracer::Instance().Executed( Name( id ), entry.prepare_usecs, elapsed.nsecsElapsed() / 1000, query );
+    entry.prepare_usecs = 0;
+    return is_executed;
+}
+
+bool StatementCache::ExecWithRetry( QSqlDatabase & database, StatementId id, QSqlQuery & query )
+{
+    connection_lost = false;
+    if( query.exec() ) return true;
+
+    // a connection closed underneath the query fails with whatever error the driver makes up
+    QSqlError const error = query.lastError();
+    bool const is_closed = !database.isOpen();
+    if( !is_closed && !IsLostStatement( error ) ) return false;
+    connection_lost = is_closed || IsConnectionLost( error );
+    if( in_transaction && database.driver()->hasFeature( QSqlDriver::Transactions ) ) return false;
+
+    // every statement on this connection died with it
+    if( connection_lost && !Reconnect( database ) ) return false;
+
+    QMap<QString, QVariant> const bound_values = query.boundValues();
+    query = QSqlQuery( database );
+    query.setForwardOnly( true );
+    if( !query.prepare( Sql( id ) ) ) return false;
+    for( auto iter = bound_values.cbegin(); iter != bound_values.cend(); ++iter ){
+        query.bindValue( iter.key(), iter.value() );
+    }
+    ++statement_stats[ static_cast<int>( id ) ].reprepares;
+
+    Entry & entry = entries[ static_cast<int>( id ) ];
+    if( entry.query.get() == &query ) entry.stale = false;
+    return query.exec();
+}
+
+bool StatementCache::Begin( QSqlDatabase & database )
+{
+    in_transaction = Traced( "begin_transaction", [&]{ return database.transaction(); } );
+    connection_lost = !in_transaction && ( !database.isOpen() || IsConnectionLost( database.lastError() ) );
+    commit_in_doubt = false;
+    return in_transaction;
+}
+
+bool StatementCache::Commit( QSqlDatabase & database )
+{
+    // a failed commit leaves the transaction to the caller's Rollback()
+    bool const is_committed = Traced( "commit", [&]{ return database.commit(); } );
+    connection_lost = !is_committed && IsConnectionLost( database.lastError() );
+    commit_in_doubt = connection_lost;
+    if( is_committed ) in_transaction = false;
+    return is_committed;
+}
+
+void StatementCache::Rollback( QSqlDatabase & database )
+{
+    // statements that did not run through Exec() fail here too once the connection is gone
+    if( !Traced( "rollback", [&]{ return database.rollback(); } ) ){
+        connection_lost = connection_lost || !database.isOpen() || IsConnectionLost( database.lastError() );
+    }
+    in_transaction = false;
+}
+
+bool StatementCache::Reconnect( QSqlDatabase & database )
+{
+    in_transaction = false;
+    database.close();
+    Invalidate();
+    connection_lost = !database.open() || !StorageBackend::Current().ConfigureConnection( database );
+    return !connection_lost;
+}
+
+void StatementCache::Invalidate()
+{
+    for( Entry & entry : entries ){
+        entry.stale = static_cast<bool>( entry.query );
+    }
+}
+
+void StatementCache::Clear()
+{
+    for( Entry & entry : entries ){
+        entry.query.reset();
+        entry.stale = false;
+    }
+    unprepared = QSqlQuery();
+    connection_name.clear();
+    in_transaction = false;
+    connection_lost = false;
+    commit_in_doubt = false;
+}
+
+StatementCounters StatementCache::Counters( StatementId id )
+{
+    StatementStats const & stats = statement_stats[ static_cast<int>( id ) ];
+    return StatementCounters{ stats.hits.load(), stats.prepares.load(), stats.reprepares.load() };
+}
+
+QString StatementCache::Summary()
+{
+    QStringList lines {};
+    for( int i = 0; i != STATEMENT_COUNT; ++i ){
+        StatementId const id = static_cast<StatementId>( i );
+        StatementCounters const counters = Counters( id );
+        if( counters.hits + counters.prepares + counters.reprepares == 0 ) continue;
+        lines << QString( "%1: %2 hits, %3 prepares, %4 re-prepares" ).arg( Name( id ) )
+                 .arg( counters.hits ).arg( counters.prepares ).arg( counters.reprepares );
+    }
+    return lines.join( "\n" );
+}
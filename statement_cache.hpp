@@ -0,0 +1,125 @@
+#ifndef STATEMENT_CACHE_HPP
+#define STATEMENT_CACHE_HPP
+
+#include <QMap>
+#include <QSqlQuery>
+#include <QString>
+#include <QVariant>
+#include <array>
+#include <functional>
+#include <memory>
+
+class QSqlDatabase;
+
+// every statement on a hot path, fully parameterized. The SQL text lives in statement_cache.cpp, in
+// the dialect of the StorageBackend in use.
+enum class StatementId {
+    InsertInventory = 0,
+    DeleteInventory,
+    RecordDeletion,
+    SellStock,
+    SelectStock,
+    SelectLowStock,
+    SearchInventory,
+    SelectInventory,
+    SelectWatermark,
+    SelectInventoryChangedSince,
+    SelectDeletedSince,
+    InventoryPageAfter,
+    InventoryPageBefore,
+    ReportsInRange,
+    ReportsInRangeByType,
+    DailyRollupsInRange,
+    DailyRollupsInRangeByType,
+    MonthlyRollupsInRange,
+    MonthlyRollupsInRangeByType,
+    InsertCover,
+    SelectCover,
+    Count // not a statement
+};
+
+struct StatementCounters
+{
+    quint64 hits;       // served from the cache
+    quint64 prepares;   // first prepare on a connection
+    quint64 reprepares; // prepared again after the server forgot it, e.g. after a reconnect
+};
+
+// statements are prepared once per connection and then reused with new bound values. Connections
+// belong to exactly one thread( see ConnectionPool ), so every thread has a cache of its own.
+class StatementCache
+{
+public:
+    static StatementCache & ForThread();
+
+    // the prepared statement, ready for its values to be bound
+    QSqlQuery & Prepare( QSqlDatabase & database, StatementId id );
+    // executes a statement obtained from Prepare(). If the server lost the statement( or the
+    // connection ), it is prepared again with the same bound values and retried once, but never
+    // inside a transaction: see Begin(). Every execution is reported to the QueryTracer.
+    bool Exec( QSqlDatabase & database, StatementId id, QSqlQuery & query );
+
+    // transactions on this thread's connection go through here. Nothing is retried while one is
+    // open, a reconnect would silently drop it: what ran before would be rolled back and what runs
+    // after would autocommit. The caller rolls back and runs its whole unit of work again instead.
+    bool Begin( QSqlDatabase & database );
+    bool Commit( QSqlDatabase & database );
+    void Rollback( QSqlDatabase & database );
+    // the last statement, Begin() or Commit() failed because the connection went away
+    bool ConnectionLost() const { return connection_lost; }
+    // opens the connection again, its statements have to be prepared again
+    bool Reconnect( QSqlDatabase & database );
+    // runs `unit`, which begins and ends a transaction of its own, once more from the start on a
+    // reopened connection if the connection was lost halfway. A second loss is the caller's, and so
+    // is a COMMIT lost on its way: the server may have applied it
+    template<typename Unit>
+    auto Transact( QSqlDatabase & database, Unit unit ) -> decltype( unit() );
+    // called before every Exec(), for tests that lose the connection halfway through a unit of work
+    void SetBeforeExec( std::function<void( StatementId )> hook ){ before_exec = std::move( hook ); }
+
+    void Invalidate(); // the connection was reopened, statements must be prepared again
+    void Clear();      // the connection is going away, drop every statement
+
+    static QString Name( StatementId id );
+    static QString Sql( StatementId id );
+    // the statement with its values formatted in by the driver. Only for streaming cursors: QMYSQL
+    // buffers the whole result of a prepared statement client-side, but not of a forward-only query.
+    // Dates and times are written as the SQLite driver binds them, which MySQL reads too.
+    static QString InlineSql( QSqlDatabase const & database, StatementId id, QMap<QString, QVariant> const & values );
+    // what to bind to SearchInventory's :terms for the words the user typed
+    static QString SearchTerms( QString const & text );
+    // appended to a multi-row INSERT into report_daily_rollups, adds to the rows that exist already
+    static QString RollupUpsertClause();
+    static StatementCounters Counters( StatementId id );
+    static QString Summary();
+private:
+    struct Entry
+    {
+        std::unique_ptr<QSqlQuery> query;
+        bool                       stale = false;
+        qint64                     prepare_usecs = 0; // of the Prepare() before the next Exec()
+    };
+    static int const STATEMENT_COUNT = static_cast<int>( StatementId::Count );
+
+    bool PrepareEntry( QSqlDatabase & database, StatementId id, Entry & entry );
+    bool ExecWithRetry( QSqlDatabase & database, StatementId id, QSqlQuery & query );
+private:
+    QString                             connection_name;
+    std::array<Entry, STATEMENT_COUNT>  entries;
+    QSqlQuery                           unprepared; // handed out when preparing fails
+    bool                                in_transaction = false;
+    bool                                connection_lost = false;
+    bool                                commit_in_doubt = false;
+    std::function<void( StatementId )>  before_exec;
+};
+
+template<typename Unit>
+auto StatementCache::Transact( QSqlDatabase & database, Unit unit ) -> decltype( unit() )
+{
+    connection_lost = false;
+    auto result = unit();
+    if( !connection_lost || commit_in_doubt || !Reconnect( database ) ) return result;
+    return unit();
+}
+
+#endif // STATEMENT_CACHE_HPP
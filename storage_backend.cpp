@@ -0,0 +1,33 @@
+#include "storage_backend.hpp"
+
+#include <QDebug>
+#include <QSettings>
+
+namespace {
+std::unique_ptr<StorageBackend> current_backend {};
+
+std::unique_ptr<StorageBackend> FromSettings()
+{
+    QString const name = QSettings{ "Phoebe", "BookManager" }.value( "storage/backend", "mysql" ).toString();
+    if( name.compare( "sqlite", Qt::CaseInsensitive ) == 0 ) return std::make_unique<SqliteBackend>();
+    if( name.compare( "mysql", Qt::CaseInsensitive ) != 0 ){
+        qDebug() << "Unknown storage backend" << name << "- using MySQL";
+    }
+    return std::make_unique<MySqlBackend>();
+}
+}
+
+StorageBackend & StorageBackend::Current()
+{
+    // chosen once, a run never switches databases halfway
+    static StorageBackend *const backend = current_backend ? current_backend.get() :
+                                                             ( current_backend = FromSettings() ).get();
+    return *backend;
+}
+
+bool StorageBackend::Install( std::unique_ptr<StorageBackend> backend )
+{
+    if( current_backend ) return false;
+    current_backend = std::move( backend );
+    return true;
+}
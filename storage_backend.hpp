@@ -0,0 +1,85 @@
+#ifndef STORAGE_BACKEND_HPP
+#define STORAGE_BACKEND_HPP
+
+#include <QSqlDatabase>
+#include <QString>
+#include <memory>
+
+enum class SqlDialect {
+    MySql,
+    Sqlite
+};
+
+// where the inventory lives. The backend is chosen once per run from the settings( storage/backend,
+// "mysql" or "sqlite" ) and everything else reaches the database through it: connections, the
+// schema and the handful of statements whose SQL differs( see StatementCache::Sql ).
+class StorageBackend
+{
+public:
+    static StorageBackend & Current();
+    // replaces the backend the settings name, for runs that must not touch the shop's database( the
+    // benchmarks ). False if Current() has been asked already
+    static bool Install( std::unique_ptr<StorageBackend> backend );
+    virtual ~StorageBackend() = default;
+
+    virtual SqlDialect Dialect() const = 0;
+    virtual QString Name() const = 0;
+    // registers a connection named `connection_name`, it is not opened
+    virtual QSqlDatabase AddConnection( QString const & connection_name ) const = 0;
+    // runs once on every connection right after it was opened
+    virtual bool ConfigureConnection( QSqlDatabase & database ) const = 0;
+    // names the database AddConnection() reaches
+    virtual QString Identity() const = 0;
+    // creates the tables( if they do not exist yet ) and upgrades those of older versions
+    virtual bool CreateSchema( QSqlDatabase & database, QString & error ) const = 0;
+    // the server can cancel a statement running on another connection( see ReportExporter )
+    virtual bool CanKillQueries() const = 0;
+    // the indexed column the inventory is ordered by when it is sorted on `column`( see
+    // InventoryTableModel ), the column itself unless it can't be indexed as a whole
+    virtual QString SortColumn( QString const & column ) const { return column; }
+};
+
+// the shop's MySQL server, shared by every till
+class MySqlBackend : public StorageBackend
+{
+public:
+    MySqlBackend(); // reads mysql/host, port, database, user and password from the settings
+    explicit MySqlBackend( QString const & database_name ); // the same server, another database
+    SqlDialect Dialect() const override { return SqlDialect::MySql; }
+    QString Name() const override { return "mysql"; }
+    QSqlDatabase AddConnection( QString const & connection_name ) const override;
+    bool ConfigureConnection( QSqlDatabase & database ) const override;
+    QString Identity() const override;
+    bool CreateSchema( QSqlDatabase & database, QString & error ) const override;
+    bool CanKillQueries() const override { return true; }
+    QString SortColumn( QString const & column ) const override;
+private:
+    QString host_name;
+    int     port;
+    QString database_name;
+    QString user_name;
+    QString password;
+};
+
+// one file on the local disk, for a shop with a single till and for throwaway databases. The
+// database runs in WAL mode, so readers on the pool's other connections never wait for a writer,
+// and the titles and authors are searched through an FTS5 index kept up to date by triggers.
+class SqliteBackend : public StorageBackend
+{
+public:
+    SqliteBackend(); // reads sqlite/path from the settings, the application's data directory by default
+    explicit SqliteBackend( QString const & path );
+    SqlDialect Dialect() const override { return SqlDialect::Sqlite; }
+    QString Name() const override { return "sqlite"; }
+    QSqlDatabase AddConnection( QString const & connection_name ) const override;
+    bool ConfigureConnection( QSqlDatabase & database ) const override;
+    QString Identity() const override;
+    bool CreateSchema( QSqlDatabase & database, QString & error ) const override;
+    bool CanKillQueries() const override { return false; }
+
+    static int const BUSY_TIMEOUT_MS;
+private:
+    QString path;
+};
+
+#endif // STORAGE_BACKEND_HPP
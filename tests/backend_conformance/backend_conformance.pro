@@ -0,0 +1,5 @@
+TARGET = tst_backend_conformance
+
+include( ../tests.pri )
+
+SOURCES += tst_backend_conformance.cpp
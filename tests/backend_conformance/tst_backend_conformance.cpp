@@ -0,0 +1,221 @@
+#include <QDateTime>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtTest>
+#include "connection_pool.hpp"
+#include "report_dialog.hpp"
+#include "resources.hpp"
+#include "statement_cache.hpp"
+#include "test_backends.hpp"
+
+namespace {
+// the range a user picks in the report dialog: from the start of the first day to the end of the last
+QDate const FIRST_DAY{ 2026, 3, 2 };
+QDate const LAST_DAY{ 2026, 3, 4 };
+}
+
+// the application behaves the same on every StorageBackend: the same assertions, run once per backend.
+// Checkouts are tst_checkout's, which runs once per backend as well
+class BackendConformanceTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+
+    void insertsUpdatesAndDeletes();
+    void reportsWholeRange_data();
+    void reportsWholeRange();
+    void rollsUpWholeRange_data();
+    void rollsUpWholeRange();
+private:
+    QList<DatabaseRecordFormat> Inventory();
+    // one report a minute outside the range on either side, three inside it
+    void AddReports();
+    QList<ReportFormat> Report( ReportActionType type, ReportGranularity granularity );
+private:
+    QTemporaryDir   directory;
+    QSqlDatabase    database;
+};
+
+void BackendConformanceTest::initTestCase()
+{
+    QString error {};
+    QVERIFY2( InstallTestBackend( directory, database, error ), qPrintable( error ) );
+}
+
+void BackendConformanceTest::init()
+{
+    database = ConnectionPool::Instance().Acquire();
+    QString error {};
+    QVERIFY2( EmptyTables( database, { "inventory", "reports", "report_daily_rollups" }, error ),
+              qPrintable( error ) );
+}
+
+void BackendConformanceTest::cleanupTestCase()
+{
+    database = QSqlDatabase();
+    ConnectionPool::Instance().Release();
+}
+
+QList<DatabaseRecordFormat> BackendConformanceTest::Inventory()
+{
+    QList<DatabaseRecordFormat> records {};
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & select_query = statements.Prepare( database, StatementId::SelectInventory );
+    if( statements.Exec( database, StatementId::SelectInventory, select_query ) ){
+        FillRecordFromQuery( records, select_query );
+    }
+    return records;
+}
+
+void BackendConformanceTest::AddReports()
+{
+    auto report = []( QDateTime const & date_time, ReportActionType type, int quantity ){
+        return ReportFormat{ 0, quantity, 10.0, quantity * 10.0, "Arrow of God", "Chinua Achebe", date_time, type };
+    };
+    QList<ReportFormat> const reports {
+        report( QDateTime( FIRST_DAY.addDays( -1 ), QTime( 23, 59 ) ), ReportActionType::SALES, 1 ),
+        report( QDateTime( FIRST_DAY, QTime( 0, 0 ) ), ReportActionType::SALES, 2 ),
+        report( QDateTime( FIRST_DAY.addDays( 1 ), QTime( 12, 0 ) ), ReportActionType::ADDITIONS, 5 ),
+        report( QDateTime( LAST_DAY, QTime( 23, 30 ) ), ReportActionType::SALES, 3 ),
+        report( QDateTime( LAST_DAY.addDays( 1 ), QTime( 0, 1 ) ), ReportActionType::SALES, 4 )
+    };
+    StatementCache & statements = StatementCache::ForThread();
+    QVERIFY( statements.Begin( database ) );
+    if( !InsertReports( database, reports ) ){
+        statements.Rollback( database );
+        QFAIL( "Unable to insert the reports" );
+    }
+    QVERIFY( statements.Commit( database ) );
+}
+
+// the way ReportExporter runs it: the dialog's statement and values, inlined into a forward-only query
+QList<ReportFormat> BackendConformanceTest::Report( ReportActionType type, ReportGranularity granularity )
+{
+    QMap<QString, QVariant> const values = ReportDialog::QueryValues( QDateTime( FIRST_DAY, QTime( 0, 0 ) ),
+                                                                      QDateTime( LAST_DAY, QTime( 23, 59, 59 ) ),
+                                                                      type );
+    QList<ReportFormat> reports {};
+    QSqlQuery report_query{ database };
+    report_query.setForwardOnly( true );
+    StatementId const id = ReportDialog::GetStatement( type, granularity );
+    if( !report_query.exec( StatementCache::InlineSql( database, id, values ) ) ){
+        qWarning() << report_query.lastError().text();
+        return reports;
+    }
+    FillReportFromQuery( reports, report_query );
+    return reports;
+}
+
+void BackendConformanceTest::insertsUpdatesAndDeletes()
+{
+    DatabaseRecordFormat book = TestBook( "Things Fall Apart" );
+    book.serial_number = AddTestBook( database, book );
+    QVERIFY( book.serial_number != 0 );
+
+    QList<DatabaseRecordFormat> records = Inventory();
+    QCOMPARE( records.size(), 1 );
+    QCOMPARE( records.first().serial_number, book.serial_number );
+    QCOMPARE( records.first().book_title, book.book_title );
+    QCOMPARE( records.first().author_name, book.author_name );
+    QCOMPARE( records.first().publisher, book.publisher );
+    QCOMPARE( records.first().quantity, book.quantity );
+    QCOMPARE( records.first().price, book.price );
+    QCOMPARE( records.first().date_time_added, book.date_time_added );
+    QCOMPARE( records.first().location, book.location );
+
+    DatabaseRecordFormat updated = book;
+    updated.quantity = 3;
+    updated.location = "Shelf 4";
+    ColumnMask const changed = ChangedColumns( book, updated );
+    QSqlQuery update_query{ database };
+    QVERIFY( update_query.prepare( UpdateStatement<DatabaseRecordFormat>( changed ) ) );
+    BindColumns( update_query, updated, changed );
+    QVERIFY2( update_query.exec(), qPrintable( update_query.lastError().text() ) );
+    records = Inventory();
+    QCOMPARE( records.size(), 1 );
+    QCOMPARE( records.first().quantity, 3u );
+    QCOMPARE( records.first().location, QString( "Shelf 4" ) );
+    QCOMPARE( records.first().book_title, book.book_title );
+
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & delete_query = statements.Prepare( database, StatementId::DeleteInventory );
+    delete_query.bindValue( ":serial_number", book.serial_number );
+    QVERIFY2( statements.Exec( database, StatementId::DeleteInventory, delete_query ),
+              qPrintable( delete_query.lastError().text() ) );
+    QVERIFY( Inventory().isEmpty() );
+}
+
+void BackendConformanceTest::reportsWholeRange_data()
+{
+    QTest::addColumn<int>( "type" );
+    QTest::addColumn<int>( "rows" );
+    QTest::addColumn<int>( "quantity" );
+    QTest::newRow( "all" ) << static_cast<int>( ReportActionType::ALL ) << 3 << 10;
+    QTest::newRow( "sales" ) << static_cast<int>( ReportActionType::SALES ) << 2 << 5;
+    QTest::newRow( "deletions" ) << static_cast<int>( ReportActionType::DELETIONS ) << 0 << 0;
+}
+
+// the first and the last day of the range are reported whole, the days around them not at all
+void BackendConformanceTest::reportsWholeRange()
+{
+    QFETCH( int, type );
+    QFETCH( int, rows );
+    QFETCH( int, quantity );
+    AddReports();
+    if( QTest::currentTestFailed() ) return;
+    QList<ReportFormat> const reports = Report( static_cast<ReportActionType>( type ),
+                                                ReportGranularity::Transactions );
+    QCOMPARE( reports.size(), rows );
+    int reported = 0;
+    for( ReportFormat const & report : reports ){
+        QVERIFY( report.date_time_added.date() >= FIRST_DAY && report.date_time_added.date() <= LAST_DAY );
+        reported += report.quantity;
+    }
+    QCOMPARE( reported, quantity );
+}
+
+void BackendConformanceTest::rollsUpWholeRange_data()
+{
+    QTest::addColumn<int>( "type" );
+    QTest::addColumn<int>( "granularity" );
+    QTest::addColumn<int>( "rows" );
+    QTest::addColumn<int>( "quantity" );
+    QTest::addColumn<double>( "total" );
+    int const daily = static_cast<int>( ReportGranularity::Daily ),
+            monthly = static_cast<int>( ReportGranularity::Monthly );
+    QTest::newRow( "daily, all" ) << static_cast<int>( ReportActionType::ALL ) << daily << 3 << 10 << 100.0;
+    QTest::newRow( "daily, sales" ) << static_cast<int>( ReportActionType::SALES ) << daily << 2 << 5 << 50.0;
+    QTest::newRow( "monthly, all" ) << static_cast<int>( ReportActionType::ALL ) << monthly << 2 << 10 << 100.0;
+    QTest::newRow( "monthly, sales" ) << static_cast<int>( ReportActionType::SALES ) << monthly << 1 << 5 << 50.0;
+}
+
+void BackendConformanceTest::rollsUpWholeRange()
+{
+    QFETCH( int, type );
+    QFETCH( int, granularity );
+    QFETCH( int, rows );
+    QFETCH( int, quantity );
+    QFETCH( double, total );
+    AddReports();
+    if( QTest::currentTestFailed() ) return;
+    QList<ReportFormat> const rollups = Report( static_cast<ReportActionType>( type ),
+                                                static_cast<ReportGranularity>( granularity ) );
+    QCOMPARE( rollups.size(), rows );
+    int reported_quantity = 0;
+    double reported_total = 0.0;
+    for( ReportFormat const & rollup : rollups ){
+        QCOMPARE( rollup.date_time_added.date().month(), FIRST_DAY.month() );
+        reported_quantity += rollup.quantity;
+        reported_total += rollup.total;
+    }
+    QCOMPARE( reported_quantity, quantity );
+    QCOMPARE( reported_total, total );
+}
+
+PHOEBE_TEST_MAIN_PER_BACKEND( BackendConformanceTest )
+
+#include "tst_backend_conformance.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_checkout
+
+include( ../tests.pri )
+
+SOURCES += tst_checkout.cpp
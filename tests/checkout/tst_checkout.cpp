@@ -0,0 +1,146 @@
+#include <QDateTime>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+#include "checkout.hpp"
+#include "connection_pool.hpp"
+#include "low_stock_tracker.hpp"
+#include "resources.hpp"
+#include "statement_cache.hpp"
+#include "test_backends.hpp"
+
+namespace {
+unsigned int const SOLD_PER_LINE = 2;
+}
+
+// a cart is sold as a whole or not at all, even when the connection drops halfway through it, on
+// every backend
+class CheckoutTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void cleanupTestCase();
+
+    void sellsWholeCart();
+    void sellsNothingOnConflict();
+    void restartsAfterLostConnection();
+    void sellsNothingWhenConnectionKeepsDropping();
+private:
+    unsigned int Stock( unsigned int serial_number );
+    QList<CartLine> Cart() const;
+    // loses the connection at the `line`th sale of a cart, on the first attempt only or on every one
+    void LoseConnectionAt( int line, bool every_attempt );
+private:
+    QTemporaryDir       directory;
+    QSqlDatabase        database;
+    QList<unsigned int> books;
+};
+
+void CheckoutTest::initTestCase()
+{
+    QString error {};
+    QVERIFY2( InstallTestBackend( directory, database, error ), qPrintable( error ) );
+}
+
+void CheckoutTest::init()
+{
+    database = ConnectionPool::Instance().Acquire();
+    QString error {};
+    QVERIFY2( EmptyTables( database, { "inventory" }, error ), qPrintable( error ) );
+    books.clear();
+    for( QString const & title : { "Things Fall Apart", "Arrow of God", "No Longer at Ease" } ){
+        books.append( AddTestBook( database, TestBook( title ) ) );
+    }
+}
+
+void CheckoutTest::cleanup()
+{
+    StatementCache::ForThread().SetBeforeExec( nullptr );
+}
+
+void CheckoutTest::cleanupTestCase()
+{
+    database = QSqlDatabase();
+    ConnectionPool::Instance().Release();
+}
+
+unsigned int CheckoutTest::Stock( unsigned int serial_number )
+{
+    database = ConnectionPool::Instance().Acquire();
+    QSqlQuery stock_query{ database };
+    stock_query.prepare( "SELECT stock FROM inventory WHERE serial_number = :serial_number" );
+    stock_query.bindValue( ":serial_number", serial_number );
+    return stock_query.exec() && stock_query.next() ? stock_query.value( 0 ).toUInt() : 0;
+}
+
+QList<CartLine> CheckoutTest::Cart() const
+{
+    QList<CartLine> cart {};
+    for( unsigned int serial_number : books ){
+        cart.append( CartLine{ serial_number, SOLD_PER_LINE, 10.0, "Title", "Chinua Achebe",
+                               LowStockTracker::DEFAULT_THRESHOLD } );
+    }
+    return cart;
+}
+
+void CheckoutTest::LoseConnectionAt( int line, bool every_attempt )
+{
+    auto sales = std::make_shared<int>( 0 );
+    StatementCache::ForThread().SetBeforeExec( [=]( StatementId id ){
+        if( id != StatementId::SellStock ) return;
+        int const sale = ++*sales;
+        // an attempt ends at the sale that lost the connection, so every attempt made `line` sales
+        bool const is_lost = every_attempt ? sale % line == 0 : sale == line;
+        if( !is_lost ) return;
+        QString error {};
+        if( !KillPooledConnection( error ) ) qWarning() << "Unable to kill the connection:" << error;
+    });
+}
+
+void CheckoutTest::sellsWholeCart()
+{
+    QueryResult<QList<CheckoutConflict>> const result = Checkout( database, Cart(), QDateTime::currentDateTime() );
+    QVERIFY2( result.ok, qPrintable( result.error ) );
+    QVERIFY( result.value.isEmpty() );
+    for( unsigned int serial_number : books ) QCOMPARE( Stock( serial_number ), TEST_BOOK_STOCK - SOLD_PER_LINE );
+}
+
+void CheckoutTest::sellsNothingOnConflict()
+{
+    QList<CartLine> cart = Cart();
+    cart.last().quantity = TEST_BOOK_STOCK + 1;
+    QueryResult<QList<CheckoutConflict>> const result = Checkout( database, cart, QDateTime::currentDateTime() );
+    QVERIFY2( result.ok, qPrintable( result.error ) );
+    QCOMPARE( result.value.size(), 1 );
+    QCOMPARE( result.value.first().serial_number, books.last() );
+    QCOMPARE( result.value.first().stock_left, TEST_BOOK_STOCK );
+    for( unsigned int serial_number : books ) QCOMPARE( Stock( serial_number ), TEST_BOOK_STOCK );
+}
+
+// the lines sold before the connection dropped were rolled back with it, the restart sells each once
+void CheckoutTest::restartsAfterLostConnection()
+{
+    LoseConnectionAt( 2, false );
+    QueryResult<QList<CheckoutConflict>> const result = Checkout( database, Cart(), QDateTime::currentDateTime() );
+    StatementCache::ForThread().SetBeforeExec( nullptr );
+    QVERIFY2( result.ok, qPrintable( result.error ) );
+    QVERIFY( result.value.isEmpty() );
+    for( unsigned int serial_number : books ) QCOMPARE( Stock( serial_number ), TEST_BOOK_STOCK - SOLD_PER_LINE );
+}
+
+void CheckoutTest::sellsNothingWhenConnectionKeepsDropping()
+{
+    LoseConnectionAt( 2, true );
+    QueryResult<QList<CheckoutConflict>> const result = Checkout( database, Cart(), QDateTime::currentDateTime() );
+    StatementCache::ForThread().SetBeforeExec( nullptr );
+    QVERIFY( !result.ok );
+    for( unsigned int serial_number : books ) QCOMPARE( Stock( serial_number ), TEST_BOOK_STOCK );
+}
+
+PHOEBE_TEST_MAIN_PER_BACKEND( CheckoutTest )
+
+#include "tst_checkout.moc"
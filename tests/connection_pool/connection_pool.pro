@@ -0,0 +1,5 @@
+TARGET = tst_connection_pool
+
+include( ../tests.pri )
+
+SOURCES += tst_connection_pool.cpp
@@ -0,0 +1,98 @@
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QtTest>
+#include "connection_pool.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+#include "test_backends.hpp"
+
+// the pool hands out a working connection again after the server dropped the one it had
+class ConnectionPoolTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void recoversFromKilledConnection_data();
+    void recoversFromKilledConnection();
+    void recoversOnWorkerThread();
+private:
+    static bool SelectWatermark( QString & error );
+private:
+    QTemporaryDir directory;
+};
+
+void ConnectionPoolTest::initTestCase()
+{
+    QCoreApplication::setOrganizationName( "Phoebe" );
+    QCoreApplication::setApplicationName( "BookManagerTests" );
+    QVERIFY( directory.isValid() );
+    QVERIFY( StorageBackend::Install( MakeTestBackend( TestBackendName(), directory ) ) );
+
+    QSqlDatabase database = ConnectionPool::Instance().Acquire();
+    QVERIFY2( database.isOpen(), qPrintable( database.lastError().text() ) );
+    QString error {};
+    QVERIFY2( StorageBackend::Current().CreateSchema( database, error ), qPrintable( error ) );
+}
+
+void ConnectionPoolTest::cleanupTestCase()
+{
+    ConnectionPool::Instance().Release();
+}
+
+// a cached statement, it has to be prepared again on the new connection
+bool ConnectionPoolTest::SelectWatermark( QString & error )
+{
+    QSqlDatabase database = ConnectionPool::Instance().Acquire();
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & query = statements.Prepare( database, StatementId::SelectWatermark );
+    if( !statements.Exec( database, StatementId::SelectWatermark, query ) || !query.next() ){
+        error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void ConnectionPoolTest::recoversFromKilledConnection_data()
+{
+    QTest::addColumn<bool>( "idle" );
+    QTest::newRow( "handed out right away" ) << false;
+    QTest::newRow( "idle, validated first" ) << true;
+}
+
+void ConnectionPoolTest::recoversFromKilledConnection()
+{
+    QFETCH( bool, idle );
+    QString error {};
+    QVERIFY2( SelectWatermark( error ), qPrintable( error ) );
+    int const connections = ConnectionPool::Instance().ConnectionCount();
+
+    QVERIFY2( KillPooledConnection( error ), qPrintable( error ) );
+    if( idle ) QThread::msleep( ConnectionPool::VALIDATE_AFTER_IDLE_MS + 100 );
+
+    QVERIFY2( SelectWatermark( error ), qPrintable( error ) );
+    QVERIFY( ConnectionPool::Instance().Acquire().isOpen() );
+    QCOMPARE( ConnectionPool::Instance().ConnectionCount(), connections );
+}
+
+// the executor's worker and the report threads hold connections of their own
+void ConnectionPoolTest::recoversOnWorkerThread()
+{
+    bool is_recovered = false;
+    QString error {};
+    std::unique_ptr<QThread> worker{ QThread::create( [&]{
+        is_recovered = SelectWatermark( error ) && KillPooledConnection( error ) && SelectWatermark( error );
+        ConnectionPool::Instance().Release();
+    }) };
+    worker->start();
+    QVERIFY( worker->wait( 30000 ) );
+    QVERIFY2( is_recovered, qPrintable( error ) );
+    QCOMPARE( ConnectionPool::Instance().ConnectionCount(), 1 ); // this thread's only
+}
+
+QTEST_MAIN( ConnectionPoolTest )
+
+#include "tst_connection_pool.moc"
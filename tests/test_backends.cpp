@@ -0,0 +1,143 @@
+#include "test_backends.hpp"
+#include "connection_pool.hpp"
+#include "connection_settings.hpp"
+#include "low_stock_tracker.hpp"
+#include "statement_cache.hpp"
+#include "storage_backend.hpp"
+
+#include <QDebug>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QSqlError>
+#include <QSqlQuery>
+
+namespace {
+QString EnvironmentString( char const *name, QString const & default_value )
+{
+    return qEnvironmentVariableIsSet( name ) ? QString::fromLocal8Bit( qgetenv( name ) ) : default_value;
+}
+}
+
+QString TestBackendName()
+{
+    return EnvironmentString( "PHOEBE_TEST_BACKEND", "sqlite" ).toLower();
+}
+
+std::unique_ptr<StorageBackend> MakeTestBackend( QString const & name, QTemporaryDir const & directory )
+{
+    if( name == "mysql" ){
+        return std::make_unique<MySqlBackend>( EnvironmentString( "PHOEBE_TEST_DATABASE", "phoebe_tests" ) );
+    }
+    return std::make_unique<SqliteBackend>( directory.filePath( "phoebe_tests.sqlite3" ) );
+}
+
+bool InstallTestBackend( QTemporaryDir const & directory, QSqlDatabase & database, QString & error )
+{
+    QCoreApplication::setOrganizationName( "Phoebe" );
+    QCoreApplication::setApplicationName( "BookManagerTests" );
+    if( !directory.isValid() ){
+        error = directory.errorString();
+        return false;
+    }
+    if( !StorageBackend::Install( MakeTestBackend( TestBackendName(), directory ) ) ){
+        error = "A backend was installed already";
+        return false;
+    }
+    qInfo() << "Running against" << StorageBackend::Current().Name();
+
+    database = ConnectionPool::Instance().Acquire();
+    if( !database.isOpen() ){
+        error = database.lastError().text();
+        return false;
+    }
+    return StorageBackend::Current().CreateSchema( database, error );
+}
+
+bool EmptyTables( QSqlDatabase & database, QStringList const & tables, QString & error )
+{
+    QSqlQuery delete_query{ database };
+    for( QString const & table : tables ){
+        if( !delete_query.exec( "DELETE FROM " + table ) ){
+            error = delete_query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+DatabaseRecordFormat TestBook( QString const & title )
+{
+    DatabaseRecordFormat book {};
+    book.book_title = title;
+    book.author_name = "Chinua Achebe";
+    book.publisher = "Heinemann";
+    book.quantity = TEST_BOOK_STOCK;
+    book.price = 10.5;
+    book.date_time_added = QDateTime( QDate( 2026, 3, 2 ), QTime( 9, 30, 15 ) );
+    book.location = "Shelf 3";
+    book.low_stock_threshold = LowStockTracker::DEFAULT_THRESHOLD;
+    return book;
+}
+
+unsigned int AddTestBook( QSqlDatabase & database, DatabaseRecordFormat const & book )
+{
+    StatementCache & statements = StatementCache::ForThread();
+    QSqlQuery & insert_query = statements.Prepare( database, StatementId::InsertInventory );
+    BindRecord( insert_query, book, PrimaryKey );
+    if( !statements.Exec( database, StatementId::InsertInventory, insert_query ) ){
+        qWarning() << insert_query.lastError().text();
+        return 0;
+    }
+    return insert_query.lastInsertId().toUInt();
+}
+
+int RunPerBackend( QStringList const & arguments )
+{
+    QString const backends = EnvironmentString( "PHOEBE_TEST_BACKENDS", "sqlite,mysql" );
+    int failures = 0;
+    for( QString const & backend : backends.toLower().split( ',', Qt::SkipEmptyParts ) ){
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert( "PHOEBE_TEST_BACKEND", backend.trimmed() );
+        QProcess run {};
+        run.setProcessEnvironment( environment );
+        run.setProcessChannelMode( QProcess::ForwardedChannels );
+        run.start( QCoreApplication::applicationFilePath(), arguments );
+        if( !run.waitForFinished( -1 ) || run.exitStatus() != QProcess::NormalExit ){
+            qWarning() << "The" << backend << "run did not finish:" << run.errorString();
+            ++failures;
+            continue;
+        }
+        failures += ( run.exitCode() != 0 );
+    }
+    return failures;
+}
+
+bool KillPooledConnection( QString & error )
+{
+    QSqlDatabase database = ConnectionPool::Instance().Acquire();
+    if( StorageBackend::Current().Dialect() == SqlDialect::Sqlite ){
+        database.close();
+        return true;
+    }
+
+    QSqlQuery id_query{ database };
+    if( !id_query.exec( "SELECT CONNECTION_ID()" ) || !id_query.next() ){
+        error = id_query.lastError().text();
+        return false;
+    }
+    QString const connection_id = id_query.value( 0 ).toString();
+    bool is_killed = false;
+    {
+        QSqlDatabase killer = AddConnection( "test_killer" );
+        if( killer.open() ){
+            QSqlQuery kill_query{ killer };
+            is_killed = kill_query.exec( "KILL " + connection_id );
+            if( !is_killed ) error = kill_query.lastError().text();
+            killer.close();
+        } else {
+            error = killer.lastError().text();
+        }
+    }
+    QSqlDatabase::removeDatabase( "test_killer" );
+    return is_killed;
+}
@@ -0,0 +1,53 @@
+#ifndef TEST_BACKENDS_HPP
+#define TEST_BACKENDS_HPP
+
+#include <QApplication>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+#include "resources.hpp"
+
+class StorageBackend;
+
+// the backend a suite runs against, from PHOEBE_TEST_BACKEND( sqlite, the default, or mysql ) and
+// PHOEBE_TEST_DATABASE. SQLite files go into `directory`.
+std::unique_ptr<StorageBackend> MakeTestBackend( QString const & name, QTemporaryDir const & directory );
+QString TestBackendName();
+
+// the fixture every suite starts from: the test backend installed, its schema created and the
+// calling thread's pooled connection in `database`
+bool InstallTestBackend( QTemporaryDir const & directory, QSqlDatabase & database, QString & error );
+bool EmptyTables( QSqlDatabase & database, QStringList const & tables, QString & error );
+
+unsigned int const TEST_BOOK_STOCK = 10;
+// a book with every column filled in, added on a whole second( MySQL's DATETIME drops the rest )
+DatabaseRecordFormat TestBook( QString const & title );
+// inserted through StatementId::InsertInventory, the new serial number or 0
+unsigned int AddTestBook( QSqlDatabase & database, DatabaseRecordFormat const & book );
+
+// the connection of the calling thread's pool slot goes away as if the server had dropped it: MySQL
+// kills it from another connection, SQLite closes it underneath the pool
+bool KillPooledConnection( QString & error );
+
+// a run never switches backends( see StorageBackend::Current ), so this runs the executable again
+// once per backend, SQLite and MySQL unless PHOEBE_TEST_BACKENDS( comma separated ) names others.
+// The number of failed runs
+int RunPerBackend( QStringList const & arguments );
+
+// QTEST_MAIN for suites that must hold on every backend: without PHOEBE_TEST_BACKEND the suite runs
+// itself once per backend and fails if any run does
+#define PHOEBE_TEST_MAIN_PER_BACKEND( TestObject ) \
+int main( int argc, char *argv[] ) \
+{ \
+    QApplication application( argc, argv ); \
+    if( !qEnvironmentVariableIsSet( "PHOEBE_TEST_BACKEND" ) ){ \
+        return RunPerBackend( application.arguments().mid( 1 ) ); \
+    } \
+    TestObject test {}; \
+    return QTest::qExec( &test, argc, argv ); \
+}
+
+#endif // TEST_BACKENDS_HPP
@@ -0,0 +1,19 @@
+# shared by every suite. PHOEBE_TEST_BACKEND=mysql runs them against PHOEBE_TEST_DATABASE( phoebe_tests
+# by default ) on the application's MySQL server instead, the database is emptied by the suites.
+
+QT       += core gui sql printsupport concurrent testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TEMPLATE = app
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += $$PWD
+
+include( $$PWD/../BookManagement.pri )
+
+SOURCES += $$PWD/test_backends.cpp
+HEADERS += $$PWD/test_backends.hpp
@@ -0,0 +1,11 @@
+# QtTest suites over the application's own sources, each one an executable of its own. Build and
+# run them on their own: qmake tests/tests.pro && make && make check
+# They run against a throwaway SQLite file by default, see tests.pri for MySQL. checkout and
+# backend_conformance run against SQLite and MySQL both, or the backends PHOEBE_TEST_BACKENDS names.
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    connection_pool \
+    checkout \
+    backend_conformance
@@ -10,10 +10,20 @@
 #include <QFileDialog>
 #include <QBuffer>
 #include <QImageWriter>
+#include "cover_cache.hpp"
+#include "db_executor.hpp"
+#include "statement_cache.hpp"
+#include "query_tracer.hpp"
+#include "report_journal.hpp"
+#include "low_stock_tracker.hpp"
+#include "inventory_cache.hpp"
+#include "cover_store.hpp"
+#include "inventory_pager.hpp"
 
 ViewInventoryDialog::ViewInventoryDialog( ActionType action, QWidget *parent) :
     QDialog( parent ),
-    ui( new Ui::ViewInventoryDialog ), curr_record_index( 0 )
+    ui( new Ui::ViewInventoryDialog ), curr_record_index( 0 ), pager( nullptr ),
+    cover_uploaded( false ), action_type( action )
 {
     ui->setupUi(this);
     setMaximumSize( 400, 350 );
@@ -35,6 +45,8 @@ ViewInventoryDialog::ViewInventoryDialog( ActionType action, QWidget *parent) :
 
     QObject::connect( ui->nextButton, SIGNAL( clicked( bool ) ), this, SLOT( onNextRecord()) );
     QObject::connect( ui->prevButton, SIGNAL( clicked( bool ) ), this, SLOT( onPreviousRecord() ) );
+    QObject::connect( &InventoryCache::Instance(), SIGNAL(recordChanged(uint,quint64)), this,
+                      SLOT(onRecordChanged(uint)) );
 }
 
 ViewInventoryDialog::~ViewInventoryDialog()
@@ -62,6 +74,7 @@ void ViewInventoryDialog::SetupWindowForUpdate()
     ui->stockLineEdit->setReadOnly( false );
     ui->priceLineEdit->setReadOnly( false );
     ui->titleLineEdit->setReadOnly( false );
+    ui->thresholdSpinBox->setReadOnly( false );
 
     QObject::connect( ui->actionButton, SIGNAL(clicked(bool)), this, SLOT( onUpdateButtonClicked()) );
     QObject::connect( ui->uploadButton, SIGNAL( clicked(bool)), this, SLOT( onUploadButtonClicked()) );
@@ -82,6 +95,7 @@ void ViewInventoryDialog::onUploadButtonClicked()
         ui->coverLabel->setPixmap( QPixmap::fromImage( image ));
         ui->coverLabel->setMaximumSize( QSize( 100, 100 ) );
         m_image = image;
+        cover_uploaded = true;
     }
 }
 
@@ -91,30 +105,65 @@ void ViewInventoryDialog::onDeleteButtonClicked()
                               QMessageBox::Yes | QMessageBox::No ) == QMessageBox::No )
         return;
 
-    QSqlQuery deleteQuery {};
-    unsigned int id = data_list.at( curr_record_index ).serial_number;
+    unsigned int const id = data_list.at( curr_record_index ).serial_number;
+    ReportFormat const report = MakeReport( ActionType::Delete );
 
-    deleteQuery.prepare( "DELETE FROM inventory WHERE serial_number = " + QString::number( id ) );
-    if( !deleteQuery.exec() ){
-        qDebug() << deleteQuery.lastError();
-        QMessageBox::critical( this, "Delete", "Unable to delete record", QMessageBox::Ok );
-        return;
-    }
-    GenerateReport( ActionType::Delete );
-    data_list.removeAt( curr_record_index );
-    if( data_list.isEmpty() ){
-        QMessageBox::information( this, "Inventory", "Empty records", QMessageBox::Ok );
-        accept();
-        return;
-    }
-    curr_record_index = 0;
-    UpdateNextRecord( curr_record_index );
+    ui->actionButton->setEnabled( false );
+    DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this, [id, report]( QSqlDatabase & database )
+    {
+        StatementCache & statements = StatementCache::ForThread();
+        // run again as a whole if the connection drops halfway
+        return statements.Transact( database, [&]{
+            QueryResult<bool> result {};
+            // the row and its tombstone go together, snapshots catch up on deletions from the tombstones
+            if( !statements.Begin( database ) ){
+                result.error = database.lastError().text();
+                return result;
+            }
+            QSqlQuery & deleteQuery = statements.Prepare( database, StatementId::DeleteInventory );
+            deleteQuery.bindValue( ":serial_number", id );
+            if( !statements.Exec( database, StatementId::DeleteInventory, deleteQuery ) ){
+                result.error = deleteQuery.lastError().text();
+                statements.Rollback( database );
+                return result;
+            }
+            QSqlQuery & tombstoneQuery = statements.Prepare( database, StatementId::RecordDeletion );
+            tombstoneQuery.bindValue( ":serial_number", id );
+            if( !statements.Exec( database, StatementId::RecordDeletion, tombstoneQuery ) ||
+                    !statements.Commit( database ) ){
+                result.error = tombstoneQuery.lastError().isValid() ? tombstoneQuery.lastError().text() :
+                                                                      database.lastError().text();
+                statements.Rollback( database );
+                return result;
+            }
+            ReportJournal::Instance().Append( report );
+            InventoryCache::Instance().Remove( id );
+            LowStockTracker::Instance().Remove( id );
+            result.ok = true;
+            return result;
+        });
+    }, [this, id]( QueryResult<bool> result ){
+        ui->actionButton->setEnabled( true );
+        if( !result.ok ){
+            qDebug() << result.error;
+            QMessageBox::critical( this, "Delete", "Unable to delete record", QMessageBox::Ok );
+            return;
+        }
+        int const index = IndexOf( id );
+        if( index != -1 ) data_list.removeAt( index );
+        // the pager's windows still hold the record, they are fetched again around it
+        if( pager ) pager->Reanchor();
+        if( data_list.isEmpty() ){
+            if( !pager ) ShowEmptyState(); // the pager may still find the window before this one
+            return;
+        }
+        curr_record_index = qMin( curr_record_index, data_list.size() - 1 );
+        UpdateNextRecord( curr_record_index );
+    });
 }
 
 void ViewInventoryDialog::onUpdateButtonClicked()
 {
-    unsigned int const serial_number = data_list.at( curr_record_index ).serial_number;
-
     auto is_valid_quantity = false, is_valid_price = false;
 
     int const stock = ui->stockLineEdit->text().toInt( &is_valid_quantity );
@@ -130,68 +179,184 @@ void ViewInventoryDialog::onUpdateButtonClicked()
         return;
     }
 
-    QSqlQuery updateQuery {};
-    updateQuery.prepare( tr( "UPDATE inventory SET book_title = :title , author_name = :author,"
-                             " publisher = :publisher, stock = :stock, price = :price, "
-                             "location = :location, book_cover = :cover WHERE serial_number = " )
-                         + QString::number( serial_number ) );
-
-    updateQuery.bindValue( ":title", ui->titleLineEdit->text() );
-    updateQuery.bindValue( ":author", ui->authorLineEdit->text() );
-    updateQuery.bindValue( ":publisher", ui->publisherLineEdit->text() );
-    updateQuery.bindValue( ":stock", stock );
-    updateQuery.bindValue( ":price", price );
-    updateQuery.bindValue( ":location", ui->locationLineEdit->text() );
+    // the form is compared with the record as it was shown, only what the user edited is written. The
+    // rest is taken from the latest copy, a sale made in the meantime is not undone
+    DatabaseRecordFormat edited = shown_record;
+    edited.book_title = ui->titleLineEdit->text();
+    edited.author_name = ui->authorLineEdit->text();
+    edited.publisher = ui->publisherLineEdit->text();
+    edited.quantity = stock;
+    // the price is shown rounded, it only changes if it was typed in
+    if( ui->priceLineEdit->isModified() ) edited.price = price;
+    edited.location = ui->locationLineEdit->text();
+    edited.low_stock_threshold = static_cast<unsigned int>( ui->thresholdSpinBox->value() );
+
+    ColumnMask const edited_columns = ChangedColumns( shown_record, edited );
+    if( edited_columns == 0 && !cover_uploaded ){
+        QMessageBox::information( this, "Update", "Nothing has changed", QMessageBox::Ok );
+        return;
+    }
+    DatabaseRecordFormat const current = data_list.at( curr_record_index );
+    DatabaseRecordFormat record = current;
+    CopyColumns( record, edited, edited_columns );
 
-    {
+    // only a newly uploaded cover is encoded and stored, the row keeps its hash otherwise
+    QByteArray new_cover {};
+    if( cover_uploaded ){
         QBuffer buffer {};
         QImageWriter image_writer{ &buffer, "PNG" };
         image_writer.write( m_image );
 
-        updateQuery.bindValue( ":cover", buffer.data() );
+        new_cover = buffer.data();
     }
+    ReportFormat const report = MakeReport( ActionType::Update );
 
-    if( !updateQuery.exec() ){
-        qDebug() << updateQuery.lastError();
-        QMessageBox::warning( this, "Update", "Unable to update data", QMessageBox::Ok );
-        return;
-    }
+    ui->actionButton->setEnabled( false );
+    DatabaseExecutor::Instance().Submit( QueryPriority::Interactive, this,
+                                         [current, record, new_cover, report]( QSqlDatabase & database )
+    {
+        QueryResult<DatabaseRecordFormat> result {};
+        result.value = record;
+        if( !new_cover.isEmpty() ){
+            result.value.cover_hash = CoverStore::Instance().Put( database, new_cover, result.error );
+            if( result.value.cover_hash.isEmpty() ) return result;
+        }
+        // e.g. the same cover uploaded again
+        ColumnMask const changed = ChangedColumns( current, result.value );
+        if( changed == 0 ){
+            result.ok = true;
+            return result;
+        }
+        // the statement depends on the columns changed, so it is not one of the cached ones. Edits
+        // are made by hand, one at a time
+        QSqlQuery updateQuery{ database };
+        if( !updateQuery.prepare( UpdateStatement<DatabaseRecordFormat>( changed ) ) ){
+            result.error = updateQuery.lastError().text();
+            return result;
+        }
+        BindColumns( updateQuery, result.value, changed );
+        if( !QueryTracer::Instance().Exec( "update_inventory_columns", updateQuery ) ){
+            result.error = updateQuery.lastError().text();
+            return result;
+        }
+        ReportJournal::Instance().Append( report );
+        InventoryCache::Instance().Insert( result.value );
+        LowStockTracker::Instance().Update( MakeLowStockItem( result.value ) );
+        result.ok = true;
+        return result;
+    }, [this]( QueryResult<DatabaseRecordFormat> result ){
+        ui->actionButton->setEnabled( true );
+        if( !result.ok ){
+            qDebug() << result.error;
+            QMessageBox::warning( this, "Update", "Unable to update data", QMessageBox::Ok );
+            return;
+        }
+        int const index = IndexOf( result.value.serial_number );
+        if( index != -1 ){
+            data_list[ index ] = result.value;
+            if( index == curr_record_index ){
+                shown_record = result.value;
+                ui->priceLineEdit->setModified( false );
+                cover_uploaded = false;
+            }
+        }
+        if( pager ) pager->Reanchor();
+        QMessageBox::information( this, "Update", "Information updated successfully", QMessageBox::Ok );
+    });
+}
 
-    GenerateReport( ActionType::Update );
-    QMessageBox::information( this, "Update", "Information updated successfully", QMessageBox::Ok );
+void ViewInventoryDialog::onRecordChanged( unsigned int serial_number )
+{
+    int const index = IndexOf( serial_number );
+    DatabaseRecordFormat record {};
+    if( index == -1 || !InventoryCache::Instance().Find( serial_number, record ) ) return;
+
+    data_list[ index ] = record;
+    // never overwrite what the user is in the middle of editing
+    if( index == curr_record_index && action_type != ActionType::Update ) UpdateNextRecord( index );
 }
 
 void ViewInventoryDialog::onNextRecord()
 {
-    if( data_list.size() > 0 && curr_record_index == data_list.size() - 1 ) return;
+    if( data_list.size() > 0 && curr_record_index == data_list.size() - 1 ){
+        // end of the current window, the pager swaps in the next one( or does so once it arrives )
+        if( pager ) pager->MoveNext();
+        return;
+    }
     ++curr_record_index;
     UpdateNextRecord( curr_record_index );
 }
 
 void ViewInventoryDialog::onPreviousRecord()
 {
-    if( curr_record_index == 0 ) return;
+    if( curr_record_index == 0 ){
+        if( pager ) pager->MovePrevious();
+        return;
+    }
     --curr_record_index;
     UpdateNextRecord( curr_record_index );
 }
 
 void ViewInventoryDialog::CheckDatabaseRecord()
 {
-    // since we're maintaining a single database connection, Qt knows what DB to call this on
-    QSqlQuery select_query { tr( "SELECT * FROM inventory" ) };
-    if( !select_query.exec() ){
-        qDebug() << select_query.lastError();
+    // the inventory is browsed one window at a time, the first window arrives in onPageChanged
+    pager = new InventoryPager( InventoryPager::PAGE_SIZE, this );
+    QObject::connect( pager, SIGNAL(pageChanged(bool)), this, SLOT(onPageChanged(bool)) );
+    QObject::connect( pager, SIGNAL(pageReloaded()), this, SLOT(onPageReloaded()) );
+    QObject::connect( pager, SIGNAL(fetchFailed()), this, SLOT(onPageFetchFailed()) );
+    pager->Start();
+}
+
+void ViewInventoryDialog::onPageChanged( bool forward )
+{
+    data_list = pager->CurrentPage();
+    if( data_list.isEmpty() ){
+        ShowEmptyState();
+        return;
+    }
+    curr_record_index = forward ? 0 : data_list.size() - 1;
+    UpdateNextRecord( curr_record_index );
+}
+
+void ViewInventoryDialog::onPageReloaded()
+{
+    unsigned int const shown = shown_record.serial_number;
+    data_list = pager->CurrentPage();
+    if( data_list.isEmpty() ){
+        ShowEmptyState();
+        return;
+    }
+    // stay on the record that was shown, or on the one that took the place of a deleted one
+    int const index = IndexOf( shown );
+    curr_record_index = index != -1 ? index : qBound( 0, curr_record_index, data_list.size() - 1 );
+    // the form is only refilled once the user's edit has been written
+    if( index == -1 || action_type != ActionType::Update ) UpdateNextRecord( curr_record_index );
+}
+
+void ViewInventoryDialog::onPageFetchFailed()
+{
+    if( data_list.isEmpty() ){
         QMessageBox::critical( this, "View", tr( "Unable to retrieve any information from the inventory"),
                                QMessageBox::Ok );
         accept();
     }
-    FillRecordFromQuery( data_list, select_query );
-    if( data_list.isEmpty() ){
-        QMessageBox::information( this, "View", tr( "Nothing has been saved in the inventory yet" ),
-                                  QMessageBox::Ok );
-        accept();
-    } else {
-        UpdateNextRecord( 0 );
+}
+
+void ViewInventoryDialog::ShowEmptyState()
+{
+    for( QLineEdit *edit : { ui->titleLineEdit, ui->authorLineEdit, ui->publisherLineEdit, ui->locationLineEdit,
+                             ui->stockLineEdit, ui->priceLineEdit, ui->dateAddedLineEdit } ){
+        edit->clear();
+    }
+    ui->thresholdSpinBox->setValue( 0 );
+    ui->coverLabel->clear();
+    ui->coverLabel->setText( tr( "NO RECORDS" ) );
+    shown_record = DatabaseRecordFormat{};
+    curr_record_index = 0;
+    cover_uploaded = false;
+    // there is nothing left to browse or act on, the dialog stays open until the user closes it
+    for( QPushButton *button : { ui->nextButton, ui->prevButton, ui->actionButton, ui->uploadButton } ){
+        button->setEnabled( false );
     }
 }
 
@@ -209,26 +374,51 @@ void ViewInventoryDialog::UpdateNextRecord( int pos )
     ui->stockLineEdit->setText( QString::number( data.quantity ) );
     ui->titleLineEdit->setText( data.book_title );
     ui->priceLineEdit->setText( QString::number( data.price ) );
+    ui->thresholdSpinBox->setValue( static_cast<int>( data.low_stock_threshold ) );
     ui->coverLabel->clear();
+    ui->coverLabel->setText( tr( "LOADING COVER..." ) );
+    m_image = QImage();
+    cover_uploaded = false;
+    shown_record = data;
+
+    unsigned int const serial_number = data.serial_number;
+    CoverCache & covers = CoverCache::Instance();
+    covers.RequestThumbnail( data.cover_hash, this, [this, serial_number]( QPixmap const & thumbnail, bool ok ){
+        ShowCover( serial_number, thumbnail, ok );
+    });
+    // the user is likely to step to either neighbour next
+    if( pos + 1 < data_list.size() ) covers.Prefetch( data_list.at( pos + 1 ).cover_hash, this );
+    if( pos > 0 ) covers.Prefetch( data_list.at( pos - 1 ).cover_hash, this );
+}
 
-    if( !( data.book_cover.isNull() ) ){
-        QImage image{ QImage::fromData( data.book_cover ) };
+void ViewInventoryDialog::ShowCover( unsigned int serial_number, QPixmap const & thumbnail, bool ok )
+{
+    // the user may have moved on to another record while this cover was on its way
+    if( curr_record_index < 0 || curr_record_index >= data_list.size() ||
+            data_list.at( curr_record_index ).serial_number != serial_number ) return;
+    if( cover_uploaded ) return; // a new cover has been uploaded in the meantime
 
-        if( image.isNull() ){
-            QMessageBox::warning( this, "View", tr( "Unable to retrieve cover page" ), QMessageBox::Ok );
-            return;
-        }
-        QPixmap cover_image = QPixmap::fromImage( image.scaled( 100, 100, Qt::KeepAspectRatio,
-                                                                Qt::SmoothTransformation ) );
-        ui->coverLabel->setPixmap( cover_image );
-        ui->coverLabel->setFixedSize( 100, 100 );
-        m_image = image;
+    ui->coverLabel->clear();
+    if( !ok ){
+        QMessageBox::warning( this, "View", tr( "Unable to retrieve cover page" ), QMessageBox::Ok );
+        return;
+    }
+    if( !thumbnail.isNull() ){
+        ui->coverLabel->setPixmap( thumbnail );
+        ui->coverLabel->setFixedSize( CoverCache::THUMBNAIL_SIZE, CoverCache::THUMBNAIL_SIZE );
     } else {
         ui->coverLabel->setText( tr( "NO COVER PAGE"));
-        m_image = QImage();
     }
 }
 
+int ViewInventoryDialog::IndexOf( unsigned int serial_number ) const
+{
+    for( int i = 0; i != data_list.size(); ++i ){
+        if( data_list.at( i ).serial_number == serial_number ) return i;
+    }
+    return -1;
+}
+
 void ViewInventoryDialog::SetDataList( QList<DatabaseRecordFormat> && list )
 {
     data_list.clear();
@@ -237,38 +427,30 @@ void ViewInventoryDialog::SetDataList( QList<DatabaseRecordFormat> && list )
     UpdateNextRecord( curr_record_index );
 }
 
-void ViewInventoryDialog::GenerateReport( ActionType action )
+ReportFormat ViewInventoryDialog::MakeReport( ActionType action ) const
 {
-    QSqlQuery delete_report_query{};
-    delete_report_query.prepare( "INSERT INTO reports( book_title, author_name, stock, price, "
-                                 "date_performed, transaction_type, total ) VALUES ( :title, :author, "
-                                 ":stck, :price, :date, :type, :total )");
-    delete_report_query.bindValue( ":title", ui->titleLineEdit->text() );
-    delete_report_query.bindValue( ":author", ui->authorLineEdit->text() );
-    delete_report_query.bindValue( ":date", GetDateTime( QDateTime::currentDateTime() ) );
-    delete_report_query.bindValue( ":price", ui->priceLineEdit->text() );
-    delete_report_query.bindValue( ":total", 0.0 );
+    ReportFormat report {};
+    report.book_title = ui->titleLineEdit->text();
+    report.author_name = ui->authorLineEdit->text();
+    report.date_time_added = QDateTime::currentDateTime();
+    report.price = ui->priceLineEdit->text().toDouble();
+    report.total = 0.0;
 
     if( action == ActionType::Delete ){
-        delete_report_query.bindValue( ":type", static_cast<int>( ReportActionType::DELETIONS ) );
-        delete_report_query.bindValue( ":stck", ui->stockLineEdit->text().toInt() );
+        report.detail = ReportActionType::DELETIONS;
+        report.quantity = ui->stockLineEdit->text().toInt();
     } else if ( action == ActionType::Update ){
-        delete_report_query.bindValue( ":type", static_cast<int>( ReportActionType::UPDATES ) );
+        report.detail = ReportActionType::UPDATES;
         int initial_stock_avaiable = data_list.at( curr_record_index ).quantity;
         int new_stock_available = ui->stockLineEdit->text().toInt();
         if( initial_stock_avaiable != new_stock_available ){
-            int stock_quantity = new_stock_available > initial_stock_avaiable?
+            report.quantity = new_stock_available > initial_stock_avaiable?
                         new_stock_available - initial_stock_avaiable:
                         initial_stock_avaiable - new_stock_available;
-            delete_report_query.bindValue( ":stck", stock_quantity );
         } else {
-            delete_report_query.bindValue( ":stck", ui->stockLineEdit->text().toInt() );
+            report.quantity = ui->stockLineEdit->text().toInt();
         }
     }
 
-    if( !delete_report_query.exec() ){
-        qDebug() << delete_report_query.lastError();
-        QMessageBox::information( this, "Report", "Unable to generate report", QMessageBox::Ok );
-        return;
-    }
+    return report;
 }
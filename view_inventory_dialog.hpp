@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QList>
 #include <QDateTime>
+#include <QPixmap>
 #include "resources.hpp"
 
 namespace Ui {
@@ -19,6 +20,7 @@ enum class ActionType
 };
 
 class QSqlQuery;
+class InventoryPager;
 
 class ViewInventoryDialog : public QDialog
 {
@@ -37,16 +39,27 @@ private slots:
     void onDeleteButtonClicked();
     void onUpdateButtonClicked();
     void onUploadButtonClicked();
+    void onPageChanged( bool );
+    void onPageReloaded();
+    void onPageFetchFailed();
+    void onRecordChanged( unsigned int serial_number );
 private:
     void UpdateNextRecord( int );
+    void ShowEmptyState();
     void SetupWindowForDelete();
     void SetupWindowForUpdate();
-    void GenerateReport( ActionType );
+    void ShowCover( unsigned int serial_number, QPixmap const & thumbnail, bool ok );
+    int  IndexOf( unsigned int serial_number ) const;
+    ReportFormat MakeReport( ActionType ) const;
 private:
     Ui::ViewInventoryDialog     *ui;
     QList<DatabaseRecordFormat> data_list; // a linked-list of database data
     int                         curr_record_index;
-    QImage                      m_image;
+    QImage                      m_image; // a newly uploaded cover
+    DatabaseRecordFormat        shown_record; // as it was put in the form, edits are diffed against it
+    InventoryPager              *pager; // only used when browsing the whole inventory
+    bool                        cover_uploaded;
+    ActionType                  action_type;
 };
 
 #endif // VIEW_INVENTORY_DIALOG_HPP